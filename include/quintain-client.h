@@ -20,6 +20,58 @@ extern "C" {
 typedef struct quintain_client*          quintain_client_t;
 typedef struct quintain_provider_handle* quintain_provider_handle_t;
 
+/**
+ * Describes how a quintain_work_ext() call was carried out when it was
+ * retried or hedged (see quintain_work_info).
+ */
+struct quintain_work_outcome {
+    uint32_t attempts;  /* requests sent to the target provider */
+    uint32_t timeouts;  /* requests (of either kind) that timed out */
+    uint32_t hedges;    /* duplicates sent to the hedge provider */
+    uint32_t hedge_won; /* hedged attempts won by the hedge provider */
+};
+
+/**
+ * The quintain_work_info structure can be passed in to quintain_work_ext()
+ * to adjust optional workload behavior.  The struct can be memset to zero
+ * (or initialized with QTN_WORK_INFO_INITIALIZER) to use default values.
+ */
+struct quintain_work_info {
+    hg_size_t bulk_chunk_size;      /* split server-side bulk transfer into
+                                       chunks of this size (0 = provider
+                                       default) */
+    uint32_t  bulk_pipeline_depth;  /* number of chunk transfers in flight at
+                                       once (0 = provider default) */
+    uint32_t  bulk_segment_count;   /* describe bulk_buffer as this many equal
+                                       sized segments (0 or 1 = contiguous) */
+    hg_size_t bulk_segment_stride;  /* distance in bytes between the start of
+                                       consecutive segments (0 = packed) */
+    uint32_t  server_segment_count; /* number of segments in the provider's
+                                       local bulk buffer (0 or 1 =
+                                       contiguous); rejected if the transfer
+                                       would be chunked */
+    uint64_t  payload_seed;         /* base seed for payload patterns when
+                                       QTN_WORK_VERIFY_PAYLOAD is set */
+    hg_size_t raw_size;             /* uncompressed size of bulk_buffer when
+                                       QTN_WORK_DECOMPRESS is set */
+    uint32_t  fault_delay_usec;     /* extra time the provider waits before
+                                       carrying out the request */
+
+    /* timeouts, retries, and hedging (see quintain_work_ext()) */
+    double                        timeout_ms;       /* per request (0 = no
+                                                       limit) */
+    uint32_t                      max_retries;      /* after the first */
+    double                        retry_backoff_ms; /* doubled each time */
+    quintain_provider_handle_t    hedge_provider;   /* NULL = no hedging */
+    double                        hedge_delay_ms;   /* wait before hedging */
+    struct quintain_work_outcome* outcome;          /* filled in if set */
+};
+
+#define QTN_WORK_INFO_INITIALIZER                      \
+    {                                                  \
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, NULL \
+    }
+
 int quintain_client_init(margo_instance_id mid, quintain_client_t* client);
 
 int quintain_client_finalize(quintain_client_t client);
@@ -39,11 +91,123 @@ int quintain_work(quintain_provider_handle_t provider,
                   void*                      bulk_buffer,
                   int                        flags);
 
+/**
+ * Same as quintain_work(), but with additional optional parameters.
+ *
+ * If info->bulk_segment_count is greater than one then bulk_buffer is
+ * registered as a multi-segment bulk handle: bulk_size is divided evenly
+ * into segments (the last one absorbs any remainder) and segment i starts
+ * at bulk_buffer + i * bulk_segment_stride.  The caller must provide a
+ * buffer large enough to hold the final segment.
+ *
+ * If QTN_WORK_VERIFY_PAYLOAD is set in flags then every payload is filled
+ * by its sender with a seeded pattern and checked by its receiver with a
+ * CRC32C checksum.  Note that this overwrites the contents of bulk_buffer
+ * for HG_BULK_PULL operations.  A mismatch on either side is reported as
+ * QTN_ERR_INTEGRITY.
+ *
+ * If QTN_WORK_COMPRESS is set in flags then the provider compresses the
+ * data that it pulls from bulk_buffer (using its configured
+ * "compression_level") before discarding the result.  If
+ * QTN_WORK_DECOMPRESS is set then bulk_buffer must instead hold a zlib
+ * stream that decompresses to exactly info->raw_size bytes.  Both flags
+ * require bulk_op to be HG_BULK_PULL; a stream that fails to compress or
+ * decompress is reported as QTN_ERR_COMPRESSION.
+ *
+ * QTN_WORK_FAULT_ERROR and QTN_WORK_FAULT_DROP ask the provider to fail the
+ * request with QTN_ERR_INJECTED or to never respond to it, and
+ * info->fault_delay_usec adds a fixed delay before the provider carries it
+ * out.  These apply on top of any faults that the provider injects on its
+ * own (see its "fault_injection" configuration) unless QTN_WORK_NO_FAULTS
+ * is set.
+ *
+ * If info->timeout_ms is set then a request that has not been answered in
+ * time is abandoned with QTN_ERR_TIMEOUT.  Requests that time out, are
+ * refused with QTN_ERR_BUSY, or fail with QTN_ERR_INJECTED are sent again
+ * up to info->max_retries times, with an exponential backoff starting at
+ * info->retry_backoff_ms.  If info->hedge_provider is set and a request has
+ * not been answered after info->hedge_delay_ms, a duplicate is sent to the
+ * hedge provider.  The first of the two to complete at the Mercury level is
+ * used and the other is cancelled, even if the response reports
+ * QTN_ERR_BUSY or QTN_ERR_INJECTED (which is then retried like any other).
+ * Requests are not hedged if the hedge provider is the target provider
+ * itself.  Note that both providers transfer bulk data
+ * from or to bulk_buffer.
+ *
+ * @param [in] info optional workload parameters (may be NULL)
+ * @returns 0 on success, QTN_ERR_* otherwise
+ */
+int quintain_work_ext(quintain_provider_handle_t       provider,
+                      int                              req_buffer_size,
+                      int                              resp_buffer_size,
+                      hg_size_t                        bulk_size,
+                      hg_bulk_op_t                     bulk_op,
+                      void*                            bulk_buffer,
+                      int                              flags,
+                      const struct quintain_work_info* info);
+
+/**
+ * Describes one operation in a quintain_work_batch() call.  The fields have
+ * the same meaning as the corresponding quintain_work() arguments.
+ */
+struct quintain_work_op {
+    int          req_buffer_size;
+    int          resp_buffer_size;
+    hg_size_t    bulk_size;
+    hg_bulk_op_t bulk_op;
+    void*        bulk_buffer;
+    int          flags;
+    int          ret; /* result of this operation (set on return) */
+};
+
+/**
+ * Issues count workload operations to a provider in a single RPC.  The
+ * request and response buffers of all operations are carried in one
+ * request and one response, and the bulk buffers of all operations are
+ * registered together as a single multi-segment bulk handle.
+ *
+ * If QTN_BATCH_CONCURRENT is set in batch_flags then the provider executes
+ * the operations concurrently in separate ULTs; otherwise it executes them
+ * one at a time in order.  Only QTN_WORK_USE_SERVER_POOLSET is supported in
+ * per-operation flags.
+ *
+ * @param [in] count number of operations
+ * @param [in,out] ops operation descriptors; ret is set for each one
+ * @returns 0 if the batch was executed (the result of each operation is in
+ * its ret field), QTN_ERR_* otherwise
+ */
+int quintain_work_batch(quintain_provider_handle_t provider,
+                        size_t                     count,
+                        struct quintain_work_op*   ops,
+                        int                        batch_flags);
+
 int quintain_stat(quintain_provider_handle_t provider,
                   double*                    utime_sec,
                   double*                    stime_sec,
                   double*                    alltime_sec);
 
+/**
+ * Retrieves the energy consumed on the provider's node, as measured by its
+ * RAPL counters, since the provider was registered.
+ *
+ * @param [in] provider provider handle
+ * @param [out] joules energy in joules, or -1 if the provider cannot read
+ * energy counters
+ * @returns 0 on success, QTN_ERR_* otherwise
+ */
+int quintain_stat_energy(quintain_provider_handle_t provider, double* joules);
+
+/**
+ * Changes the configuration of a remote provider at run time.  See
+ * quintain_provider_set_config() for details.
+ *
+ * @param [in] provider provider handle
+ * @param [in] json_config JSON-formatted object with settings to change
+ * @returns 0 on success, QTN_ERR_* otherwise
+ */
+int quintain_set_config(quintain_provider_handle_t provider,
+                        const char*                json_config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,8 @@ typedef struct quintain_provider* quintain_provider_t;
 struct quintain_provider_init_info {
     const char* json_config; /* optional JSON-formatted string */
     ABT_pool    rpc_pool;    /* optional pool on which to run RPC handlers */
+    ABT_pool    bulk_pool;   /* optional pool on which to run large requests
+                                (see "bulk_pool_threshold") */
 };
 
 /**
@@ -38,7 +40,7 @@ struct quintain_provider_init_info {
 
 #define QTN_PROVIDER_INIT_INFO_INITIALIZER \
     {                                      \
-        NULL, ABT_POOL_NULL                \
+        NULL, ABT_POOL_NULL, ABT_POOL_NULL \
     }
 
 /**
@@ -71,6 +73,22 @@ int quintain_provider_deregister(quintain_provider_t provider);
  */
 char* quintain_provider_get_config(quintain_provider_t provider);
 
+/**
+ * Changes the configuration of a running quintain provider.  The json
+ * object is merged into the current configuration, so it need only contain
+ * the keys that should change (e.g., poolset parameters or bulk transfer
+ * defaults).  Requests that are already in progress are not affected; new
+ * requests use the updated settings.  If the poolset parameters change then
+ * a new poolset is created and the old one is destroyed once the last
+ * request using it completes.
+ *
+ * @param [in] provider quintain provider
+ * @param [in] json_config JSON-formatted object with settings to change
+ * @returns 0 on success, QTN_ERR_* otherwise
+ */
+int quintain_provider_set_config(quintain_provider_t provider,
+                                 const char*         json_config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,15 +26,40 @@ extern "C" {
 #define QTN_CRITICAL(_mid, _format, f...) \
     margo_critical(_mid, "quintain: " _format, ##f)
 
-#define QTN_SUCCESS              0    /* success */
-#define QTN_ERR_ALLOCATION       (-1) /* error allocating something */
-#define QTN_ERR_INVALID_ARG      (-2) /* invalid argument */
-#define QTN_ERR_MERCURY          (-3) /* Mercury error */
-#define QTN_ERR_UNKNOWN_PROVIDER (-4) /* can't find provider */
-#define QTN_ERR_STATISTICS       (-5) /* unable to retrieve statistics */
+#define QTN_SUCCESS              0     /* success */
+#define QTN_ERR_ALLOCATION       (-1)  /* error allocating something */
+#define QTN_ERR_INVALID_ARG      (-2)  /* invalid argument */
+#define QTN_ERR_MERCURY          (-3)  /* Mercury error */
+#define QTN_ERR_UNKNOWN_PROVIDER (-4)  /* can't find provider */
+#define QTN_ERR_STATISTICS       (-5)  /* unable to retrieve statistics */
+#define QTN_ERR_INTEGRITY        (-6)  /* payload failed verification */
+#define QTN_ERR_COMPRESSION      (-7)  /* compression stage failed */
+#define QTN_ERR_BUSY             (-8)  /* provider is overloaded */
+#define QTN_ERR_INJECTED         (-9)  /* fault injected by the provider */
+#define QTN_ERR_TIMEOUT          (-10) /* no response in the allotted time */
 
 /* flags for workload operations */
 #define QTN_WORK_USE_SERVER_POOLSET 1
+/* fill payloads with a seeded pattern and verify them with checksums */
+#define QTN_WORK_VERIFY_PAYLOAD 2
+/* compress pulled bulk data on the provider */
+#define QTN_WORK_COMPRESS 4
+/* decompress pulled bulk data on the provider */
+#define QTN_WORK_DECOMPRESS 8
+/* run on the provider's bulk pool (if it has one) regardless of size */
+#define QTN_WORK_BULK_CLASS 16
+/* exempt from the provider's configured fault injection */
+#define QTN_WORK_NO_FAULTS 32
+/* have the provider fail the request with QTN_ERR_INJECTED */
+#define QTN_WORK_FAULT_ERROR 64
+/* have the provider drop the response (the request never completes unless
+ * the client gives up on it)
+ */
+#define QTN_WORK_FAULT_DROP 128
+
+/* flags for batched workload operations */
+/* execute the operations in a batch concurrently rather than in order */
+#define QTN_BATCH_CONCURRENT 1
 
 #ifdef __cplusplus
 }
@@ -17,11 +17,13 @@ class QuintainComponent : public bedrock::AbstractComponent {
     QuintainComponent(const tl::engine& engine,
                       uint16_t  provider_id,
                       const std::string& config,
-                      const tl::pool& pool)
+                      const tl::pool& pool,
+                      const tl::pool& bulk_pool)
     {
         quintain_provider_init_info qargs = {
             /* .json_config = */ config.c_str(),
-            /* .rpc_pool = */ pool.native_handle()
+            /* .rpc_pool = */ pool.native_handle(),
+            /* .bulk_pool = */ bulk_pool.native_handle()
         };
         int ret = quintain_provider_register(
                 engine.get_margo_instance(),
@@ -42,6 +44,10 @@ class QuintainComponent : public bedrock::AbstractComponent {
         return static_cast<void*>(m_provider);
     }
 
+    /* Bedrock has no hook for changing a component's configuration; a
+     * running provider is reconfigured through its own set_config RPC
+     * (quintain_set_config()), and getConfig() reports the result.
+     */
     std::string getConfig() override {
         auto config_cstr = quintain_provider_get_config(m_provider);
         auto config = std::string{config_cstr};
@@ -51,13 +57,17 @@ class QuintainComponent : public bedrock::AbstractComponent {
 
     static std::shared_ptr<bedrock::AbstractComponent>
         Register(const bedrock::ComponentArgs& args) {
-            tl::pool pool;
+            tl::pool pool, bulk_pool;
             auto it = args.dependencies.find("pool");
             if(it != args.dependencies.end() && !it->second.empty()) {
                 pool = it->second[0]->getHandle<tl::pool>();
             }
+            it = args.dependencies.find("bulk_pool");
+            if(it != args.dependencies.end() && !it->second.empty()) {
+                bulk_pool = it->second[0]->getHandle<tl::pool>();
+            }
             return std::make_shared<QuintainComponent>(
-                args.engine, args.provider_id, args.config, pool);
+                args.engine, args.provider_id, args.config, pool, bulk_pool);
         }
 
     static std::vector<bedrock::Dependency>
@@ -70,6 +80,13 @@ class QuintainComponent : public bedrock::AbstractComponent {
                     /* is_required */ false,
                     /* is_array */ false,
                     /* is_updatable */ false
+                },
+                bedrock::Dependency{
+                    /* name */ "bulk_pool",
+                    /* type */ "pool",
+                    /* is_required */ false,
+                    /* is_array */ false,
+                    /* is_updatable */ false
                 }
             };
             return dependencies;
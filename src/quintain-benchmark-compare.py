@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+
+# Compares the <output>.summary.json written by quintain-benchmark against a
+# stored baseline and exits non-zero if any metric got worse by more than
+# its tolerance.  Configurations are matched by position; their overrides
+# must agree.
+#
+# usage: quintain-benchmark-compare.py [-t metric=percent ...] baseline run
+#
+# exit status: 0 if no regression, 1 on regression, 2 on bad arguments or if
+# the two summaries cannot be compared (including any metric that is missing
+# from either one, or that is 0 in the baseline but not in the run)
+
+import argparse
+import json
+import sys
+
+# metric: (default tolerance in percent, True if higher is better)
+METRICS = {
+    'ops_per_sec':        (5.0, True),
+    'median':             (10.0, False),
+    'q3':                 (10.0, False),
+    'p99':                (20.0, False),
+    'mean':               (10.0, False),
+    'client_cpu_seconds': (10.0, False),
+    'server_cpu_seconds': (10.0, False),
+}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='check a quintain-benchmark run against a baseline')
+    parser.add_argument('baseline', help='baseline .summary.json')
+    parser.add_argument('run', help='.summary.json of the run to check')
+    parser.add_argument('-t', '--tolerance', action='append', default=[],
+                        metavar='METRIC=PERCENT',
+                        help='allowed change in the bad direction '
+                             '(repeatable; "all" sets every metric)')
+    parser.add_argument('--ignore-ci', action='store_true',
+                        help='flag changes even when they are within the '
+                             '95%% confidence intervals of repeated trials')
+    return parser.parse_args()
+
+
+def tolerances(specs):
+    tol = {m: t for m, (t, _) in METRICS.items()}
+    for spec in specs:
+        name, _, value = spec.partition('=')
+        if name != 'all' and name not in METRICS:
+            print('error: unknown metric "%s" (one of %s)'
+                  % (name, ', '.join(sorted(METRICS))), file=sys.stderr)
+            sys.exit(2)
+        try:
+            value = float(value)
+        except ValueError:
+            print('error: bad tolerance "%s"' % spec, file=sys.stderr)
+            sys.exit(2)
+        for m in (METRICS if name == 'all' else [name]):
+            tol[m] = value
+    return tol
+
+
+def load(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError) as e:
+        print('error: cannot read %s: %s' % (path, e), file=sys.stderr)
+        sys.exit(2)
+
+
+def mean_str(metric):
+    return '%.6g' % metric['mean'] if metric else '-'
+
+
+def main():
+    args = parse_args()
+    tol = tolerances(args.tolerance)
+    base = load(args.baseline)
+    run = load(args.run)
+
+    base_cfgs = base.get('configurations', [])
+    run_cfgs = run.get('configurations', [])
+    if len(base_cfgs) != len(run_cfgs):
+        print('error: %d configurations in the baseline but %d in the run'
+              % (len(base_cfgs), len(run_cfgs)), file=sys.stderr)
+        return 2
+
+    regressions = 0
+    unchecked = 0
+    print('%-6s %-20s %14s %14s %9s %9s  %s'
+          % ('config', 'metric', 'baseline', 'run', 'change%', 'limit%',
+             'status'))
+    for b, r in zip(base_cfgs, run_cfgs):
+        if b.get('overrides') != r.get('overrides'):
+            print('error: configuration %d differs from the baseline'
+                  % b['config'], file=sys.stderr)
+            return 2
+        for name, (_, higher_is_better) in METRICS.items():
+            bm = b['summary'].get(name)
+            rm = r['summary'].get(name)
+            if not bm or not rm:
+                print('%-6d %-20s %14s %14s %9s %9.2f  %s'
+                      % (b['config'], name, mean_str(bm), mean_str(rm), '-',
+                         tol[name], 'MISSING'))
+                unchecked += 1
+                continue
+            if bm['mean'] == 0:
+                # there is no relative change from nothing
+                status = 'ok' if rm['mean'] == 0 else 'UNCHECKED'
+                if status != 'ok':
+                    unchecked += 1
+                print('%-6d %-20s %14.6g %14.6g %9s %9.2f  %s'
+                      % (b['config'], name, bm['mean'], rm['mean'], '-',
+                         tol[name], status))
+                continue
+            change = 100.0 * (rm['mean'] - bm['mean']) / bm['mean']
+            worse = -change if higher_is_better else change
+            status = 'ok'
+            if worse > tol[name]:
+                # with repeated trials, a difference that the confidence
+                # intervals overlap may just be noise
+                gap = abs(rm['mean'] - bm['mean'])
+                if not args.ignore_ci and gap <= bm['ci95'] + rm['ci95']:
+                    status = 'noise'
+                else:
+                    status = 'REGRESSION'
+                    regressions += 1
+            print('%-6d %-20s %14.6g %14.6g %+9.2f %9.2f  %s'
+                  % (b['config'], name, bm['mean'], rm['mean'], change,
+                     tol[name], status))
+
+    if regressions:
+        print('%d regression(s)' % regressions)
+        return 1
+    if unchecked:
+        print('error: %d metric(s) could not be checked' % unchecked,
+              file=sys.stderr)
+        return 2
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
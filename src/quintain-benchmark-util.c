@@ -0,0 +1,1571 @@
+/*
+ * Copyright (c) 2021 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "mochi-quintain-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/resource.h>
+
+#include <abt.h>
+
+#include "quintain-macros.h"
+#include "quintain-payload.h"
+#include "quintain-rapl.h"
+#include "quintain-rpc.h"
+#include "quintain-benchmark-util.h"
+
+static int  work_batch(quintain_provider_handle_t qph,
+                       struct quintain_work_op*   ops,
+                       int                        batch_size,
+                       int                        batch_flags);
+static int  bench_work(struct bench_worker* worker);
+static void bench_worker_ult(void* arg);
+static void bench_worker_adaptive(struct bench_worker* w);
+static int  sample_compare(const void* p1, const void* p2);
+
+int bench_parse_json(const char*          json_file,
+                     int                  nranks,
+                     struct json_object** json_cfg)
+{
+    struct json_tokener*    tokener;
+    enum json_tokener_error jerr;
+    char*                   json_cfg_str = NULL;
+    FILE*                   f;
+    long                    fsize;
+    struct json_object*     val;
+
+    /* open json file */
+    f = fopen(json_file, "r");
+    if (!f) {
+        perror("fopen");
+        fprintf(stderr, "Error: could not open json file %s\n", json_file);
+        return (-1);
+    }
+
+    /* check size */
+    fseek(f, 0, SEEK_END);
+    fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    /* allocate space to hold contents and read it in */
+    json_cfg_str = malloc(fsize + 1);
+    if (!json_cfg_str) {
+        perror("malloc");
+        return (-1);
+    }
+    fread(json_cfg_str, 1, fsize, f);
+    fclose(f);
+    json_cfg_str[fsize] = 0;
+
+    /* parse json */
+    tokener = json_tokener_new();
+    *json_cfg
+        = json_tokener_parse_ex(tokener, json_cfg_str, strlen(json_cfg_str));
+    if (!(*json_cfg)) {
+        jerr = json_tokener_get_error(tokener);
+        fprintf(stderr, "JSON parse error: %s", json_tokener_error_desc(jerr));
+        json_tokener_free(tokener);
+        free(json_cfg_str);
+        return -1;
+    }
+    json_tokener_free(tokener);
+    free(json_cfg_str);
+
+    /* validate input params or fill in defaults */
+    CONFIG_OVERRIDE_INTEGER(*json_cfg, "nranks", nranks, 1);
+
+    /* set defaults if not present */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "provider_id", 1, val);
+    /* target every quintain provider that each server's bedrock
+     * configuration lists, rather than just provider_id
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "discover_providers", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "duration_seconds", 2, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "req_buffer_size", 128, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "resp_buffer_size", 128, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_size", 16384, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, string, "bulk_direction", "pull", val);
+    /* if payload_size is set, it replaces req_buffer_size (or
+     * resp_buffer_size when pushing) and bulk_size: payloads up to
+     * eager_threshold bytes travel inline, larger ones by bulk transfer.
+     * The threshold is a byte count or "auto" to derive it from the eager
+     * buffer size of the transport.
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "payload_size", -1, val);
+    if (!json_object_object_get(*json_cfg, "eager_threshold"))
+        json_object_object_add(*json_cfg, "eager_threshold",
+                               json_object_new_string("auto"));
+    /* 0 means use the provider's default chunking behavior */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_chunk_size", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_pipeline_depth", 0, val);
+    /* number of segments (and distance between them) used to describe the
+     * client's bulk buffer, and number of segments in the server's buffer
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_segments", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_segment_stride", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "server_bulk_segments", 1, val);
+    /* fill and checksum all payloads */
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "verify_payload", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "payload_seed", 0, val);
+    /* extra time the provider waits before carrying out each request, on
+     * top of any faults it is configured to inject
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "fault_delay_usec", 0, val);
+    /* client resilience policy: abandon requests after timeout_ms (0 =
+     * never), retry timed out, refused, or failed requests up to
+     * max_retries times with exponential backoff, and hedge requests that
+     * are slower than hedge_percentile of warm up operations
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "timeout_ms", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "max_retries", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "retry_backoff_ms", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "hedge_percentile", 0, val);
+    /* have the server compress or decompress pulled data: "none",
+     * "compress", or "decompress", and how compressible the data should be
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, string, "compression", "none", val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, double, "compression_ratio", 2.0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "warmup_iterations", 10, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "use_server_poolset", 1, val);
+    /* route every request to the provider's bulk pool regardless of size */
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "bulk_class", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "batch_size", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "batch_concurrent", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "client_threads", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "client_xstreams", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "trace", 1, val);
+    /* throughput and latency per interval, reduced over all clients */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "timeseries_bin_ms", 0, val);
+    /* powercap sysfs tree for client energy measurement */
+    CONFIG_HAS_OR_CREATE(*json_cfg, string, "rapl_root", QTN_RAPL_DEFAULT_ROOT,
+                         val);
+    /* adaptive run length; when enabled duration_seconds is ignored in
+     * favor of steady_state_max_seconds
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "steady_state", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "steady_state_window_ms", 500, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, double, "steady_state_tolerance", 0.05,
+                         val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, double, "steady_state_ci", 0.02, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "steady_state_max_seconds", 60, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, string, "steady_state_metric",
+                         "throughput", val);
+    /* repeated trials, optionally over several configurations that each
+     * override top level parameters
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "trials", 1, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "trial_gap_seconds", 0, val);
+    /* MPI benchmark only: resolve server addresses in waves of this many
+     * ranks rather than all at once (0 = all at once)
+     */
+    CONFIG_HAS_OR_CREATE(*json_cfg, int, "lookup_wave", 0, val);
+    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "randomize_order", 0, val);
+
+    return (0);
+}
+
+long bench_eager_threshold(margo_instance_id mid, hg_bulk_op_t bulk_op)
+{
+    hg_class_t*    hg_class = margo_get_class(mid);
+    qtn_work_in_t  in       = {0};
+    qtn_work_out_t out      = {0};
+    hg_proc_t      proc;
+    char           buf[1024];
+    hg_size_t      eager;
+    hg_size_t      header = 0;
+
+    /* data pushed to the client would travel inline in the response */
+    if (bulk_op == HG_BULK_PUSH)
+        eager = HG_Class_get_output_eager_size(hg_class);
+    else
+        eager = HG_Class_get_input_eager_size(hg_class);
+
+    /* the payload shares the eager buffer with the fixed fields of the
+     * request or response, so measure those by encoding an empty one
+     */
+    in.bulk_handle = HG_BULK_NULL;
+    if (hg_proc_create_set(hg_class, buf, sizeof(buf), HG_ENCODE, HG_NOHASH,
+                           &proc)
+        == HG_SUCCESS) {
+        if (bulk_op == HG_BULK_PUSH)
+            hg_proc_qtn_work_out_t(proc, &out);
+        else
+            hg_proc_qtn_work_in_t(proc, &in);
+        header = hg_proc_get_size_used(proc);
+        hg_proc_free(proc);
+    }
+
+    return eager > header ? (long)(eager - header) : 0;
+}
+
+int bench_workload_init(struct json_object*    json_cfg,
+                        margo_instance_id      mid,
+                        uint64_t               seed_offset,
+                        struct bench_workload* wl)
+{
+    struct quintain_work_info work_info = QTN_WORK_INFO_INITIALIZER;
+    const char*               bulk_direction;
+    const char*               compression;
+    const char*               ss_metric;
+    struct json_object*       val;
+    double                    drop_rate;
+
+    memset(wl, 0, sizeof(*wl));
+
+    wl->req_buffer_size = json_object_get_int(
+        json_object_object_get(json_cfg, "req_buffer_size"));
+    wl->resp_buffer_size = json_object_get_int(
+        json_object_object_get(json_cfg, "resp_buffer_size"));
+    wl->duration_seconds = json_object_get_int(
+        json_object_object_get(json_cfg, "duration_seconds"));
+    wl->warmup_iterations = json_object_get_int(
+        json_object_object_get(json_cfg, "warmup_iterations"));
+    wl->trace_flag
+        = json_object_get_boolean(json_object_object_get(json_cfg, "trace"));
+    if (json_object_get_boolean(
+            json_object_object_get(json_cfg, "use_server_poolset")))
+        wl->work_flags |= QTN_WORK_USE_SERVER_POOLSET;
+    if (json_object_get_boolean(
+            json_object_object_get(json_cfg, "verify_payload")))
+        wl->work_flags |= QTN_WORK_VERIFY_PAYLOAD;
+    if (json_object_get_boolean(json_object_object_get(json_cfg, "bulk_class")))
+        wl->work_flags |= QTN_WORK_BULK_CLASS;
+    wl->bulk_size
+        = json_object_get_int(json_object_object_get(json_cfg, "bulk_size"));
+    work_info.bulk_chunk_size = json_object_get_int64(
+        json_object_object_get(json_cfg, "bulk_chunk_size"));
+    work_info.bulk_pipeline_depth = json_object_get_int(
+        json_object_object_get(json_cfg, "bulk_pipeline_depth"));
+    work_info.bulk_segment_count = json_object_get_int(
+        json_object_object_get(json_cfg, "bulk_segments"));
+    work_info.bulk_segment_stride = json_object_get_int64(
+        json_object_object_get(json_cfg, "bulk_segment_stride"));
+    work_info.server_segment_count = json_object_get_int(
+        json_object_object_get(json_cfg, "server_bulk_segments"));
+    work_info.fault_delay_usec = json_object_get_int(
+        json_object_object_get(json_cfg, "fault_delay_usec"));
+    work_info.timeout_ms = json_object_get_int(
+        json_object_object_get(json_cfg, "timeout_ms"));
+    work_info.max_retries = json_object_get_int(
+        json_object_object_get(json_cfg, "max_retries"));
+    work_info.retry_backoff_ms = json_object_get_int(
+        json_object_object_get(json_cfg, "retry_backoff_ms"));
+    wl->hedge_percentile = json_object_get_int(
+        json_object_object_get(json_cfg, "hedge_percentile"));
+    /* give each client a distinct payload pattern */
+    work_info.payload_seed = json_object_get_int64(json_object_object_get(
+                                 json_cfg, "payload_seed"))
+                           + seed_offset;
+    wl->work_info = work_info;
+
+    bulk_direction = json_object_get_string(
+        json_object_object_get(json_cfg, "bulk_direction"));
+    if (!strcmp("pull", bulk_direction))
+        wl->bulk_op = HG_BULK_PULL;
+    else if (!strcmp("push", bulk_direction))
+        wl->bulk_op = HG_BULK_PUSH;
+    else {
+        fprintf(stderr,
+                "Error: invalid bulk_direction parameter: %s (must be push or "
+                "pull).\n",
+                bulk_direction);
+        return -1;
+    }
+    wl->payload_size = json_object_get_int64(
+        json_object_object_get(json_cfg, "payload_size"));
+    if (wl->payload_size >= 0) {
+        val = json_object_object_get(json_cfg, "eager_threshold");
+        if (json_object_is_type(val, json_type_int))
+            wl->eager_threshold = json_object_get_int64(val);
+        else if (json_object_is_type(val, json_type_string)
+                 && !strcmp(json_object_get_string(val), "auto"))
+            wl->eager_threshold = bench_eager_threshold(mid, wl->bulk_op);
+        else {
+            fprintf(stderr,
+                    "Error: invalid eager_threshold parameter (must be a "
+                    "byte count or \"auto\").\n");
+            return -1;
+        }
+        bench_payload_route(wl);
+    }
+    compression = json_object_get_string(
+        json_object_object_get(json_cfg, "compression"));
+    wl->compression_ratio = json_object_get_double(
+        json_object_object_get(json_cfg, "compression_ratio"));
+    if (!strcmp(compression, "compress"))
+        wl->work_flags |= QTN_WORK_COMPRESS;
+    else if (!strcmp(compression, "decompress"))
+        wl->work_flags |= QTN_WORK_DECOMPRESS;
+    else if (strcmp(compression, "none")) {
+        fprintf(stderr,
+                "Error: invalid compression parameter: %s (must be none, "
+                "compress, or decompress).\n",
+                compression);
+        return -1;
+    }
+    if ((wl->work_flags & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS))
+        && (wl->bulk_op != HG_BULK_PULL || wl->bulk_size <= 0
+            || (wl->work_flags & QTN_WORK_VERIFY_PAYLOAD))) {
+        fprintf(stderr,
+                "Error: compression requires pulled bulk data and cannot be "
+                "combined with verify_payload.\n");
+        return -1;
+    }
+    if (work_info.server_segment_count > 1 && work_info.bulk_chunk_size > 0
+        && wl->bulk_size > 0
+        && (hg_size_t)wl->bulk_size > work_info.bulk_chunk_size) {
+        fprintf(stderr,
+                "Error: server_bulk_segments > 1 cannot be combined with "
+                "chunked transfers (bulk_chunk_size).\n");
+        return -1;
+    }
+    if ((wl->work_flags & QTN_WORK_DECOMPRESS)
+        && work_info.bulk_segment_count > 1) {
+        fprintf(stderr,
+                "Error: decompress requires a contiguous bulk buffer.\n");
+        return -1;
+    }
+    /* compressed payloads are described to the server by their
+     * uncompressed size
+     */
+    if (wl->work_flags & QTN_WORK_DECOMPRESS)
+        wl->work_info.raw_size = wl->bulk_size;
+    wl->batch_size
+        = json_object_get_int(json_object_object_get(json_cfg, "batch_size"));
+    if (json_object_get_boolean(
+            json_object_object_get(json_cfg, "batch_concurrent")))
+        wl->batch_flags |= QTN_BATCH_CONCURRENT;
+    if (wl->batch_size < 1) {
+        fprintf(stderr, "Error: batch_size must be at least 1.\n");
+        return -1;
+    }
+    wl->nthreads = json_object_get_int(
+        json_object_object_get(json_cfg, "client_threads"));
+    wl->use_xstreams = json_object_get_boolean(
+        json_object_object_get(json_cfg, "client_xstreams"));
+    if (wl->nthreads < 1) {
+        fprintf(stderr, "Error: client_threads must be at least 1.\n");
+        return -1;
+    }
+    wl->ts_bin_seconds
+        = json_object_get_int(
+              json_object_object_get(json_cfg, "timeseries_bin_ms"))
+        / 1000.0;
+    if (wl->ts_bin_seconds < 0) {
+        fprintf(stderr, "Error: timeseries_bin_ms must not be negative.\n");
+        return -1;
+    }
+    wl->steady_state = json_object_get_boolean(
+        json_object_object_get(json_cfg, "steady_state"));
+    wl->ss_window_seconds
+        = json_object_get_int(
+              json_object_object_get(json_cfg, "steady_state_window_ms"))
+        / 1000.0;
+    wl->ss_tolerance = json_object_get_double(
+        json_object_object_get(json_cfg, "steady_state_tolerance"));
+    wl->ss_ci_threshold = json_object_get_double(
+        json_object_object_get(json_cfg, "steady_state_ci"));
+    wl->ss_max_seconds = json_object_get_int(
+        json_object_object_get(json_cfg, "steady_state_max_seconds"));
+    ss_metric = json_object_get_string(
+        json_object_object_get(json_cfg, "steady_state_metric"));
+    if (!strcmp(ss_metric, "throughput"))
+        wl->ss_metric = BENCH_SS_THROUGHPUT;
+    else if (!strcmp(ss_metric, "median"))
+        wl->ss_metric = BENCH_SS_MEDIAN;
+    else {
+        fprintf(stderr,
+                "Error: invalid steady_state_metric parameter: %s (must be "
+                "throughput or median).\n",
+                ss_metric);
+        return -1;
+    }
+    if (wl->steady_state
+        && (wl->ss_window_seconds <= 0
+            || wl->ss_max_seconds < wl->ss_window_seconds)) {
+        fprintf(stderr,
+                "Error: steady_state_window_ms must be positive and no "
+                "longer than steady_state_max_seconds.\n");
+        return -1;
+    }
+    if (wl->batch_size > 1
+        && ((wl->work_flags & ~QTN_WORK_USE_SERVER_POOLSET)
+            || work_info.bulk_segment_count > 1
+            || work_info.bulk_chunk_size > 0)) {
+        fprintf(stderr,
+                "Error: batch_size > 1 cannot be combined with "
+                "verify_payload, compression, bulk_class, segmented or "
+                "chunked transfers.\n");
+        return -1;
+    }
+    if (wl->batch_size > 1
+        && (work_info.timeout_ms > 0 || work_info.max_retries > 0
+            || wl->hedge_percentile)) {
+        fprintf(stderr,
+                "Error: timeout_ms, max_retries, and hedge_percentile are not "
+                "supported with batch_size > 1.\n");
+        return -1;
+    }
+    /* a client waits forever for a response that the provider dropped */
+    drop_rate = json_object_get_double(json_object_object_get(
+        json_object_object_get(
+            json_object_object_get(json_cfg, "server_config"),
+            "fault_injection"),
+        "drop_rate"));
+    if (drop_rate > 0 && work_info.timeout_ms <= 0) {
+        fprintf(stderr,
+                "Error: fault_injection drop_rate requires timeout_ms.\n");
+        return -1;
+    }
+    if (wl->hedge_percentile < 0 || wl->hedge_percentile >= 100
+        || (wl->hedge_percentile && wl->warmup_iterations < 1)) {
+        fprintf(stderr,
+                "Error: hedge_percentile must be between 0 and 99 and "
+                "requires warmup_iterations.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+void bench_payload_route(struct bench_workload* wl)
+{
+    int  inline_payload = wl->payload_size <= wl->eager_threshold;
+    int* inline_size    = wl->bulk_op == HG_BULK_PUSH ? &wl->resp_buffer_size
+                                                      : &wl->req_buffer_size;
+
+    *inline_size  = inline_payload ? wl->payload_size : 0;
+    wl->bulk_size = inline_payload ? 0 : wl->payload_size;
+}
+
+int bench_client_init(struct bench_client*         bc,
+                      const struct bench_workload* wl,
+                      quintain_provider_handle_t   qph,
+                      quintain_provider_handle_t   hedge_qph,
+                      double*                      samples,
+                      int                          max_samples)
+{
+    int bulk_size = wl->bulk_size;
+    int k, i;
+    int ret;
+
+    memset(bc, 0, sizeof(*bc));
+    bc->wl        = wl;
+    bc->samples   = samples;
+    bc->hedge_qph = hedge_qph;
+
+    /* Allocate a bulk buffer (if bulk_size > 0) to reuse in all _work()
+     * calls.  Note that we do not expliclitly register it for RDMA here;
+     * that will be handled within the _work() call as needed.
+     */
+    if (bulk_size > 0) {
+        size_t bulk_buffer_size = bulk_size;
+        /* a strided, multi-segment layout may need a larger buffer than
+         * the number of bytes actually transferred
+         */
+        if (wl->work_info.bulk_segment_count > 1
+            && wl->work_info.bulk_segment_stride
+                   > bulk_size / wl->work_info.bulk_segment_count)
+            bulk_buffer_size = (wl->work_info.bulk_segment_count - 1)
+                                 * wl->work_info.bulk_segment_stride
+                             + bulk_size / wl->work_info.bulk_segment_count
+                             + bulk_size % wl->work_info.bulk_segment_count;
+        bc->bulk_buffer     = malloc(bulk_buffer_size);
+        bc->bulk_buffer_len = bulk_buffer_size;
+        if (!bc->bulk_buffer) {
+            perror("malloc");
+            return -1;
+        }
+        /* if the server will compress the payload, generate data that
+         * compresses by the requested ratio
+         */
+        if (wl->work_flags & QTN_WORK_COMPRESS)
+            qtn_payload_fill_compressible(bc->bulk_buffer, bulk_buffer_size,
+                                          wl->work_info.payload_seed,
+                                          wl->compression_ratio);
+    }
+    bc->raw_size  = bulk_size;
+    bc->wire_size = bulk_size;
+
+    /* if the server will decompress the payload, compress it once up front
+     * and send the compressed stream in every request
+     */
+    if (wl->work_flags & QTN_WORK_DECOMPRESS) {
+        void*  raw_buffer = bc->bulk_buffer;
+        uLongf zlib_size  = compressBound(bulk_size);
+
+        bc->bulk_buffer = malloc(zlib_size);
+        if (!bc->bulk_buffer) {
+            perror("malloc");
+            free(raw_buffer);
+            return -1;
+        }
+        qtn_payload_fill_compressible(raw_buffer, bulk_size,
+                                      wl->work_info.payload_seed,
+                                      wl->compression_ratio);
+        ret = compress2(bc->bulk_buffer, &zlib_size, raw_buffer, bulk_size,
+                        Z_DEFAULT_COMPRESSION);
+        free(raw_buffer);
+        if (ret != Z_OK) {
+            fprintf(stderr, "Error: compress2() failure: (%d)\n", ret);
+            return -1;
+        }
+        bc->wire_size       = zlib_size;
+        bc->bulk_buffer_len = zlib_size;
+    }
+
+    /* in batch mode each operation in a batch gets its own region of a
+     * larger bulk buffer
+     */
+    if (wl->batch_size > 1) {
+        bc->batch_ops = calloc((size_t)wl->nthreads * wl->batch_size,
+                               sizeof(*bc->batch_ops));
+        if (bc->bulk_buffer) free(bc->bulk_buffer);
+        bc->bulk_buffer_len
+            = bulk_size > 0 ? (size_t)bulk_size * wl->batch_size : 0;
+        bc->bulk_buffer
+            = bc->bulk_buffer_len ? malloc(bc->bulk_buffer_len) : NULL;
+        if (!bc->batch_ops || (bc->bulk_buffer_len && !bc->bulk_buffer)) {
+            perror("malloc");
+            return -1;
+        }
+    }
+
+    /* set up one worker per client thread.  Each worker has its own sample
+     * storage and its own copy of the bulk buffer so that pushed data from
+     * concurrent operations does not overlap.
+     */
+    bc->workers = calloc(wl->nthreads, sizeof(*bc->workers));
+    if (!bc->workers) {
+        perror("calloc");
+        return -1;
+    }
+
+    /* time series bins cover the longest the run can last, plus one for
+     * the operation that crosses the end.  Slot 0 holds the client totals.
+     */
+    if (wl->ts_bin_seconds > 0) {
+        double run_seconds
+            = wl->steady_state ? wl->ss_max_seconds : wl->duration_seconds;
+
+        if (run_seconds / wl->ts_bin_seconds > 1024 * 1024) {
+            fprintf(stderr, "Error: timeseries_bin_ms is too small for the "
+                            "length of the run.\n");
+            return -1;
+        }
+        bc->nbins = (int)ceil(run_seconds / wl->ts_bin_seconds) + 1;
+        bc->bins  = calloc((size_t)(wl->nthreads + 1) * bc->nbins,
+                           sizeof(*bc->bins));
+        if (!bc->bins) {
+            perror("calloc");
+            return -1;
+        }
+    }
+    for (k = 0; k < wl->nthreads; k++) {
+        struct bench_worker* w = &bc->workers[k];
+
+        w->wl               = wl;
+        w->qph              = qph;
+        w->req_buffer_size  = wl->req_buffer_size;
+        w->resp_buffer_size = wl->resp_buffer_size;
+        w->wire_size        = bc->wire_size;
+        w->bulk_op          = wl->bulk_op;
+        w->bulk_buffer      = bc->bulk_buffer;
+        w->work_flags       = wl->work_flags;
+        w->work_info        = wl->work_info;
+        w->batch_size       = wl->batch_size;
+        w->batch_flags      = wl->batch_flags;
+        w->duration_seconds = wl->duration_seconds;
+        /* per-operation outcome, accumulated by bench_work() */
+        w->work_info.outcome = &w->outcome;
+
+        w->samples     = samples + (size_t)k * (max_samples / wl->nthreads);
+        w->max_samples = max_samples / wl->nthreads;
+        /* payload bytes moved by each accepted sample */
+        w->op_bytes = (long)(wl->req_buffer_size + wl->resp_buffer_size
+                             + bc->wire_size)
+                    * wl->batch_size;
+        if (bc->bins) {
+            w->bins  = &bc->bins[(size_t)(k + 1) * bc->nbins];
+            w->nbins = bc->nbins;
+        }
+        if (k > 0 && bc->bulk_buffer) {
+            w->bulk_buffer = malloc(bc->bulk_buffer_len);
+            if (!w->bulk_buffer) {
+                perror("malloc");
+                return -1;
+            }
+            memcpy(w->bulk_buffer, bc->bulk_buffer, bc->bulk_buffer_len);
+        }
+        if (wl->batch_size > 1) {
+            w->batch_ops = &bc->batch_ops[(size_t)k * wl->batch_size];
+            for (i = 0; i < wl->batch_size; i++) {
+                w->batch_ops[i].req_buffer_size  = wl->req_buffer_size;
+                w->batch_ops[i].resp_buffer_size = wl->resp_buffer_size;
+                w->batch_ops[i].bulk_size = bulk_size > 0 ? bulk_size : 0;
+                w->batch_ops[i].bulk_op   = wl->bulk_op;
+                w->batch_ops[i].bulk_buffer
+                    = w->bulk_buffer
+                        ? (char*)w->bulk_buffer + (size_t)i * bulk_size
+                        : NULL;
+                w->batch_ops[i].flags = wl->work_flags;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void bench_client_destroy(struct bench_client* bc)
+{
+    int k;
+
+    if (bc->workers) {
+        for (k = 1; k < bc->wl->nthreads; k++)
+            if (bc->workers[k].bulk_buffer != bc->bulk_buffer)
+                free(bc->workers[k].bulk_buffer);
+        free(bc->workers);
+    }
+    free(bc->batch_ops);
+    free(bc->bulk_buffer);
+    free(bc->bins);
+    memset(bc, 0, sizeof(*bc));
+}
+
+int bench_client_warmup(struct bench_client* bc)
+{
+    const struct bench_workload* wl        = bc->wl;
+    struct bench_worker*         w0        = &bc->workers[0];
+    double*                      latencies = NULL;
+    double                       ts;
+    int                          ret       = 0;
+    int                          i, k;
+
+    if (wl->hedge_percentile && bc->hedge_qph != QTN_PROVIDER_HANDLE_NULL) {
+        latencies = malloc(wl->warmup_iterations * sizeof(*latencies));
+        if (!latencies) {
+            perror("malloc");
+            return -1;
+        }
+    }
+
+    for (i = 0; i < wl->warmup_iterations; i++) {
+        ts  = ABT_get_wtime();
+        ret = bench_work(w0);
+        if (latencies) latencies[i] = ABT_get_wtime() - ts;
+        if (ret == QTN_ERR_INTEGRITY) {
+            bc->integrity_errors++;
+        } else if (ret != QTN_SUCCESS && ret != QTN_ERR_BUSY) {
+            fprintf(stderr, "Error: quintain_work() failure: (%d)\n", ret);
+            goto finish;
+        }
+    }
+    ret = 0;
+
+    /* hedge operations that take longer than the chosen percentile of
+     * warm up latencies
+     */
+    if (latencies) {
+        qsort(latencies, wl->warmup_iterations, sizeof(double),
+              sample_compare);
+        bc->hedge_delay_ms
+            = latencies[wl->warmup_iterations * wl->hedge_percentile / 100]
+            * 1e3;
+        for (k = 0; k < wl->nthreads; k++) {
+            bc->workers[k].work_info.hedge_provider = bc->hedge_qph;
+            bc->workers[k].work_info.hedge_delay_ms = bc->hedge_delay_ms;
+        }
+    }
+
+    /* the resilience counters only cover the measurement */
+    w0->rpcs       = 0;
+    w0->timeouts   = 0;
+    w0->retries    = 0;
+    w0->hedges     = 0;
+    w0->hedge_wins = 0;
+    w0->failures   = 0;
+
+finish:
+    free(latencies);
+    return ret;
+}
+
+int bench_client_run(struct bench_client* bc)
+{
+    const struct bench_workload* wl        = bc->wl;
+    ABT_thread*                  threads   = NULL;
+    ABT_xstream*                 xstreams  = NULL;
+    ABT_pool                     pool      = ABT_POOL_NULL;
+    int                          nthreads  = wl->nthreads;
+    int                          nxstreams = 0;
+    int                          ret       = 0;
+    int                          k;
+
+    /* a single client thread runs inline on the caller; otherwise each
+     * worker gets its own ULT, either all on one dedicated execution
+     * stream or each on its own.  The margo handler pool is not used
+     * because it may be the primary pool, which never runs while the
+     * caller blocks outside of Argobots (as a loadgen pthread does).
+     */
+    if (nthreads > 1 || wl->use_xstreams) {
+        nxstreams = wl->use_xstreams ? nthreads : 1;
+        threads   = calloc(nthreads, sizeof(*threads));
+        xstreams  = calloc(nxstreams, sizeof(*xstreams));
+        if (!threads || !xstreams) {
+            perror("calloc");
+            ret = -1;
+            goto finish;
+        }
+    }
+
+    bc->start_ts = ABT_get_wtime();
+    for (k = 0; k < nthreads; k++) {
+        bc->workers[k].start_ts = bc->start_ts;
+        bc->workers[k].bins_ts
+            = bc->ts_origin > 0 ? bc->ts_origin : bc->start_ts;
+    }
+
+    if (!threads) {
+        bench_worker_ult(&bc->workers[0]);
+    } else {
+        for (k = 0; k < nthreads; k++) {
+            if (k < nxstreams) {
+                ret = ABT_pool_create_basic(ABT_POOL_FIFO_WAIT,
+                                            ABT_POOL_ACCESS_MPMC, ABT_TRUE,
+                                            &pool);
+                if (ret == ABT_SUCCESS)
+                    ret = ABT_xstream_create_basic(ABT_SCHED_BASIC_WAIT, 1,
+                                                   &pool, ABT_SCHED_CONFIG_NULL,
+                                                   &xstreams[k]);
+                if (ret != ABT_SUCCESS) {
+                    fprintf(stderr, "Error: ABT_xstream_create_basic()\n");
+                    break;
+                }
+            }
+            ret = ABT_thread_create(pool, bench_worker_ult, &bc->workers[k],
+                                    ABT_THREAD_ATTR_NULL, &threads[k]);
+            if (ret != ABT_SUCCESS) {
+                fprintf(stderr, "Error: ABT_thread_create()\n");
+                break;
+            }
+        }
+        /* wait for whatever was started, even after a failure */
+        for (k = 0; k < nthreads; k++)
+            if (threads[k] != ABT_THREAD_NULL) ABT_thread_free(&threads[k]);
+        for (k = 0; k < nxstreams; k++) {
+            if (xstreams[k] != ABT_XSTREAM_NULL) {
+                ABT_xstream_join(xstreams[k]);
+                ABT_xstream_free(&xstreams[k]);
+            }
+        }
+        if (ret != ABT_SUCCESS) goto finish;
+    }
+
+    /* combine the counters of all workers */
+    for (k = 0; k < nthreads; k++) {
+        if (bc->workers[k].ret != QTN_SUCCESS) {
+            fprintf(stderr, "Error: quintain_work() failure: (%d)\n",
+                    bc->workers[k].ret);
+            ret = bc->workers[k].ret;
+            goto finish;
+        }
+        bc->sample_index += bc->workers[k].sample_index;
+        bc->busy_rejections += bc->workers[k].busy_rejections;
+        bc->integrity_errors += bc->workers[k].integrity_errors;
+        bc->elapsed += bc->workers[k].elapsed;
+        bc->rpcs += bc->workers[k].rpcs;
+        bc->timeouts += bc->workers[k].timeouts;
+        bc->retries += bc->workers[k].retries;
+        bc->hedges += bc->workers[k].hedges;
+        bc->hedge_wins += bc->workers[k].hedge_wins;
+        bc->failures += bc->workers[k].failures;
+        if (bc->bins)
+            bench_timeseries_merge(bc->bins, bc->workers[k].bins, bc->nbins);
+    }
+    bc->elapsed /= nthreads;
+
+    /* payload bytes before and after compression moved by this client */
+    bc->raw_bytes = (double)(bc->sample_index - bc->busy_rejections)
+                  * (double)bc->raw_size;
+    bc->wire_bytes = (double)(bc->sample_index - bc->busy_rejections)
+                   * (double)bc->wire_size;
+
+finish:
+    free(threads);
+    free(xstreams);
+    return ret;
+}
+
+void bench_client_write_trace(const struct bench_client* bc,
+                              gzFile                     f,
+                              int                        rank)
+{
+    double this_ts, elapsed;
+    int    i, k;
+
+    gzprintf(f, "start_timestamp\t%f\n", bc->start_ts);
+    gzprintf(f, "# sample_trace\t<rank>\t<start>\t<end>\t<elapsed>\n");
+    if (bc->busy_rejections)
+        gzprintf(f, "# rejected_trace\t<rank>\t<start>\t<end>\t<elapsed>\n");
+    for (k = 0; k < bc->wl->nthreads; k++) {
+        const double* w_samples = bc->workers[k].samples;
+
+        this_ts = 0;
+        for (i = 0; i < bc->workers[k].sample_index
+                    && i < bc->workers[k].max_samples;
+             i++) {
+            elapsed = w_samples[i] < 0 ? -w_samples[i] : w_samples[i];
+            gzprintf(f, "%s\t%d\t%.9f\t%.9f\t%.9f\n",
+                     w_samples[i] < 0 ? "rejected_trace" : "sample_trace", rank,
+                     this_ts, (this_ts + elapsed), elapsed);
+            this_ts += elapsed;
+        }
+    }
+}
+
+void bench_client_stats(struct bench_client*      bc,
+                        struct sample_statistics* stats)
+{
+    double* samples   = bc->samples;
+    int     naccepted = 0;
+    int     i, k;
+
+    memset(stats, 0, sizeof(*stats));
+
+    /* only successful operations count toward ops/s, and each sample
+     * covers a whole batch.  Workers may have measured for different
+     * lengths of time in steady state mode, so sum their rates.
+     */
+    for (k = 0; k < bc->wl->nthreads; k++)
+        if (bc->workers[k].elapsed > 0)
+            stats->ops_per_sec += (double)(bc->workers[k].sample_index
+                                           - bc->workers[k].busy_rejections)
+                                * (double)bc->wl->batch_size
+                                / bc->workers[k].elapsed;
+
+    /* gather the recorded samples of all workers at the front of the
+     * sample array, dropping rejected requests from the latency statistics
+     */
+    for (k = 0; k < bc->wl->nthreads; k++) {
+        double* w_samples = bc->workers[k].samples;
+        int     w_count
+            = bc->workers[k].sample_index < bc->workers[k].max_samples
+                ? bc->workers[k].sample_index
+                : bc->workers[k].max_samples;
+        for (i = 0; i < w_count; i++)
+            if (w_samples[i] >= 0) samples[naccepted++] = w_samples[i];
+    }
+    qsort(samples, naccepted, sizeof(double), sample_compare);
+    /* there should be a lot of samples; we aren't going to bother
+     * interpolating between points if there isn't a precise sample for the
+     * medians or quartiles
+     */
+    if (naccepted > 0) {
+        stats->min    = samples[0];
+        stats->q1     = samples[naccepted / 4];
+        stats->median = samples[naccepted / 2];
+        stats->q3     = samples[3 * (naccepted / 4)];
+        stats->max    = samples[naccepted - 1];
+        stats->p99    = samples[(int)((long)naccepted * 99 / 100)];
+        for (i = 0; i < naccepted; i++) stats->mean += samples[i];
+        stats->mean /= (double)naccepted;
+    }
+}
+
+void bench_client_write_stats(const struct bench_client*      bc,
+                              const struct sample_statistics* stats,
+                              double                          cpu_seconds,
+                              gzFile                          f,
+                              int                             rank)
+{
+    const struct bench_workload* wl       = bc->wl;
+    double                       duration = bc->elapsed;
+    int                          k;
+
+    if (wl->payload_size >= 0) {
+        gzprintf(f,
+                 "# payload_route\t<rank>\t<payload_size>\t"
+                 "<eager_threshold>\t<transport>\n");
+        gzprintf(f, "payload_route\t%d\t%ld\t%ld\t%s\n", rank,
+                 wl->payload_size, wl->eager_threshold,
+                 wl->bulk_size ? "bulk" : "inline");
+    }
+
+    gzprintf(f,
+             "# admission_stats\t<rank>\t<rejected>\t<rejected/s>\t"
+             "<offered_ops/s>\n");
+    gzprintf(f, "admission_stats\t%d\t%ld\t%.3f\t%.3f\n", rank,
+             bc->busy_rejections, (double)bc->busy_rejections / duration,
+             stats->ops_per_sec + (double)bc->busy_rejections / duration);
+    if (wl->nthreads > 1) {
+        gzprintf(f,
+                 "# thread_stats\t<rank>\t<thread>\t<ops>\t<rejected>\t"
+                 "<ops/s>\n");
+        for (k = 0; k < wl->nthreads; k++)
+            gzprintf(f, "thread_stats\t%d\t%d\t%d\t%ld\t%.3f\n", rank, k,
+                     bc->workers[k].sample_index,
+                     bc->workers[k].busy_rejections,
+                     (double)(bc->workers[k].sample_index
+                              - bc->workers[k].busy_rejections)
+                         * (double)wl->batch_size / bc->workers[k].elapsed);
+    }
+    if (wl->steady_state) {
+        gzprintf(f,
+                 "# steady_state\t<rank>\t<thread>\t<warmup_s>\t"
+                 "<measured_s>\t<windows>\t<rel_ci>\t<converged>\n");
+        for (k = 0; k < wl->nthreads; k++)
+            gzprintf(f, "steady_state\t%d\t%d\t%.3f\t%.3f\t%d\t%.6f\t%d\n",
+                     rank, k, bc->workers[k].warmup_seconds,
+                     bc->workers[k].elapsed, bc->workers[k].windows,
+                     bc->workers[k].rel_ci, bc->workers[k].converged);
+    }
+    if (wl->batch_size > 1) {
+        gzprintf(f,
+                 "# batch_stats\t<rank>\t<batch_size>\t<ops/s>\t<rpcs/s>\t"
+                 "<client_cpu_us/op>\t<failed_batches>\n");
+        gzprintf(f, "batch_stats\t%d\t%d\t%.3f\t%.3f\t%.3f\t%ld\n", rank,
+                 wl->batch_size, stats->ops_per_sec,
+                 stats->ops_per_sec / (double)wl->batch_size,
+                 stats->ops_per_sec
+                     ? cpu_seconds * 1e6 / (stats->ops_per_sec * duration)
+                     : 0.0,
+                 bc->failures);
+    }
+    if (wl->work_info.timeout_ms > 0 || wl->work_info.max_retries > 0
+        || wl->hedge_percentile || bc->failures) {
+        long ops = (long)(bc->sample_index - bc->busy_rejections);
+
+        /* extra_load is the fraction of additional requests that timeouts,
+         * retries, and hedging put on the providers; with batches, ops and
+         * rpcs count batches
+         */
+        gzprintf(f,
+                 "# resilience_stats\t<rank>\t<ops>\t<rpcs>\t<timeouts>\t"
+                 "<retries>\t<hedges>\t<hedge_wins>\t<hedge_delay_ms>\t"
+                 "<failed>\t<extra_load>\n");
+        gzprintf(f,
+                 "resilience_stats\t%d\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%.3f\t"
+                 "%ld\t%.6f\n",
+                 rank, ops, bc->rpcs, bc->timeouts, bc->retries, bc->hedges,
+                 bc->hedge_wins, bc->hedge_delay_ms, bc->failures,
+                 ops ? (double)bc->rpcs / (double)ops - 1.0 : 0.0);
+    }
+    if (wl->work_flags & QTN_WORK_VERIFY_PAYLOAD) {
+        gzprintf(f, "# integrity_stats\t<rank>\t<errors>\n");
+        gzprintf(f, "integrity_stats\t%d\t%ld\n", rank, bc->integrity_errors);
+    }
+    if (wl->work_flags & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS)) {
+        /* effective bandwidth counts uncompressed bytes, wire bandwidth
+         * counts the bytes actually transferred
+         */
+        gzprintf(f,
+                 "# compression_stats\t<rank>\t<raw_bytes>\t<wire_bytes>\t"
+                 "<effective_MiB/s>\t<wire_MiB/s>\t<client_cpu_ns/byte>\n");
+        gzprintf(f, "compression_stats\t%d\t%.0f\t%.0f\t%.3f\t%.3f\t%.6f\n",
+                 rank, bc->raw_bytes, bc->wire_bytes,
+                 bc->raw_bytes / (1024.0 * 1024.0) / duration,
+                 bc->wire_bytes / (1024.0 * 1024.0) / duration,
+                 bc->raw_bytes ? cpu_seconds * 1e9 / bc->raw_bytes : 0.0);
+    }
+}
+
+/* asks the bedrock daemon at address for the ids of its quintain providers.
+ * Returns a json array, or NULL on failure.
+ */
+static struct json_object* query_provider_ids(bedrock_client_t bcl,
+                                              const char*      address)
+{
+    const char* script
+        = "$ids = [];\n"
+          "foreach ($__config__.providers as $p) {\n"
+          "    if ($p.type == \"quintain\") {\n"
+          "        array_push($ids, $p.provider_id);\n"
+          "    }\n"
+          "}\n"
+          "return $ids;";
+    bedrock_service_t   bsh = NULL;
+    struct json_object* ids = NULL;
+    char*               str = NULL;
+
+    if (bedrock_service_handle_create(bcl, address, 0, &bsh)
+        != BEDROCK_SUCCESS) {
+        fprintf(stderr, "Error: bedrock_service_handle_create() failure.\n");
+        return NULL;
+    }
+    str = bedrock_service_query_config(bsh, script);
+    bedrock_service_handle_destroy(bsh);
+    if (!str) {
+        fprintf(stderr, "Error: bedrock_service_query_config() failure.\n");
+        return NULL;
+    }
+    ids = json_tokener_parse(str);
+    free(str);
+    if (!ids || !json_object_is_type(ids, json_type_array)) {
+        fprintf(stderr, "Error: unexpected provider list from %s\n",
+                address);
+        if (ids) json_object_put(ids);
+        return NULL;
+    }
+
+    return ids;
+}
+
+int bench_find_targets(bedrock_client_t          bcl,
+                       const flock_group_view_t* group_view,
+                       int                       provider_id,
+                       struct bench_target**     targets,
+                       int*                      ntargets)
+{
+    int                  nmembers = flock_group_view_member_count(group_view);
+    struct json_object** ids      = NULL;
+    struct bench_target* list     = NULL;
+    size_t               total    = 0;
+    size_t               most     = 1;
+    size_t               n, j;
+    int                  m;
+    int                  ret      = -1;
+
+    *targets  = NULL;
+    *ntargets = 0;
+
+    ids = calloc(nmembers, sizeof(*ids));
+    if (!ids) {
+        perror("calloc");
+        return -1;
+    }
+    if (bcl) {
+        for (m = 0; m < nmembers; m++) {
+            ids[m] = query_provider_ids(bcl,
+                                        group_view->members.data[m].address);
+            if (!ids[m]) goto finish;
+            n = json_object_array_length(ids[m]);
+            if (n == 0) {
+                fprintf(stderr, "Error: no quintain provider at %s\n",
+                        group_view->members.data[m].address);
+                goto finish;
+            }
+            if (n > most) most = n;
+            total += n;
+        }
+    } else {
+        total = nmembers;
+    }
+
+    list = calloc(total, sizeof(*list));
+    if (!list) {
+        perror("calloc");
+        goto finish;
+    }
+    n = 0;
+    for (j = 0; j < most; j++) {
+        for (m = 0; m < nmembers; m++) {
+            if (ids[m] && j >= json_object_array_length(ids[m])) continue;
+            list[n].address     = group_view->members.data[m].address;
+            list[n].member      = m;
+            list[n].provider_id = provider_id;
+            if (ids[m])
+                list[n].provider_id = json_object_get_int(
+                    json_object_array_get_idx(ids[m], j));
+            n++;
+        }
+    }
+    *targets  = list;
+    *ntargets = total;
+    ret       = 0;
+
+finish:
+    for (m = 0; m < nmembers; m++)
+        if (ids[m]) json_object_put(ids[m]);
+    free(ids);
+    return ret;
+}
+
+int bench_apply_server_config(margo_instance_id          mid,
+                              quintain_client_t          qcl,
+                              const struct bench_target* targets,
+                              int                        ntargets,
+                              struct json_object*        update)
+{
+    const char*                update_str;
+    hg_addr_t                  addr;
+    quintain_provider_handle_t qph;
+    int                        i;
+    int                        ret;
+
+    update_str = json_object_to_json_string_ext(update, JSON_C_TO_STRING_PLAIN);
+
+    for (i = 0; i < ntargets; i++) {
+        ret = margo_addr_lookup(mid, targets[i].address, &addr);
+        if (ret != HG_SUCCESS) {
+            fprintf(stderr, "Error: margo_addr_lookup()\n");
+            return -1;
+        }
+        ret = quintain_provider_handle_create(qcl, addr, targets[i].provider_id,
+                                              &qph);
+        if (ret != QTN_SUCCESS) {
+            fprintf(stderr,
+                    "Error: quintain_provider_handle_create() failure.\n");
+            margo_addr_free(mid, addr);
+            return -1;
+        }
+        ret = quintain_set_config(qph, update_str);
+        quintain_provider_handle_release(qph);
+        margo_addr_free(mid, addr);
+        if (ret != QTN_SUCCESS) {
+            fprintf(stderr, "Error: quintain_set_config() failure: (%d)\n",
+                    ret);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int bench_local_stat(double* utime_sec, double* stime_sec, double* alltime_sec)
+{
+    struct rusage usage;
+    int           ret;
+
+    ret = getrusage(RUSAGE_SELF, &usage);
+    if (ret != 0) {
+        perror("getrusage");
+        return (-1);
+    }
+
+    *utime_sec = (double)usage.ru_utime.tv_sec
+               + (double)usage.ru_utime.tv_usec / (double)1E6L;
+    *stime_sec = (double)usage.ru_stime.tv_sec
+               + (double)usage.ru_stime.tv_usec / (double)1E6L;
+    *alltime_sec = *utime_sec + *stime_sec;
+
+    return (0);
+}
+
+/* issues one operation (or one batch of operations) for a worker.  An
+ * operation (or batch) that still times out or fails with an injected error
+ * once its retries are exhausted is counted as a failure rather than ending
+ * the run; its latency is recorded like any other.
+ */
+static int bench_work(struct bench_worker* w)
+{
+    int ret;
+
+    if (w->batch_size > 1) {
+        ret = work_batch(w->qph, w->batch_ops, w->batch_size, w->batch_flags);
+        w->rpcs++;
+    } else {
+        ret = quintain_work_ext(w->qph, w->req_buffer_size,
+                                w->resp_buffer_size, w->wire_size, w->bulk_op,
+                                w->bulk_buffer, w->work_flags, &w->work_info);
+        w->rpcs += w->outcome.attempts + w->outcome.hedges;
+        w->timeouts += w->outcome.timeouts;
+        w->retries += w->outcome.attempts ? w->outcome.attempts - 1 : 0;
+        w->hedges += w->outcome.hedges;
+        w->hedge_wins += w->outcome.hedge_won;
+    }
+    if (ret == QTN_ERR_TIMEOUT || ret == QTN_ERR_INJECTED) {
+        w->failures++;
+        ret = QTN_SUCCESS;
+    }
+    return ret;
+}
+
+/* adds one operation that ended at ts (relative to the origin of the time
+ * series) to the time series
+ */
+static inline void timeseries_record(struct bench_worker* w,
+                                     double               ts,
+                                     double               elapsed,
+                                     int                  ret)
+{
+    struct bench_timebin* bin;
+    unsigned long         usec;
+    int                   bucket;
+    int                   idx = (int)(ts / w->wl->ts_bin_seconds);
+
+    if (idx < 0) idx = 0;
+    if (idx >= w->nbins) idx = w->nbins - 1;
+    bin = &w->bins[idx];
+    if (ret == QTN_ERR_BUSY) {
+        bin->rejected++;
+        return;
+    }
+    bin->ops++;
+    bin->bytes += w->op_bytes;
+    usec   = (unsigned long)(elapsed * 1e6);
+    bucket = usec ? 64 - __builtin_clzl(usec) : 0;
+    if (bucket >= BENCH_HIST_BUCKETS) bucket = BENCH_HIST_BUCKETS - 1;
+    bin->hist[bucket]++;
+}
+
+/* measurement loop for one worker; runs until the configured duration has
+ * elapsed since the common start time
+ */
+static void bench_worker_ult(void* arg)
+{
+    struct bench_worker* w       = arg;
+    double               prev_ts = 0;
+    double               this_ts;
+    int                  ret;
+
+    if (w->wl->steady_state) {
+        bench_worker_adaptive(w);
+        return;
+    }
+
+    do {
+        ret = bench_work(w);
+        /* payload verification failures and requests rejected by the
+         * provider's admission control are counted rather than treated as
+         * fatal, so that a run can report how often they occur
+         */
+        if (ret == QTN_ERR_INTEGRITY) {
+            w->integrity_errors++;
+        } else if (ret == QTN_ERR_BUSY) {
+            w->busy_rejections++;
+        } else if (ret != QTN_SUCCESS) {
+            w->ret = ret;
+            return;
+        }
+        this_ts = ABT_get_wtime() - w->start_ts;
+        /* save just the elapsed time; we can reconstruct start and end
+         * timestamps later since this is a tight loop.  Rejected requests
+         * are recorded as negative values.
+         */
+        if (w->sample_index < w->max_samples)
+            w->samples[w->sample_index]
+                = (ret == QTN_ERR_BUSY) ? prev_ts - this_ts : this_ts - prev_ts;
+        if (w->bins)
+            timeseries_record(w, w->start_ts + this_ts - w->bins_ts,
+                              this_ts - prev_ts, ret);
+        prev_ts = this_ts;
+        w->sample_index++;
+    } while (this_ts < w->duration_seconds);
+    w->elapsed = w->duration_seconds;
+}
+
+/* returns the median latency of the accepted samples in [first, last) of a
+ * worker.  scratch must have room for last - first values.
+ */
+static double window_median(const struct bench_worker* w,
+                            int                        first,
+                            int                        last,
+                            double*                    scratch)
+{
+    int n = 0;
+    int i;
+
+    /* only the latencies of retained samples are known */
+    if (last > w->max_samples) last = w->max_samples;
+    for (i = first; i < last; i++)
+        if (w->samples[i] >= 0) scratch[n++] = w->samples[i];
+    qsort(scratch, n, sizeof(double), sample_compare);
+
+    return n ? scratch[n / 2] : 0;
+}
+
+/* measurement loop for one worker in steady state mode.  Operations are
+ * grouped into fixed-length windows.  Warm up ends when the throughput and
+ * median latency of two consecutive windows agree within the tolerance;
+ * samples taken up to that point are discarded.  Measurement then ends when
+ * the 95% confidence interval of the per-window target metric is within
+ * the threshold (relative to its mean), or when the maximum duration has
+ * elapsed since the worker started.
+ */
+static void bench_worker_adaptive(struct bench_worker* w)
+{
+    const struct bench_workload* wl           = w->wl;
+    double                       deadline;
+    double                       window_ts    = w->start_ts;
+    double                       prev_ts      = 0;
+    double                       prev_tput    = 0, prev_median = 0;
+    double                       tput, median, now, this_ts;
+    double*                      values       = NULL;
+    double*                      scratch      = NULL;
+    size_t                       scratch_n    = 0;
+    int                          max_windows;
+    int                          window_first = 0;
+    int                          window_busy  = 0;
+    int                          measuring    = 0;
+    int                          n, i, ret;
+
+    deadline    = w->start_ts + wl->ss_max_seconds;
+    max_windows = (int)(wl->ss_max_seconds / wl->ss_window_seconds) + 1;
+    values      = calloc(max_windows, sizeof(*values));
+    if (!values) {
+        w->ret = QTN_ERR_ALLOCATION;
+        return;
+    }
+
+    do {
+        ret = bench_work(w);
+        if (ret == QTN_ERR_INTEGRITY) {
+            w->integrity_errors++;
+        } else if (ret == QTN_ERR_BUSY) {
+            w->busy_rejections++;
+        } else if (ret != QTN_SUCCESS) {
+            w->ret = ret;
+            break;
+        }
+        now     = ABT_get_wtime();
+        this_ts = now - w->start_ts;
+        if (w->sample_index < w->max_samples)
+            w->samples[w->sample_index]
+                = (ret == QTN_ERR_BUSY) ? prev_ts - this_ts : this_ts - prev_ts;
+        if (w->bins)
+            timeseries_record(w, now - w->bins_ts, this_ts - prev_ts, ret);
+        prev_ts = this_ts;
+        w->sample_index++;
+
+        if (now - window_ts < wl->ss_window_seconds) continue;
+
+        /* close the current window */
+        if ((size_t)(w->sample_index - window_first) > scratch_n) {
+            scratch_n = w->sample_index - window_first;
+            free(scratch);
+            scratch = malloc(scratch_n * sizeof(*scratch));
+            if (!scratch) {
+                w->ret = QTN_ERR_ALLOCATION;
+                break;
+            }
+        }
+        median = window_median(w, window_first, w->sample_index, scratch);
+        /* count completed operations from the counters rather than from the
+         * retained samples, which run out after max_samples
+         */
+        n    = (w->sample_index - window_first)
+             - (w->busy_rejections - window_busy);
+        tput = (double)n * (double)w->batch_size / (now - window_ts);
+
+        if (!measuring) {
+            if (prev_tput > 0 && prev_median > 0
+                && fabs(tput - prev_tput) / prev_tput < wl->ss_tolerance
+                && fabs(median - prev_median) / prev_median
+                       < wl->ss_tolerance) {
+                /* converged; restart the measurement from here.  The time
+                 * series keeps its common origin, so it shows the warm up
+                 * as well.
+                 */
+                measuring           = 1;
+                w->warmup_seconds   = now - w->start_ts;
+                w->start_ts         = now;
+                w->sample_index     = 0;
+                w->busy_rejections  = 0;
+                w->integrity_errors = 0;
+                w->rpcs             = 0;
+                w->timeouts         = 0;
+                w->retries          = 0;
+                w->hedges           = 0;
+                w->hedge_wins       = 0;
+                w->failures         = 0;
+                prev_ts             = 0;
+            }
+            prev_tput   = tput;
+            prev_median = median;
+        } else if (w->windows < max_windows) {
+            double mean = 0, var = 0;
+
+            values[w->windows++]
+                = (wl->ss_metric == BENCH_SS_MEDIAN) ? median : tput;
+            for (i = 0; i < w->windows; i++) mean += values[i];
+            mean /= w->windows;
+            /* need a few windows before the interval means anything */
+            if (w->windows >= 3 && mean > 0) {
+                for (i = 0; i < w->windows; i++)
+                    var += (values[i] - mean) * (values[i] - mean);
+                var /= (w->windows - 1);
+                w->rel_ci = bench_t95(w->windows - 1) * sqrt(var / w->windows)
+                          / mean;
+                if (w->rel_ci < wl->ss_ci_threshold) w->converged = 1;
+            }
+        }
+        window_ts    = now;
+        window_first = w->sample_index;
+        window_busy  = w->busy_rejections;
+    } while (!w->converged && now < deadline);
+
+    /* if steady state was never reached then the whole run counts as the
+     * measurement
+     */
+    w->elapsed = ABT_get_wtime() - w->start_ts;
+    if (!measuring) w->warmup_seconds = 0;
+
+    free(scratch);
+    free(values);
+}
+
+void bench_timeseries_merge(struct bench_timebin*       dst,
+                            const struct bench_timebin* src,
+                            int                         nbins)
+{
+    const long* s = (const long*)src;
+    long*       d = (long*)dst;
+    size_t      i;
+
+    for (i = 0; i < (size_t)nbins * BENCH_TIMEBIN_LONGS; i++) d[i] += s[i];
+}
+
+/* upper bound, in microseconds, of the bucket holding the given quantile */
+static long hist_quantile(const struct bench_timebin* bin, double q)
+{
+    long target = (long)ceil(q * bin->ops);
+    long seen   = 0;
+    int  i;
+
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += bin->hist[i];
+        if (seen >= target) break;
+    }
+    return 1L << (i < BENCH_HIST_BUCKETS ? i : BENCH_HIST_BUCKETS - 1);
+}
+
+void bench_timeseries_write(const struct bench_timebin* bins,
+                            int                         nbins,
+                            double                      bin_seconds,
+                            gzFile                      f)
+{
+    int last = nbins - 1;
+    int i, k;
+
+    while (last >= 0 && !bins[last].ops && !bins[last].rejected) last--;
+
+    /* latencies are histogram bucket upper bounds in microseconds */
+    gzprintf(f,
+             "# timeseries\t<bin>\t<start_s>\t<ops>\t<rejected>\t<ops/s>\t"
+             "<MiB/s>\t<p50_us>\t<p99_us>\t<max_us>\t<log2_us_hist>\n");
+    for (i = 0; i <= last; i++) {
+        const struct bench_timebin* bin = &bins[i];
+
+        gzprintf(f,
+                 "timeseries\t%d\t%.3f\t%ld\t%ld\t%.3f\t%.3f\t%ld\t%ld\t%ld\t",
+                 i, i * bin_seconds, bin->ops, bin->rejected,
+                 bin->ops / bin_seconds,
+                 bin->bytes / bin_seconds / (1024.0 * 1024.0),
+                 bin->ops ? hist_quantile(bin, 0.5) : 0,
+                 bin->ops ? hist_quantile(bin, 0.99) : 0,
+                 bin->ops ? hist_quantile(bin, 1.0) : 0);
+        for (k = 0; k < BENCH_HIST_BUCKETS; k++)
+            gzprintf(f, "%ld%s", bin->hist[k],
+                     k < BENCH_HIST_BUCKETS - 1 ? "," : "\n");
+    }
+}
+
+void bench_write_energy(gzFile f,
+                        double cli_joules,
+                        double svr_joules,
+                        double ops,
+                        double seconds)
+{
+    gzprintf(f,
+             "# energy_stats\t<client_joules>\t<server_joules>\t<ops>\t"
+             "<client_J/op>\t<server_J/op>\t<client_W>\t<server_W>\n");
+    gzprintf(f, "energy_stats\t%.6f\t%.6f\t%.0f\t%.9f\t%.9f\t%.3f\t%.3f\n",
+             cli_joules, svr_joules, ops,
+             (cli_joules >= 0 && ops > 0) ? cli_joules / ops : -1.0,
+             (svr_joules >= 0 && ops > 0) ? svr_joules / ops : -1.0,
+             (cli_joules >= 0 && seconds > 0) ? cli_joules / seconds : -1.0,
+             (svr_joules >= 0 && seconds > 0) ? svr_joules / seconds : -1.0);
+}
+
+void bench_write_server_perf(struct json_object* svr_config, gzFile f)
+{
+    struct json_object* providers;
+    struct json_object* prov;
+    struct json_object* report = NULL;
+    struct json_object* total;
+    struct json_object* work;
+    const char*         type;
+    size_t              i;
+    int64_t             t, w;
+
+    providers = json_object_object_get(svr_config, "providers");
+    if (!providers || !json_object_is_type(providers, json_type_array))
+        return;
+    for (i = 0; i < json_object_array_length(providers) && !report; i++) {
+        prov = json_object_array_get_idx(providers, i);
+        type = json_object_get_string(json_object_object_get(prov, "type"));
+        if (type && !strcmp(type, "quintain"))
+            report = json_object_object_get(
+                json_object_object_get(prov, "config"), "xstream_stats_report");
+    }
+    if (!report) return;
+
+    /* times and counters are cumulative since each xstream was first seen;
+     * idle and "other" include progress, other RPC handlers, and waiting
+     */
+    gzprintf(f, "# server_xstream\t<xstream>\t<role>\t<counters>\t<wall_s>\t"
+                "<busy_s>\t<idle_s>\t<cpu_s>\n");
+    json_object_object_foreach(report, xstream, obj)
+    {
+        gzprintf(
+            f, "server_xstream\t%s\t%s\t%s\t%.6f\t%.6f\t%.6f\t%.6f\n", xstream,
+            json_object_get_string(json_object_object_get(obj, "role")),
+            json_object_get_string(json_object_object_get(obj, "counters")),
+            json_object_get_double(json_object_object_get(obj, "wall_seconds")),
+            json_object_get_double(json_object_object_get(obj, "busy_seconds")),
+            json_object_get_double(json_object_object_get(obj, "idle_seconds")),
+            json_object_get_double(json_object_object_get(obj, "cpu_seconds")));
+    }
+    gzprintf(f, "# server_perf\t<xstream>\t<counter>\t<total>\t<work>\t"
+                "<other>\n");
+    json_object_object_foreach(report, xs, xs_obj)
+    {
+        total = json_object_object_get(xs_obj, "total");
+        work  = json_object_object_get(xs_obj, "work");
+        if (!total) continue;
+        json_object_object_foreach(total, counter, val)
+        {
+            t = json_object_get_int64(val);
+            w = json_object_get_int64(json_object_object_get(work, counter));
+            gzprintf(f, "server_perf\t%s\t%s\t%lld\t%lld\t%lld\n", xs, counter,
+                     (long long)t, (long long)w, (long long)(t - w));
+        }
+    }
+}
+
+double bench_t95(int df)
+{
+    static const double t[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    if (df < 1) return 0;
+    if (df <= 30) return t[df - 1];
+    return 1.960;
+}
+
+/* issues one batch of operations and folds the per-operation results into a
+ * single return code (the first failure, if any)
+ */
+static int work_batch(quintain_provider_handle_t qph,
+                      struct quintain_work_op*   ops,
+                      int                        batch_size,
+                      int                        batch_flags)
+{
+    int ret;
+    int i;
+
+    ret = quintain_work_batch(qph, batch_size, ops, batch_flags);
+    if (ret != QTN_SUCCESS) return ret;
+    for (i = 0; i < batch_size; i++)
+        if (ops[i].ret != QTN_SUCCESS) return ops[i].ret;
+
+    return QTN_SUCCESS;
+}
+
+static int sample_compare(const void* p1, const void* p2)
+{
+    double d1 = *((double*)p1);
+    double d2 = *((double*)p2);
+
+    if (d1 > d2) return 1;
+    if (d1 < d2) return -1;
+    return 0;
+}
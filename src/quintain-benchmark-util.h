@@ -0,0 +1,312 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __QUINTAIN_BENCHMARK_UTIL
+#define __QUINTAIN_BENCHMARK_UTIL
+
+#include <zlib.h>
+#include <json-c/json.h>
+#include <margo.h>
+#include <quintain-client.h>
+#include <flock/flock-group-view.h>
+
+#include "bedrock-c-wrapper.h"
+
+/* Workload generation and reporting shared by the benchmark drivers.  The
+ * MPI benchmark runs one bench_client per rank; the standalone load
+ * generator runs several of them in one process.  Neither MPI nor any
+ * particular threading package is assumed here.
+ */
+
+/* record up to 32 million (power of 2) samples.  This will take 256 MiB of RAM
+ * per rank */
+#define MAX_SAMPLES (32 * 1024 * 1024)
+
+struct sample_statistics {
+    double min;
+    double q1;
+    double median;
+    double q3;
+    double max;
+    double mean;
+    double ops_per_sec;
+    double p99;
+};
+
+/* latency histogram buckets in a time series bin.  Bucket 0 counts
+ * operations under 1 microsecond and bucket i counts those in
+ * [2^(i-1), 2^i) microseconds; the last bucket also counts anything slower.
+ */
+#define BENCH_HIST_BUCKETS 24
+
+/* one fixed-width interval of the time series.  Only longs, so that bins
+ * can be reduced across ranks as a flat array.
+ */
+struct bench_timebin {
+    long ops;
+    long rejected;
+    long bytes;
+    long hist[BENCH_HIST_BUCKETS];
+};
+#define BENCH_TIMEBIN_LONGS (sizeof(struct bench_timebin) / sizeof(long))
+
+/* workload parameters taken from the benchmark json configuration */
+struct bench_workload {
+    int                       req_buffer_size;
+    int                       resp_buffer_size;
+    int                       bulk_size;
+    hg_bulk_op_t              bulk_op;
+    int                       work_flags;
+    struct quintain_work_info work_info;
+    double                    compression_ratio;
+    int                       batch_size;
+    int                       batch_flags;
+    int                       nthreads;
+    int                       use_xstreams;
+    int                       duration_seconds;
+    int                       warmup_iterations;
+    int                       trace_flag;
+    /* adaptive ("steady_state") mode: measurement starts once windowed
+     * throughput and median latency converge, and stops once the 95%
+     * confidence interval of the target metric is narrow enough
+     */
+    int                       steady_state;
+    double                    ss_window_seconds;
+    double                    ss_tolerance;
+    double                    ss_ci_threshold;
+    double                    ss_max_seconds;
+    int                       ss_metric;
+    /* width of time series bins, 0 if disabled */
+    double                    ts_bin_seconds;
+    /* "payload_size" mode: bytes moved per operation (-1 if disabled) and
+     * the largest payload that is sent inline rather than by bulk transfer
+     */
+    long                      payload_size;
+    long                      eager_threshold;
+    /* send a duplicate of an operation to a second provider once it has
+     * taken longer than this percentile of warm up latencies (0 = never)
+     */
+    int                       hedge_percentile;
+};
+
+/* one quintain provider that clients can send load to */
+struct bench_target {
+    const char* address;     /* points into the group view */
+    int         member;      /* index of the server in the group view */
+    uint16_t    provider_id;
+};
+
+/* metrics that can be targeted by steady state detection */
+enum bench_ss_metric { BENCH_SS_THROUGHPUT, BENCH_SS_MEDIAN };
+
+/* state for one load generating ULT within a client */
+struct bench_worker {
+    const struct bench_workload*     wl;
+    quintain_provider_handle_t       qph;
+    int                              req_buffer_size;
+    int                              resp_buffer_size;
+    hg_size_t                        wire_size;
+    hg_bulk_op_t                     bulk_op;
+    void*                            bulk_buffer;
+    int                              work_flags;
+    struct quintain_work_info        work_info;
+    struct quintain_work_op*         batch_ops;
+    int                              batch_size;
+    int                              batch_flags;
+    int                              duration_seconds;
+    double                           start_ts;
+    double*                          samples;
+    int                              max_samples;
+    int                              sample_index;
+    long                             integrity_errors;
+    long                             busy_rejections;
+    int                              ret;
+    struct bench_timebin*            bins;
+    int                              nbins;
+    double                           bins_ts; /* origin of the time series */
+    long                             op_bytes;
+    /* measured time, and in steady state mode the time spent reaching
+     * steady state, the number of windows measured, and the relative
+     * half-width of the confidence interval that was reached
+     */
+    double                           elapsed;
+    double                           warmup_seconds;
+    int                              windows;
+    double                           rel_ci;
+    int                              converged;
+    /* resilience counters: requests sent (including retries and hedges),
+     * timed out requests, retries, hedges sent and won, and operations that
+     * failed for good with QTN_ERR_TIMEOUT or QTN_ERR_INJECTED
+     */
+    struct quintain_work_outcome     outcome;
+    long                             rpcs;
+    long                             timeouts;
+    long                             retries;
+    long                             hedges;
+    long                             hedge_wins;
+    long                             failures;
+};
+
+/* one independent source of load (an MPI rank in quintain-benchmark) and
+ * the combined results of its workers
+ */
+struct bench_client {
+    const struct bench_workload* wl;
+    struct bench_worker*         workers;
+    struct quintain_work_op*     batch_ops;
+    void*                        bulk_buffer;
+    size_t                       bulk_buffer_len;
+    hg_size_t                    raw_size;
+    hg_size_t                    wire_size;
+    double*                      samples;
+    double                       start_ts;
+    double                       elapsed;
+    int                          sample_index;
+    long                         integrity_errors;
+    long                         busy_rejections;
+    double                       raw_bytes;
+    double                       wire_bytes;
+    /* time series summed over workers (NULL if disabled), and the instant
+     * its bins count from, which the caller may set to a time common to
+     * all clients before bench_client_run() (0 = the start of the run)
+     */
+    struct bench_timebin*        bins;
+    int                          nbins;
+    double                       ts_origin;
+    /* hedging target and the delay derived from warm up latencies */
+    quintain_provider_handle_t   hedge_qph;
+    double                       hedge_delay_ms;
+    long                         rpcs;
+    long                         timeouts;
+    long                         retries;
+    long                         hedges;
+    long                         hedge_wins;
+    long                         failures;
+};
+
+/* reads a benchmark configuration and fills in defaults; nranks is recorded
+ * in the configuration as the number of clients generating load
+ */
+int bench_parse_json(const char*          json_file,
+                     int                  nranks,
+                     struct json_object** json_cfg);
+
+/* extracts and validates the workload parameters of a configuration.
+ * seed_offset distinguishes the payloads of different clients; mid is used
+ * to resolve an "auto" eager_threshold.
+ */
+int bench_workload_init(struct json_object*    json_cfg,
+                        margo_instance_id      mid,
+                        uint64_t               seed_offset,
+                        struct bench_workload* wl);
+
+/* returns the largest payload that fits in an eager RPC buffer alongside
+ * the rest of a work request (or, when pushing, a work response)
+ */
+long bench_eager_threshold(margo_instance_id mid, hg_bulk_op_t bulk_op);
+
+/* sets the request (or response) buffer and bulk sizes of a payload_size
+ * workload: payloads up to eager_threshold go inline, larger ones by bulk
+ */
+void bench_payload_route(struct bench_workload* wl);
+
+/* sets up the buffers and workers of a client targeting qph.  hedge_qph
+ * receives duplicate requests if the workload hedges.  samples has room for
+ * max_samples values and is split among the workers.
+ */
+int  bench_client_init(struct bench_client*         bc,
+                       const struct bench_workload* wl,
+                       quintain_provider_handle_t   qph,
+                       quintain_provider_handle_t   hedge_qph,
+                       double*                      samples,
+                       int                          max_samples);
+void bench_client_destroy(struct bench_client* bc);
+
+/* issues the configured number of warm up operations, and picks the hedge
+ * delay from their latencies if the workload hedges
+ */
+int bench_client_warmup(struct bench_client* bc);
+
+/* runs the measurement loop of every worker to completion, each in its own
+ * ULT on dedicated execution streams if the workload calls for more than
+ * one, and combines their counters
+ */
+int bench_client_run(struct bench_client* bc);
+
+/* writes the sample_trace and rejected_trace lines of a client */
+void bench_client_write_trace(const struct bench_client* bc,
+                              gzFile                     f,
+                              int                        rank);
+
+/* computes latency statistics from the samples of a client.  This reorders
+ * the samples, so traces must be written first.
+ */
+void bench_client_stats(struct bench_client*      bc,
+                        struct sample_statistics* stats);
+
+/* writes the per-client statistics lines that follow client_stats.
+ * cpu_seconds is the client CPU time attributed to this client.
+ */
+void bench_client_write_stats(const struct bench_client*      bc,
+                              const struct sample_statistics* stats,
+                              double                          cpu_seconds,
+                              gzFile                          f,
+                              int                             rank);
+
+/* adds the time series bins of src into dst */
+void bench_timeseries_merge(struct bench_timebin*       dst,
+                            const struct bench_timebin* src,
+                            int                         nbins);
+
+/* writes a timeseries line for each bin up to the last non-empty one */
+void bench_timeseries_write(const struct bench_timebin* bins,
+                            int                         nbins,
+                            double                      bin_seconds,
+                            gzFile                      f);
+
+/* writes the energy_stats line for a measurement window.  Energies are in
+ * joules and are -1 where unavailable; ops is the number of operations
+ * completed by all clients in the window.
+ */
+void bench_write_energy(gzFile f,
+                        double cli_joules,
+                        double svr_joules,
+                        double ops,
+                        double seconds);
+
+/* writes server_xstream (and server_perf) lines for the per-xstream
+ * statistics found in the configuration of the first quintain provider in
+ * a bedrock configuration, if it has any
+ */
+void bench_write_server_perf(struct json_object* svr_config, gzFile f);
+
+/* two-sided 95% Student's t quantile for df degrees of freedom */
+double bench_t95(int df);
+
+/* lists the quintain providers of every server in the group.  If bcl is
+ * not NULL, each server's bedrock daemon is asked for its providers of type
+ * "quintain"; otherwise every server is assumed to run provider_id alone.
+ * Targets are interleaved across servers (the first provider of each
+ * server, then the second, and so on) so that clients assigned round robin
+ * spread across servers before doubling up on one.  The caller frees
+ * *targets.
+ */
+int bench_find_targets(bedrock_client_t          bcl,
+                       const flock_group_view_t* group_view,
+                       int                       provider_id,
+                       struct bench_target**     targets,
+                       int*                      ntargets);
+
+/* sends a runtime configuration update to every target provider */
+int bench_apply_server_config(margo_instance_id          mid,
+                              quintain_client_t          qcl,
+                              const struct bench_target* targets,
+                              int                        ntargets,
+                              struct json_object*        update);
+
+int bench_local_stat(double* utime_sec, double* stime_sec, double* alltime_sec);
+
+#endif /* __QUINTAIN_BENCHMARK_UTIL */
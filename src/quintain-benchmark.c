@@ -18,6 +18,9 @@
 #include <unistd.h>
 #include <zlib.h>
 #include <sys/resource.h>
+#include <time.h>
+#include <math.h>
+#include <stddef.h>
 
 #include <json-c/json.h>
 #include <mpi.h>
@@ -28,83 +31,150 @@
 #include <flock/flock-group.h>
 
 #include "quintain-macros.h"
+#include "quintain-benchmark-util.h"
+#include "quintain-rapl.h"
 #include "bedrock-c-wrapper.h"
 
-/* record up to 32 million (power of 2) samples.  This will take 256 MiB of RAM
- * per rank */
-#define MAX_SAMPLES (32 * 1024 * 1024)
-
 struct options {
     char group_file[256];
     char json_file[256];
     char output_file[256];
 };
 
-struct sample_statistics {
-    double min;
-    double q1;
-    double median;
-    double q3;
-    double max;
-    double mean;
-    double ops_per_sec;
-};
-
 static int  parse_args(int                  argc,
                        char**               argv,
                        struct options*      opts,
                        struct json_object** json_cfg);
 static void usage(void);
-static int  sample_compare(const void* p1, const void* p2);
-static int
-local_stat(double* utime_sec, double* stime_sec, double* alltime_sec);
+
+/* what each trial needs from the benchmark setup */
+struct trial_env {
+    margo_instance_id          mid;
+    quintain_provider_handle_t qph;
+    quintain_provider_handle_t hedge_qph;
+    int                        my_rank;
+    int                        nranks;
+    int                        svr_idx;
+    const char*                svr_addr_str;
+    int                        provider_id;
+    double*                    samples;
+    gzFile                     f;
+    struct qtn_rapl*           rapl; /* only on one rank per node */
+};
+
+/* headline results of one trial, combined across ranks on rank 0:
+ * aggregate throughput and the mean of the per-rank latency percentiles
+ */
+struct trial_result {
+    double ops_per_sec;
+    double median;
+    double q3;
+    double p99;
+
+    /* the rest only appears in the summary file */
+    double q1;
+    double mean;
+    double min;            /* fastest operation on any rank */
+    double max;            /* slowest operation on any rank */
+    double ops;            /* operations completed by all ranks */
+    double rejected;       /* operations refused by admission control */
+    double seconds;        /* measured time */
+    double warmup_seconds; /* warm up time of the slowest rank */
+    double client_cpu;     /* client CPU seconds summed over ranks */
+    double server_cpu;     /* CPU seconds of the first server */
+};
+
+static int  run_trial(const struct trial_env* env,
+                      struct json_object*     json_cfg,
+                      struct trial_result*    res);
+static void write_trial_summary(gzFile                     f,
+                                int                        config,
+                                const struct trial_result* res,
+                                int                        trials);
+
+static struct json_object* payload_sweep_configs(struct json_object* sweep);
+static int server_config_baseline(bedrock_service_t    bsh,
+                                  int                  provider_id,
+                                  struct json_object*  json_cfg,
+                                  struct json_object*  configs,
+                                  struct json_object** baseline);
+
+static int write_summary(const char*                path,
+                         struct json_object*        json_cfg,
+                         struct json_object*        configs,
+                         const struct trial_result* results,
+                         int                        nconfigs,
+                         int                        trials,
+                         int                        nranks,
+                         int                        ntargets,
+                         const double*              startup);
+
+static int bcast_group_view(flock_group_view_t* view, int my_rank);
+static int wtime_is_global(MPI_Comm comm);
+static int bcast_targets(const flock_group_view_t* view,
+                         struct bench_target**     targets,
+                         int*                      ntargets,
+                         int                       my_rank);
+
+static void write_payload_sweep(gzFile                     f,
+                                struct json_object*        configs,
+                                const struct trial_result* res,
+                                int                        trials,
+                                long                       auto_threshold);
 
 int main(int argc, char** argv)
 {
     int                        nranks, nproviders, my_rank;
     int                        ret;
     flock_group_view_t         group_view      = FLOCK_GROUP_VIEW_INITIALIZER;
-    char*                      svr_addr_str    = NULL;
+    const char*                svr_addr_str    = NULL;
     char                       proto[64]       = {0};
     char*                      svr_cfg_str_raw = NULL;
     char*                      cli_cfg_str     = NULL;
     margo_instance_id          mid             = MARGO_INSTANCE_NULL;
     quintain_client_t          qcl             = QTN_CLIENT_NULL;
     quintain_provider_handle_t qph             = QTN_PROVIDER_HANDLE_NULL;
+    quintain_provider_handle_t hedge_qph       = QTN_PROVIDER_HANDLE_NULL;
     flock_group_handle_t       fh              = FLOCK_GROUP_HANDLE_NULL;
     bedrock_client_t           bcl             = NULL;
     flock_client_t             fcl             = FLOCK_CLIENT_NULL;
     bedrock_service_t          bsh             = NULL;
     hg_addr_t                  svr_addr        = HG_ADDR_NULL;
+    hg_addr_t                  hedge_addr      = HG_ADDR_NULL;
     struct options             opts;
     struct json_object*        json_cfg;
-    int req_buffer_size, resp_buffer_size, duration_seconds, warmup_iterations,
-        bulk_size;
-    hg_bulk_op_t             bulk_op;
-    double                   this_ts, prev_ts, start_ts;
-    double*                  samples;
-    int                      sample_index = 0;
-    gzFile                   f            = NULL;
-    char                     rank_file[300];
-    int                      i;
-    int                      trace_flag   = 0;
-    struct sample_statistics stats        = {0};
-    void*                    bulk_buffer  = NULL;
-    int                      work_flags   = 0;
-    struct margo_init_info   mii          = {0};
-    struct json_object*      margo_config = NULL;
-    struct json_object*      svr_config   = NULL;
-    double                   svr_utime1, svr_stime1, svr_alltime1;
-    double                   svr_utime2, svr_stime2, svr_alltime2;
-    double                   svr_utime, svr_stime, svr_alltime;
-    double                   cli_utime1, cli_stime1, cli_alltime1;
-    double                   cli_utime2, cli_stime2, cli_alltime2;
-    double                   cli_utime, cli_stime, cli_alltime;
-    int                      provider_id = -1;
+    double*                    samples         = NULL;
+    gzFile                     f               = NULL;
+    char                       rank_file[300];
+    char                       summary_file[300];
+    int                        i;
+    struct margo_init_info     mii             = {0};
+    struct json_object*        margo_config    = NULL;
+    struct json_object*        svr_config      = NULL;
+    int                        provider_id     = -1;
+    struct bench_target*       targets         = NULL;
+    int                        ntargets        = 0;
+    const struct bench_target* target;
+    const struct bench_target* hedge;
+    int                        lookup_wave;
+    double                     start_ts;
+    double                     startup[2]; /* max and sum across ranks */
+    struct json_object*        configs;
+    struct json_object*        sweep;
+    struct json_object*        sweep_configs   = NULL;
+    struct json_object*        server_baseline = NULL;
+    int                        nconfigs, trials, trial_gap, nslots;
+    int*                       order           = NULL;
+    struct trial_result*       results         = NULL;
+    struct trial_env           env;
+    MPI_Comm                   node_comm       = MPI_COMM_NULL;
+    int                        node_rank;
+    struct qtn_rapl            rapl            = {0};
 
     MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &nranks);
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    start_ts = MPI_Wtime();
 
     ret = parse_args(argc, argv, &opts, &json_cfg);
     if (ret < 0) {
@@ -114,19 +184,27 @@ int main(int argc, char** argv)
     /* file name for intermediate results from this rank */
     sprintf(rank_file, "%s.%d", opts.output_file, my_rank);
 
-    /* load the Flock group view */
-    flock_return_t fret
-        = flock_group_view_from_file(opts.group_file, &group_view);
-    if (fret != FLOCK_SUCCESS) {
-        fprintf(stderr, "Error: flock_group_view_from_file(): %d.\n", fret);
-        goto err_mpi_cleanup;
-    }
+    /* Only rank 0 reads the group file and talks to the group and its
+     * bedrock daemons.  The other ranks learn the transport, and later the
+     * group view and the list of providers, by broadcast so that startup
+     * does not cost every server an RPC from every rank.
+     */
+    if (my_rank == 0) {
+        flock_return_t fret
+            = flock_group_view_from_file(opts.group_file, &group_view);
+        if (fret != FLOCK_SUCCESS) {
+            fprintf(stderr, "Error: flock_group_view_from_file(): %d.\n",
+                    fret);
+            ret = -1;
+            goto err_mpi_cleanup;
+        }
 
-    /* find transport to initialize margo to match provider */
-    svr_addr_str = group_view.members.data[0].address;
-    provider_id  = group_view.members.data[0].provider_id;
-    for (int i = 0; i < 64 && svr_addr_str[i] != ':'; ++i)
-        proto[i] = svr_addr_str[i];
+        /* find transport to initialize margo to match provider */
+        svr_addr_str = group_view.members.data[0].address;
+        for (int i = 0; i < 63 && svr_addr_str[i] != ':'; ++i)
+            proto[i] = svr_addr_str[i];
+    }
+    MPI_Bcast(proto, sizeof(proto), MPI_CHAR, 0, MPI_COMM_WORLD);
 
     /* If there is a "margo" section in the json configuration, then
      * serialize it into a string to pass to margo_init_ext().
@@ -140,77 +218,104 @@ int main(int argc, char** argv)
         fprintf(stderr, "Error: failed to initialize margo with %s protocol.\n",
                 proto);
         ret = -1;
-        goto err_flock_cleanup;
+        goto err_view_cleanup;
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    if (my_rank == 0) {
+        /* initialize a Flock client and refresh the view in case it
+         * diverges from what was in the initial group file
+         */
+        ret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
+        if (ret != HG_SUCCESS) {
+            fprintf(stderr, "Error: margo_addr_lookup()\n");
+            goto err_margo_cleanup;
+        }
 
-    /* initialize a Flock client and refresh the view in case it diverges
-     * from what was in the initial group file
-     */
-    ret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
-    if (ret != HG_SUCCESS) {
-        fprintf(stderr, "Error: margo_addr_lookup()\n");
-        goto err_margo_cleanup;
-    }
+        ret = flock_client_init(mid, ABT_POOL_NULL, &fcl);
+        if (ret != FLOCK_SUCCESS) {
+            fprintf(stderr, "Error: flock_client_init() failure, ret: %d.\n",
+                    ret);
+            goto err_flock_cleanup;
+        }
 
-    ret = flock_client_init(mid, ABT_POOL_NULL, &fcl);
-    if (ret != FLOCK_SUCCESS) {
-        fprintf(stderr, "Error: flock_client_init() failure, ret: %d.\n", ret);
-        goto err_flock_cleanup;
-    }
+        ret = flock_group_handle_create(
+            fcl, svr_addr, group_view.members.data[0].provider_id, true, &fh);
+        if (ret != FLOCK_SUCCESS) {
+            fprintf(stderr,
+                    "Error: flock_group_handle_create() failure, ret: %d.\n",
+                    ret);
+            goto err_flock_cleanup;
+        }
 
-    ret = flock_group_handle_create(fcl, svr_addr, provider_id, true, &fh);
-    if (ret != FLOCK_SUCCESS) {
-        fprintf(stderr,
-                "Error: flock_group_handle_create() failure, ret: %d.\n", ret);
-        goto err_flock_cleanup;
-    }
+        ret = flock_group_update_view(fh, NULL);
+        if (ret != FLOCK_SUCCESS) {
+            fprintf(stderr,
+                    "Error: flock_group_update_view() failure, ret: %d.\n",
+                    ret);
+            goto err_flock_cleanup;
+        }
 
-    ret = flock_group_update_view(fh, NULL);
-    if (ret != FLOCK_SUCCESS) {
-        fprintf(stderr, "Error: flock_group_update_view() failure, ret: %d.\n",
-                ret);
-        goto err_flock_cleanup;
-    }
+        ret = flock_group_get_view(fh, &group_view);
+        if (ret != FLOCK_SUCCESS) {
+            fprintf(stderr,
+                    "Error: flock_group_get_view() failure, ret: %d.\n", ret);
+            goto err_flock_cleanup;
+        }
+        margo_addr_free(mid, svr_addr);
+        svr_addr = HG_ADDR_NULL;
 
-    ret = flock_group_get_view(fh, &group_view);
-    if (ret != FLOCK_SUCCESS) {
-        fprintf(stderr, "Error: flock_group_get_view() failure, ret: %d.\n",
-                ret);
-        goto err_flock_cleanup;
-    }
+        if (flock_group_view_member_count(&group_view) == 0) {
+            fprintf(stderr, "Error: flock group has no members.\n");
+            ret = -1;
+            goto err_flock_cleanup;
+        }
 
-    /* get the number of providers */
-    nproviders = flock_group_view_member_count(&group_view);
-    if (nproviders == 0) {
-        fprintf(stderr, "Error: flock group has no members.\n");
-        goto err_flock_cleanup;
-    }
+        ret = bedrock_client_init(mid, &bcl);
+        if (ret != BEDROCK_SUCCESS) {
+            fprintf(stderr, "Error: bedrock_client_init() failure.\n");
+            goto err_flock_cleanup;
+        }
 
-    ret = bedrock_client_init(mid, &bcl);
-    if (ret != BEDROCK_SUCCESS) {
-        fprintf(stderr, "Error: bedrock_client_init() failure.\n");
-        goto err_flock_cleanup;
+        /* find the quintain providers of every server */
+        ret = bench_find_targets(
+            json_object_get_boolean(
+                json_object_object_get(json_cfg, "discover_providers"))
+                ? bcl
+                : NULL,
+            &group_view,
+            json_object_get_int(
+                json_object_object_get(json_cfg, "provider_id")),
+            &targets, &ntargets);
+        if (ret != 0) goto err_br_cleanup;
+
+        /* the configuration of the first server goes into the output */
+        ret = bedrock_service_handle_create(
+            bcl, group_view.members.data[0].address, 0, &bsh);
+        if (ret != BEDROCK_SUCCESS) {
+            fprintf(stderr,
+                    "Error: bedrock_service_handle_create() failure.\n");
+            goto err_br_cleanup;
+        }
     }
 
-    /* each benchmark process selects exactly one server to contact */
-    svr_addr_str = group_view.members.data[my_rank % nproviders].address;
-    provider_id  = group_view.members.data[my_rank % nproviders].provider_id;
-
-    /* resolve address to target server */
-    margo_addr_free(mid, svr_addr);
-    ret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
-    if (ret != HG_SUCCESS) {
-        fprintf(stderr, "Error: margo_addr_lookup()\n");
-        goto err_flock_cleanup;
-    }
+    ret = bcast_group_view(&group_view, my_rank);
+    if (ret == 0)
+        ret = bcast_targets(&group_view, &targets, &ntargets, my_rank);
+    if (ret != 0) goto err_br_cleanup;
+    nproviders = flock_group_view_member_count(&group_view);
 
-    ret = bedrock_service_handle_create(bcl, svr_addr_str, 0, &bsh);
-    if (ret != BEDROCK_SUCCESS) {
-        fprintf(stderr, "Error: bedrock_service_handle_create() failure.\n");
-        goto err_br_cleanup;
-    }
+    /* each benchmark process selects exactly one provider to contact */
+    target       = &targets[my_rank % ntargets];
+    svr_addr_str = target->address;
+    provider_id  = target->provider_id;
+    hedge        = NULL;
+    if (ntargets > 1)
+        hedge = &targets[(my_rank + 1) % ntargets];
+    else if (my_rank == 0
+             && json_object_get_int(
+                 json_object_object_get(json_cfg, "hedge_percentile")))
+        fprintf(stderr, "Warning: only one provider; requests will not be "
+                        "hedged.\n");
 
     ret = quintain_client_init(mid, &qcl);
     if (ret != QTN_SUCCESS) {
@@ -218,44 +323,61 @@ int main(int argc, char** argv)
         goto err_br_cleanup;
     }
 
-    provider_id
-        = json_object_get_int(json_object_object_get(json_cfg, "provider_id"));
+    /* resolve the addresses of the target provider and of the one that
+     * hedged requests go to (the next in the target list, if any).  With
+     * "lookup_wave" set, ranks take turns in groups of that many.
+     */
+    lookup_wave
+        = json_object_get_int(json_object_object_get(json_cfg, "lookup_wave"));
+    if (lookup_wave <= 0) lookup_wave = nranks;
+    for (i = 0; i < nranks; i += lookup_wave) {
+        if (my_rank >= i && my_rank < i + lookup_wave) {
+            ret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
+            if (ret == HG_SUCCESS && hedge) {
+                if (strcmp(hedge->address, svr_addr_str) == 0)
+                    ret = margo_addr_dup(mid, svr_addr, &hedge_addr);
+                else
+                    ret = margo_addr_lookup(mid, hedge->address, &hedge_addr);
+            }
+            if (ret != HG_SUCCESS) {
+                fprintf(stderr, "Error: margo_addr_lookup()\n");
+                goto err_qtn_cleanup;
+            }
+        }
+        if (lookup_wave < nranks) MPI_Barrier(MPI_COMM_WORLD);
+    }
+
     ret = quintain_provider_handle_create(qcl, svr_addr, provider_id, &qph);
     if (ret != QTN_SUCCESS) {
         fprintf(stderr, "Error: quintain_provider_handle_create() failure.\n");
         goto err_qtn_cleanup;
     }
-
-    req_buffer_size = json_object_get_int(
-        json_object_object_get(json_cfg, "req_buffer_size"));
-    resp_buffer_size = json_object_get_int(
-        json_object_object_get(json_cfg, "resp_buffer_size"));
-    duration_seconds = json_object_get_int(
-        json_object_object_get(json_cfg, "duration_seconds"));
-    warmup_iterations = json_object_get_int(
-        json_object_object_get(json_cfg, "warmup_iterations"));
-    trace_flag
-        = json_object_get_boolean(json_object_object_get(json_cfg, "trace"));
-    if (json_object_get_boolean(
-            json_object_object_get(json_cfg, "use_server_poolset")))
-        work_flags |= QTN_WORK_USE_SERVER_POOLSET;
-    bulk_size
-        = json_object_get_int(json_object_object_get(json_cfg, "bulk_size"));
-    if (strcmp("pull", json_object_get_string(
-                           json_object_object_get(json_cfg, "bulk_direction"))))
-        bulk_op = HG_BULK_PULL;
-    else if (strcmp("push", json_object_get_string(json_object_object_get(
-                                json_cfg, "bulk_direction"))))
-        bulk_op = HG_BULK_PUSH;
-    else {
-        fprintf(stderr,
-                "Error: invalid bulk_direction parameter: %s (must be push or "
-                "pull).\n",
-                json_object_get_string(
-                    json_object_object_get(json_cfg, "bulk_direction")));
+    if (hedge)
+        ret = quintain_provider_handle_create(
+            qcl, hedge_addr, hedge->provider_id, &hedge_qph);
+    if (ret != QTN_SUCCESS) {
+        fprintf(stderr, "Error: quintain_provider_handle_create() failure.\n");
         goto err_qtn_cleanup;
     }
 
+    /* if the benchmark configuration includes provider settings to change,
+     * have rank 0 apply them to every provider before the run starts
+     */
+    if (my_rank == 0 && json_object_object_get(json_cfg, "server_config")) {
+        ret = bench_apply_server_config(
+            mid, qcl, targets, ntargets,
+            json_object_object_get(json_cfg, "server_config"));
+        if (ret != 0) goto err_qtn_cleanup;
+    }
+
+    /* startup ends once every rank is ready to run */
+    startup[0] = MPI_Wtime() - start_ts;
+    startup[1] = startup[0];
+    MPI_Reduce(my_rank == 0 ? MPI_IN_PLACE : startup, startup, 1, MPI_DOUBLE,
+               MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(my_rank == 0 ? MPI_IN_PLACE : &startup[1], &startup[1], 1,
+               MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
     /* allocate with mmap rather than malloc just so we can use the
      * MAP_POPULATE flag to get the paging out of the way before we start
      * measurements
@@ -268,98 +390,212 @@ int main(int argc, char** argv)
         goto err_qtn_cleanup;
     }
 
-    /* Allocate a bulk buffer (if bulk_size > 0) to reuse in all _work()
-     * calls.  Note that we do not expliclitly register it for RDMA here;
-     * that will be handled within the _work() call as needed.
+    /* store results */
+    f = gzopen(rank_file, "w");
+    if (!f) {
+        fprintf(stderr, "Error opening %s\n", opts.output_file);
+        goto err_qtn_cleanup;
+    }
+    if (my_rank == 0) {
+        gzprintf(f, "# startup_stats\t<ranks>\t<max_s>\t<mean_s>\n");
+        gzprintf(f, "startup_stats\t%d\t%.6f\t%.6f\n", nranks, startup[0],
+                 startup[1] / nranks);
+    }
+
+    /* the workload is run "trials" times for each entry in
+     * "configurations" (or just for the top level configuration if there
+     * are none).  Each configuration entry overrides top level parameters.
      */
-    if (bulk_size > 0) {
-        bulk_buffer = malloc(bulk_size);
-        if (!bulk_buffer) {
-            perror("malloc");
+    trials    = json_object_get_int(json_object_object_get(json_cfg, "trials"));
+    trial_gap = json_object_get_int(
+        json_object_object_get(json_cfg, "trial_gap_seconds"));
+    configs   = json_object_object_get(json_cfg, "configurations");
+    if (configs && !json_object_is_type(configs, json_type_array)) {
+        fprintf(stderr, "Error: configurations must be an array.\n");
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+    /* a payload sweep is shorthand for a pair of configurations (inline
+     * and bulk) per payload size
+     */
+    sweep = json_object_object_get(json_cfg, "payload_sweep");
+    if (sweep) {
+        if (configs) {
+            fprintf(stderr,
+                    "Error: payload_sweep cannot be combined with "
+                    "configurations.\n");
             ret = -1;
             goto err_qtn_cleanup;
         }
-    }
-
-    /* run warm up iterations, if specified */
-    for (i = 0; i < warmup_iterations; i++) {
-        ret = quintain_work(qph, req_buffer_size, resp_buffer_size, bulk_size,
-                            bulk_op, bulk_buffer, work_flags);
-        if (ret != QTN_SUCCESS) {
-            fprintf(stderr, "Error: quintain_work() failure: (%d)\n", ret);
+        sweep_configs = payload_sweep_configs(sweep);
+        if (!sweep_configs) {
+            ret = -1;
             goto err_qtn_cleanup;
         }
+        configs = sweep_configs;
     }
-
-    /* synchronize clients to make sure they are all ready before we query
-     * statistics*/
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    ret = local_stat(&cli_utime1, &cli_stime1, &cli_alltime1);
-    if (ret != 0) goto err_qtn_cleanup;
-
-    if (my_rank == 0) {
-        ret = quintain_stat(qph, &svr_utime1, &svr_stime1, &svr_alltime1);
-        if (ret != QTN_SUCCESS) {
-            fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
-            goto err_qtn_cleanup;
+    nconfigs = configs ? json_object_array_length(configs) : 1;
+    if (trials < 1 || nconfigs < 1) {
+        fprintf(stderr,
+                "Error: trials and the number of configurations must be at "
+                "least 1.\n");
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+    nslots  = nconfigs * trials;
+    order   = malloc(nslots * sizeof(*order));
+    results = calloc(nslots, sizeof(*results));
+    if (!order || !results) {
+        perror("malloc");
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+    for (i = 0; i < nslots; i++) order[i] = i;
+    /* a shuffled order keeps slow drift on the system from biasing one
+     * configuration; rank 0 picks it so that all ranks agree
+     */
+    if (my_rank == 0
+        && json_object_get_boolean(
+            json_object_object_get(json_cfg, "randomize_order"))) {
+        srandom(time(NULL) ^ getpid());
+        for (i = nslots - 1; i > 0; i--) {
+            int j    = random() % (i + 1);
+            int tmp  = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
         }
     }
+    MPI_Bcast(order, nslots, MPI_INT, 0, MPI_COMM_WORLD);
 
-    /* barrier to start measurements */
-    MPI_Barrier(MPI_COMM_WORLD);
+    /* provider settings that every configuration starts from, if any of
+     * them changes provider settings
+     */
+    if (my_rank == 0 && configs) {
+        ret = server_config_baseline(bsh, targets[0].provider_id, json_cfg,
+                                     configs, &server_baseline);
+        if (ret != 0) goto err_qtn_cleanup;
+    }
 
-    start_ts = ABT_get_wtime();
-    prev_ts  = 0;
+    env.mid          = mid;
+    env.qph          = qph;
+    env.hedge_qph    = hedge_qph;
+    env.my_rank      = my_rank;
+    env.nranks       = nranks;
+    env.svr_idx      = target->member;
+    env.svr_addr_str = svr_addr_str;
+    env.provider_id  = provider_id;
+    env.samples      = samples;
+    env.f            = f;
+    env.rapl         = NULL;
+
+    /* energy counters cover a whole node, so only the first rank on each
+     * node reads them
+     */
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank,
+                        MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    if (node_rank == 0) {
+        ret = qtn_rapl_init(
+            &rapl, json_object_get_string(
+                       json_object_object_get(json_cfg, "rapl_root")));
+        if (ret != 0) goto err_qtn_cleanup;
+        env.rapl = &rapl;
+    }
 
-    do {
-        ret = quintain_work(qph, req_buffer_size, resp_buffer_size, bulk_size,
-                            bulk_op, bulk_buffer, work_flags);
-        if (ret != QTN_SUCCESS) {
-            fprintf(stderr, "Error: quintain_work() failure.\n");
-            goto err_qtn_cleanup;
+    for (i = 0; i < nslots; i++) {
+        struct json_object* trial_cfg = json_cfg;
+        struct json_object* override  = NULL;
+        int                 config    = order[i] / trials;
+        int                 trial     = order[i] % trials;
+
+        if (i > 0 && trial_gap > 0) margo_thread_sleep(mid, trial_gap * 1000.0);
+
+        if (configs) {
+            override = json_object_array_get_idx(configs, config);
+            if (!json_object_is_type(override, json_type_object)) {
+                fprintf(stderr, "Error: configuration %d is not an object.\n",
+                        config);
+                ret = -1;
+                goto err_qtn_cleanup;
+            }
+            trial_cfg = NULL;
+            json_object_deep_copy(json_cfg, &trial_cfg, NULL);
+            json_object_object_foreach(override, key, val)
+            {
+                json_object_object_add(trial_cfg, key, json_object_get(val));
+            }
+            /* configurations may change provider settings too.  Each one
+             * starts from the baseline, whatever the previous configuration
+             * changed, so the order of configurations does not matter.
+             */
+            if (my_rank == 0 && server_baseline) {
+                struct json_object* update = NULL;
+                struct json_object* changes
+                    = json_object_object_get(override, "server_config");
+
+                json_object_deep_copy(server_baseline, &update, NULL);
+                if (changes) {
+                    json_object_object_foreach(changes, skey, sval)
+                    {
+                        json_object_object_add(update, skey,
+                                               json_object_get(sval));
+                    }
+                }
+                ret = bench_apply_server_config(mid, qcl, targets, ntargets,
+                                                update);
+                json_object_put(update);
+                if (ret != 0) {
+                    json_object_put(trial_cfg);
+                    goto err_qtn_cleanup;
+                }
+            }
         }
-        this_ts = ABT_get_wtime() - start_ts;
-        /* save just the elapsed time; we can reconstruct start and end
-         * timestamps later since this is a tight loop
-         */
-        if (sample_index < MAX_SAMPLES)
-            samples[sample_index] = this_ts - prev_ts;
-        prev_ts = this_ts;
-        sample_index++;
-    } while (this_ts < duration_seconds);
-
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    ret = local_stat(&cli_utime2, &cli_stime2, &cli_alltime2);
-    if (ret != 0) goto err_qtn_cleanup;
-    cli_utime   = cli_utime2 - cli_utime1;
-    cli_stime   = cli_stime2 - cli_stime1;
-    cli_alltime = cli_alltime2 - cli_alltime1;
 
-    if (my_rank == 0) {
-        ret = quintain_stat(qph, &svr_utime2, &svr_stime2, &svr_alltime2);
-        if (ret != QTN_SUCCESS) {
-            fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
-            goto err_qtn_cleanup;
+        if (nslots > 1) {
+            gzprintf(f, "# trial\t<rank>\t<config>\t<trial>\n");
+            gzprintf(f, "trial\t%d\t%d\t%d\n", my_rank, config, trial);
         }
-        svr_utime   = svr_utime2 - svr_utime1;
-        svr_stime   = svr_stime2 - svr_stime1;
-        svr_alltime = svr_alltime2 - svr_alltime1;
+        ret = run_trial(&env, trial_cfg, &results[order[i]]);
+        if (trial_cfg != json_cfg) json_object_put(trial_cfg);
+        if (ret != 0) goto err_qtn_cleanup;
     }
 
-    /* store results */
-    f = gzopen(rank_file, "w");
-    if (!f) {
-        fprintf(stderr, "Error opening %s\n", opts.output_file);
-        goto err_qtn_cleanup;
+    /* spread of the results across trials, per configuration */
+    if (my_rank == 0 && trials > 1) {
+        for (i = 0; i < nconfigs; i++)
+            write_trial_summary(f, i, &results[i * trials], trials);
+    }
+    if (my_rank == 0 && sweep_configs)
+        write_payload_sweep(
+            f, sweep_configs, results, trials,
+            bench_eager_threshold(
+                mid, strcmp(json_object_get_string(json_object_object_get(
+                                json_cfg, "bulk_direction")),
+                            "push")
+                         ? HG_BULK_PULL
+                         : HG_BULK_PUSH));
+
+    if (f) {
+        gzclose(f);
+        f = NULL;
     }
+    MPI_Barrier(MPI_COMM_WORLD);
 
-    /* have rank 0 in benchmark report configuration */
+    /* have rank 0 in benchmark report configuration.  This is done after
+     * the run so that the statistics included in the provider
+     * configuration cover it, and is written to the start of the output
+     * file ahead of the results of every rank.
+     */
     if (my_rank == 0) {
         struct json_tokener*    tokener;
         enum json_tokener_error jerr;
 
+        f = gzopen(opts.output_file, "w");
+        if (!f) {
+            fprintf(stderr, "Error opening %s\n", opts.output_file);
+            goto err_qtn_cleanup;
+        }
+
         /* retrieve configuration from provider */
         svr_cfg_str_raw
             = bedrock_service_query_config(bsh, "return $__config__;");
@@ -412,64 +648,10 @@ int main(int argc, char** argv)
                  json_object_to_json_string_ext(
                      json_cfg,
                      JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_NOSLASHESCAPE));
-    }
-
-    /* if requested, report every sample */
-    if (trace_flag) {
-        gzprintf(f, "start_timestamp\t%f\n", start_ts);
-        gzprintf(f, "# sample_trace\t<rank>\t<start>\t<end>\t<elapsed>\n");
-        this_ts = 0;
-        for (i = 0; i < sample_index && i < MAX_SAMPLES; i++) {
-            gzprintf(f, "sample_trace\t%d\t%.9f\t%.9f\t%.9f\n", my_rank,
-                     this_ts, (this_ts + samples[i]), samples[i]);
-            this_ts += samples[i];
-        }
-    }
-
-    /* now that samples have been written out individually in the order they
-     * occurred (if requested), we can locally sort and generate some
-     * statistics
-     */
-    /* calculate ops/s before we possibly truncate sample_index */
-    stats.ops_per_sec = (double)sample_index / (double)duration_seconds;
-    if (sample_index > MAX_SAMPLES) sample_index = MAX_SAMPLES;
-    qsort(samples, sample_index, sizeof(double), sample_compare);
-    /* there should be a lot of samples; we aren't going to bother
-     * interpolating between points if there isn't a precise sample for the
-     * medians or quartiles
-     */
-    stats.min    = samples[0];
-    stats.q1     = samples[sample_index / 4];
-    stats.median = samples[sample_index / 2];
-    stats.q3     = samples[3 * (sample_index / 4)];
-    stats.max    = samples[sample_index - 1];
-    for (i = 0; i < sample_index; i++) stats.mean += samples[i];
-    stats.mean /= (double)sample_index;
-    gzprintf(f, "# client_mapping\t<rank>\t<svr_idx>\t<svr_addr_string>\n");
-    gzprintf(f, "client_mapping\t%d\t%d\t%s\n", my_rank, my_rank % nproviders,
-             svr_addr_str);
-    gzprintf(f,
-             "# "
-             "sample_stats\t<rank>\t<min>\t<q1>\t<median>\t<q3>\t<max>\t<mean>"
-             "\t<ops/s>\n");
-    gzprintf(f, "sample_stats\t%d\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.3f\n",
-             my_rank, stats.min, stats.q1, stats.median, stats.q3, stats.max,
-             stats.mean, stats.ops_per_sec);
-    if (my_rank == 0) {
-        gzprintf(
-            f, "# server_stats\t<server_rank>\t<utime>\t<stime>\t<alltime>\n");
-        gzprintf(f, "server_stats\t%d\t%.9f\t%.9f\t%.9f\n", 0, svr_utime,
-                 svr_stime, svr_alltime);
-    }
-    gzprintf(f, "# client_stats\t<rank>\t<utime>\t<stime>\t<alltime>\n");
-    gzprintf(f, "client_stats\t%d\t%.9f\t%.9f\t%.9f\n", my_rank, cli_utime,
-             cli_stime, cli_alltime);
-
-    if (f) {
+        bench_write_server_perf(svr_config, f);
         gzclose(f);
         f = NULL;
     }
-    MPI_Barrier(MPI_COMM_WORLD);
 
     /* rank 0 concatenate all of the intermediate results into a single
      * output file.  The gzip file format produces a legal gzip'd file when
@@ -478,7 +660,6 @@ int main(int argc, char** argv)
     if (my_rank == 0) {
         int fd_rank;
         int fd;
-        rename(rank_file, opts.output_file);
 
         fd = open(opts.output_file, O_WRONLY | O_CREAT | O_APPEND, 0660);
         if (fd < 0) {
@@ -487,7 +668,7 @@ int main(int argc, char** argv)
             goto err_qtn_cleanup;
         }
 
-        for (i = 1; i < nranks; i++) {
+        for (i = 0; i < nranks; i++) {
             /* no hard errors here; if we can't get data for a rank just
              * skip it
              */
@@ -503,26 +684,44 @@ int main(int argc, char** argv)
             unlink(rank_file);
         }
         close(fd);
+
+        /* and a machine-readable summary next to it */
+        snprintf(summary_file, sizeof(summary_file), "%.*s.summary.json",
+                 (int)strlen(opts.output_file) - 3, opts.output_file);
+        ret = write_summary(summary_file, json_cfg, configs, results, nconfigs,
+                            trials, nranks, ntargets, startup);
+        if (ret != 0) goto err_qtn_cleanup;
     }
 
 err_qtn_cleanup:
-    if (bulk_buffer) free(bulk_buffer);
+    free(order);
+    free(results);
+    if (sweep_configs) json_object_put(sweep_configs);
+    if (server_baseline) json_object_put(server_baseline);
+    qtn_rapl_finalize(&rapl);
+    if (node_comm != MPI_COMM_NULL) MPI_Comm_free(&node_comm);
     if (svr_cfg_str_raw) free(svr_cfg_str_raw);
     if (cli_cfg_str) free(cli_cfg_str);
     if (f) gzclose(f);
     if (samples) munmap(samples, MAX_SAMPLES * sizeof(double));
     if (qph != QTN_PROVIDER_HANDLE_NULL) quintain_provider_handle_release(qph);
+    if (hedge_qph != QTN_PROVIDER_HANDLE_NULL)
+        quintain_provider_handle_release(hedge_qph);
     if (qcl != QTN_CLIENT_NULL) quintain_client_finalize(qcl);
-err_flock_cleanup:
-    flock_group_view_clear(&group_view);
-    if (fh != FLOCK_GROUP_HANDLE_NULL) flock_group_handle_release(fh);
-    if (fcl != FLOCK_CLIENT_NULL) flock_client_finalize(fcl);
 err_br_cleanup:
+    free(targets);
     if (bsh != NULL) bedrock_service_handle_destroy(bsh);
     if (bcl != NULL) bedrock_client_finalize(bcl);
+err_flock_cleanup:
+    if (fh != FLOCK_GROUP_HANDLE_NULL) flock_group_handle_release(fh);
+    if (fcl != FLOCK_CLIENT_NULL) flock_client_finalize(fcl);
 err_margo_cleanup:
     if (svr_addr != HG_ADDR_NULL) margo_addr_free(mid, svr_addr);
+    if (hedge_addr != HG_ADDR_NULL) margo_addr_free(mid, hedge_addr);
     margo_finalize(mid);
+err_view_cleanup:
+    /* the group view is read before margo starts */
+    flock_group_view_clear(&group_view);
 err_mpi_cleanup:
     if (json_cfg) json_object_put(json_cfg);
     if (svr_config) json_object_put(svr_config);
@@ -534,69 +733,677 @@ err_mpi_cleanup:
     return ret;
 }
 
-static int parse_json(const char* json_file, struct json_object** json_cfg)
+static int run_trial(const struct trial_env* env,
+                     struct json_object*     json_cfg,
+                     struct trial_result*    res)
 {
-    struct json_tokener*    tokener;
-    enum json_tokener_error jerr;
-    char*                   json_cfg_str = NULL;
-    FILE*                   f;
-    long                    fsize;
-    int                     nranks;
-    struct json_object*     val;
-
-    /* open json file */
-    f = fopen(json_file, "r");
-    if (!f) {
-        perror("fopen");
-        fprintf(stderr, "Error: could not open json file %s\n", json_file);
-        return (-1);
+    int                      my_rank = env->my_rank;
+    gzFile                   f       = env->f;
+    struct bench_workload    wl;
+    struct bench_client      bc      = {0};
+    struct sample_statistics stats   = {0};
+    double                   svr_utime1, svr_stime1, svr_alltime1;
+    double                   svr_utime2, svr_stime2, svr_alltime2;
+    double                   svr_utime, svr_stime, svr_alltime;
+    double                   cli_utime1, cli_stime1, cli_alltime1;
+    double                   cli_utime2, cli_stime2, cli_alltime2;
+    double                   cli_utime, cli_stime, cli_alltime;
+    double                   svr_raw_bytes = 0;
+    double                   cli_joules1 = -1, cli_joules2 = -1;
+    double                   svr_joules1 = -1, svr_joules2 = -1;
+    double                   local[8], global[8];
+    double                   warmup_ts;
+    double                   global_ops = 0;
+    int                      ret;
+
+    /* give each rank a distinct payload pattern */
+    ret = bench_workload_init(json_cfg, env->mid, (uint64_t)my_rank << 40,
+                              &wl);
+    if (ret != 0) return ret;
+
+    ret = bench_client_init(&bc, &wl, env->qph, env->hedge_qph, env->samples,
+                            MAX_SAMPLES);
+    if (ret != 0) goto finish;
+
+    /* run warm up iterations, if specified */
+    warmup_ts = ABT_get_wtime();
+    ret       = bench_client_warmup(&bc);
+    if (ret != 0) goto finish;
+    warmup_ts = ABT_get_wtime() - warmup_ts;
+
+    /* synchronize clients to make sure they are all ready before we query
+     * statistics*/
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    ret = bench_local_stat(&cli_utime1, &cli_stime1, &cli_alltime1);
+    if (ret != 0) goto finish;
+    if (env->rapl) cli_joules1 = qtn_rapl_read(env->rapl);
+
+    if (my_rank == 0) {
+        ret = quintain_stat(env->qph, &svr_utime1, &svr_stime1, &svr_alltime1);
+        if (ret == QTN_SUCCESS)
+            ret = quintain_stat_energy(env->qph, &svr_joules1);
+        if (ret != QTN_SUCCESS) {
+            fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
+            goto finish;
+        }
+    }
+
+    /* barrier to start measurements */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* the time series of all ranks count from rank 0's start time if MPI
+     * clocks are synchronized, or else from the end of the barrier
+     */
+    if (bc.bins && wtime_is_global(MPI_COMM_WORLD)) {
+        double origin = MPI_Wtime();
+
+        MPI_Bcast(&origin, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        bc.ts_origin = ABT_get_wtime() - (MPI_Wtime() - origin);
     }
 
-    /* check size */
-    fseek(f, 0, SEEK_END);
-    fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    ret = bench_client_run(&bc);
+    if (ret != 0) goto finish;
+
+    MPI_Barrier(MPI_COMM_WORLD);
 
-    /* allocate space to hold contents and read it in */
-    json_cfg_str = malloc(fsize + 1);
-    if (!json_cfg_str) {
+    ret = bench_local_stat(&cli_utime2, &cli_stime2, &cli_alltime2);
+    if (ret != 0) goto finish;
+    if (env->rapl) cli_joules2 = qtn_rapl_read(env->rapl);
+    cli_utime   = cli_utime2 - cli_utime1;
+    cli_stime   = cli_stime2 - cli_stime1;
+    cli_alltime = cli_alltime2 - cli_alltime1;
+
+    /* uncompressed payload bytes handled by the server that rank 0
+     * measures
+     */
+    if (wl.work_flags & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS)) {
+        double my_svr_raw_bytes
+            = (env->svr_idx == 0) ? bc.raw_bytes : 0;
+        MPI_Reduce(&my_svr_raw_bytes, &svr_raw_bytes, 1, MPI_DOUBLE, MPI_SUM,
+                   0, MPI_COMM_WORLD);
+    }
+
+    if (my_rank == 0) {
+        ret = quintain_stat(env->qph, &svr_utime2, &svr_stime2, &svr_alltime2);
+        if (ret == QTN_SUCCESS)
+            ret = quintain_stat_energy(env->qph, &svr_joules2);
+        if (ret != QTN_SUCCESS) {
+            fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
+            goto finish;
+        }
+        svr_utime   = svr_utime2 - svr_utime1;
+        svr_stime   = svr_stime2 - svr_stime1;
+        svr_alltime = svr_alltime2 - svr_alltime1;
+    }
+
+    /* if requested, report every sample */
+    if (wl.trace_flag) bench_client_write_trace(&bc, f, my_rank);
+
+    /* now that samples have been written out individually in the order they
+     * occurred (if requested), we can locally sort and generate some
+     * statistics
+     */
+    bench_client_stats(&bc, &stats);
+    gzprintf(f,
+             "# client_mapping\t<rank>\t<svr_idx>\t<svr_addr_string>\t"
+             "<provider_id>\n");
+    gzprintf(f, "client_mapping\t%d\t%d\t%s\t%d\n", my_rank, env->svr_idx,
+             env->svr_addr_str, env->provider_id);
+    gzprintf(f,
+             "# "
+             "sample_stats\t<rank>\t<min>\t<q1>\t<median>\t<q3>\t<max>\t<mean>"
+             "\t<ops/s>\n");
+    gzprintf(f, "sample_stats\t%d\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.3f\n",
+             my_rank, stats.min, stats.q1, stats.median, stats.q3, stats.max,
+             stats.mean, stats.ops_per_sec);
+    if (my_rank == 0) {
+        gzprintf(
+            f, "# server_stats\t<server_rank>\t<utime>\t<stime>\t<alltime>\n");
+        gzprintf(f, "server_stats\t%d\t%.9f\t%.9f\t%.9f\n", 0, svr_utime,
+                 svr_stime, svr_alltime);
+    }
+    gzprintf(f, "# client_stats\t<rank>\t<utime>\t<stime>\t<alltime>\n");
+    gzprintf(f, "client_stats\t%d\t%.9f\t%.9f\t%.9f\n", my_rank, cli_utime,
+             cli_stime, cli_alltime);
+    bench_client_write_stats(&bc, &stats, cli_utime + cli_stime, f, my_rank);
+    if (my_rank == 0
+        && (wl.work_flags & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS))) {
+        gzprintf(f,
+                 "# compression_server_stats\t<server_rank>\t<raw_bytes>"
+                 "\t<server_cpu_ns/byte>\n");
+        gzprintf(f, "compression_server_stats\t%d\t%.0f\t%.6f\n", 0,
+                 svr_raw_bytes,
+                 svr_raw_bytes ? (svr_utime + svr_stime) * 1e9 / svr_raw_bytes
+                               : 0.0);
+    }
+
+    /* global timeline: the bins of every rank summed on rank 0 */
+    if (bc.bins) {
+        struct bench_timebin* global_bins = NULL;
+
+        if (my_rank == 0) {
+            global_bins = calloc(bc.nbins, sizeof(*global_bins));
+            if (!global_bins) {
+                perror("calloc");
+                ret = -1;
+                goto finish;
+            }
+        }
+        MPI_Reduce(bc.bins, global_bins, bc.nbins * BENCH_TIMEBIN_LONGS,
+                   MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (my_rank == 0) {
+            bench_timeseries_write(global_bins, bc.nbins, wl.ts_bin_seconds,
+                                   f);
+            free(global_bins);
+        }
+    }
+
+    /* energy over the measurement window: client energy summed over the
+     * nodes running clients (and counted as unavailable if any of them
+     * cannot read it), server energy from the node of the first provider
+     */
+    local[0] = cli_joules1 >= 0 ? cli_joules2 - cli_joules1 : 0;
+    local[1] = (env->rapl && cli_joules1 < 0) ? 1 : 0;
+    local[2] = (double)(bc.sample_index - bc.busy_rejections) * wl.batch_size;
+    MPI_Reduce(local, global, 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    global_ops = global[2];
+    if (my_rank == 0 && (global[1] == 0 || svr_joules1 >= 0))
+        bench_write_energy(f, global[1] == 0 ? global[0] : -1,
+                           svr_joules1 >= 0 ? svr_joules2 - svr_joules1 : -1,
+                           global[2], bc.elapsed);
+
+    local[0] = stats.ops_per_sec;
+    local[1] = stats.median;
+    local[2] = stats.q3;
+    local[3] = stats.p99;
+    local[4] = stats.q1;
+    local[5] = stats.mean;
+    local[6] = (double)bc.busy_rejections * wl.batch_size;
+    local[7] = cli_utime + cli_stime;
+    MPI_Reduce(local, global, 8, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (my_rank == 0) {
+        res->ops_per_sec = global[0];
+        res->median      = global[1] / env->nranks;
+        res->q3          = global[2] / env->nranks;
+        res->p99         = global[3] / env->nranks;
+        res->q1          = global[4] / env->nranks;
+        res->mean        = global[5] / env->nranks;
+        res->ops         = global_ops;
+        res->rejected    = global[6];
+        res->client_cpu  = global[7];
+        res->seconds     = bc.elapsed;
+        res->server_cpu  = svr_utime + svr_stime;
+    }
+    local[0] = stats.max;
+    local[1] = warmup_ts;
+    MPI_Reduce(local, global, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (my_rank == 0) {
+        res->max            = global[0];
+        res->warmup_seconds = global[1];
+    }
+    MPI_Reduce(&stats.min, &res->min, 1, MPI_DOUBLE, MPI_MIN, 0,
+               MPI_COMM_WORLD);
+
+finish:
+    bench_client_destroy(&bc);
+    return ret;
+}
+
+/* mean, standard deviation, and 95% confidence interval half-width of each
+ * headline metric over the trials of one configuration
+ */
+static void write_trial_summary(gzFile                     f,
+                                int                        config,
+                                const struct trial_result* res,
+                                int                        trials)
+{
+    const char*  names[]   = {"ops/s", "median", "q3", "p99"};
+    const size_t offsets[] = {offsetof(struct trial_result, ops_per_sec),
+                              offsetof(struct trial_result, median),
+                              offsetof(struct trial_result, q3),
+                              offsetof(struct trial_result, p99)};
+    double       mean, var, sd, d;
+    int          m, t;
+
+    gzprintf(f,
+             "# trial_summary\t<config>\t<metric>\t<trials>\t<mean>\t<stddev>"
+             "\t<ci95>\n");
+    for (m = 0; m < 4; m++) {
+        /* two passes, so that the variance does not lose precision to
+         * cancellation when the spread is small relative to the mean
+         */
+        mean = var = 0;
+        for (t = 0; t < trials; t++)
+            mean += *(const double*)((const char*)&res[t] + offsets[m]);
+        mean /= trials;
+        for (t = 0; t < trials; t++) {
+            d = *(const double*)((const char*)&res[t] + offsets[m]) - mean;
+            var += d * d;
+        }
+        sd = sqrt(var / (trials - 1));
+        gzprintf(f, "trial_summary\t%d\t%s\t%d\t%.9g\t%.9g\t%.9g\n", config,
+                 names[m], trials, mean, sd,
+                 bench_t95(trials - 1) * sd / sqrt(trials));
+    }
+}
+
+/* Finds the provider settings that every configuration should start from:
+ * the top level server_config, plus the initial value (as reported by the
+ * first provider) of each other setting that some configuration changes.
+ * *baseline is left NULL if no configuration changes provider settings.
+ */
+static int server_config_baseline(bedrock_service_t    bsh,
+                                  int                  provider_id,
+                                  struct json_object*  json_cfg,
+                                  struct json_object*  configs,
+                                  struct json_object** baseline)
+{
+    struct json_object* svr_config = NULL;
+    struct json_object* initial    = NULL;
+    struct json_object* top;
+    struct json_object* providers;
+    struct json_object* p;
+    struct json_object* changes;
+    struct json_object* val;
+    const char*         type;
+    char*               cfg_str;
+    size_t              i;
+    int                 ret = -1;
+
+    *baseline = NULL;
+    for (i = 0; i < json_object_array_length(configs); i++)
+        if (json_object_object_get(json_object_array_get_idx(configs, i),
+                                   "server_config"))
+            break;
+    if (i == json_object_array_length(configs)) return 0;
+
+    cfg_str = bedrock_service_query_config(bsh, "return $__config__;");
+    if (!cfg_str) {
+        fprintf(stderr, "Error: bedrock_service_query_config() failure.\n");
+        return -1;
+    }
+    svr_config = json_tokener_parse(cfg_str);
+    free(cfg_str);
+    providers = json_object_object_get(svr_config, "providers");
+    for (i = 0; i < json_object_array_length(providers); i++) {
+        p    = json_object_array_get_idx(providers, i);
+        type = json_object_get_string(json_object_object_get(p, "type"));
+        if (type && !strcmp(type, "quintain")
+            && json_object_get_int(json_object_object_get(p, "provider_id"))
+                   == provider_id)
+            initial = json_object_object_get(p, "config");
+    }
+
+    top = json_object_object_get(json_cfg, "server_config");
+    if (top)
+        json_object_deep_copy(top, baseline, NULL);
+    else
+        *baseline = json_object_new_object();
+    for (i = 0; i < json_object_array_length(configs); i++) {
+        changes = json_object_object_get(json_object_array_get_idx(configs, i),
+                                         "server_config");
+        if (!changes) continue;
+        json_object_object_foreach(changes, key, change)
+        {
+            if (json_object_object_get_ex(*baseline, key, NULL)) continue;
+            if (!json_object_object_get_ex(initial, key, &val)) {
+                fprintf(stderr,
+                        "Error: provider %d does not report a value for "
+                        "server_config setting \"%s\".\n",
+                        provider_id, key);
+                goto finish;
+            }
+            json_object_object_add(*baseline, key, json_object_get(val));
+        }
+    }
+    ret = 0;
+
+finish:
+    if (ret != 0) {
+        json_object_put(*baseline);
+        *baseline = NULL;
+    }
+    json_object_put(svr_config);
+    return ret;
+}
+
+/* Expands "payload_sweep": {"min": <bytes>, "max": <bytes>, "factor": <n>}
+ * into configurations that move each payload size first inline and then by
+ * bulk transfer.  Returns NULL if the sweep is invalid.
+ */
+static struct json_object* payload_sweep_configs(struct json_object* sweep)
+{
+    struct json_object* configs;
+    struct json_object* cfg;
+    long                min, max, size;
+    int                 factor;
+    int                 use_bulk;
+
+    min    = json_object_get_int64(json_object_object_get(sweep, "min"));
+    max    = json_object_get_int64(json_object_object_get(sweep, "max"));
+    factor = json_object_object_get(sweep, "factor")
+               ? json_object_get_int(json_object_object_get(sweep, "factor"))
+               : 2;
+    if (min < 1 || max < min || factor < 2) {
+        fprintf(stderr,
+                "Error: payload_sweep needs 1 <= min <= max and factor >= "
+                "2.\n");
+        return NULL;
+    }
+
+    configs = json_object_new_array();
+    for (size = min; size <= max; size *= factor) {
+        for (use_bulk = 0; use_bulk < 2; use_bulk++) {
+            cfg = json_object_new_object();
+            json_object_object_add(cfg, "payload_size",
+                                   json_object_new_int64(size));
+            json_object_object_add(cfg, "eager_threshold",
+                                   json_object_new_int64(use_bulk ? -1 : size));
+            json_object_array_add(configs, cfg);
+        }
+    }
+    return configs;
+}
+
+/* writes the mean latency and throughput of the inline and bulk variants
+ * of each swept payload size, and the smallest size at which bulk
+ * transfer has the lower median latency (-1 if it never does) alongside
+ * the threshold that "auto" would pick
+ */
+static void write_payload_sweep(gzFile                     f,
+                                struct json_object*        configs,
+                                const struct trial_result* res,
+                                int                        trials,
+                                long                       auto_threshold)
+{
+    double mean[2][2]; /* [inline, bulk][median, ops/s] */
+    long   size;
+    long   crossover = -1;
+    size_t c;
+    int    k, t;
+
+    gzprintf(f,
+             "# payload_sweep\t<payload_size>\t<inline_median>\t"
+             "<bulk_median>\t<inline_ops/s>\t<bulk_ops/s>\n");
+    for (c = 0; c + 1 < json_object_array_length(configs); c += 2) {
+        size = json_object_get_int64(json_object_object_get(
+            json_object_array_get_idx(configs, c), "payload_size"));
+        for (k = 0; k < 2; k++) {
+            mean[k][0] = mean[k][1] = 0;
+            for (t = 0; t < trials; t++) {
+                mean[k][0] += res[(c + k) * trials + t].median / trials;
+                mean[k][1] += res[(c + k) * trials + t].ops_per_sec / trials;
+            }
+        }
+        gzprintf(f, "payload_sweep\t%ld\t%.9f\t%.9f\t%.3f\t%.3f\n", size,
+                 mean[0][0], mean[1][0], mean[0][1], mean[1][1]);
+        if (crossover < 0 && mean[1][0] < mean[0][0]) crossover = size;
+    }
+    gzprintf(f, "# payload_crossover\t<payload_size>\t<auto_threshold>\n");
+    gzprintf(f, "payload_crossover\t%ld\t%ld\n", crossover, auto_threshold);
+}
+
+/* adds the mean, standard deviation, and 95% confidence interval half-width
+ * of one metric over the trials of a configuration to obj
+ */
+static void summarize_metric(struct json_object*        obj,
+                             const char*                name,
+                             const struct trial_result* res,
+                             size_t                     offset,
+                             int                        trials)
+{
+    struct json_object* m    = json_object_new_object();
+    double              mean = 0, var = 0, sd = 0, d;
+    int                 t;
+
+    /* two passes, as in write_trial_summary() */
+    for (t = 0; t < trials; t++)
+        mean += *(const double*)((const char*)&res[t] + offset);
+    mean /= trials;
+    for (t = 0; t < trials; t++) {
+        d = *(const double*)((const char*)&res[t] + offset) - mean;
+        var += d * d;
+    }
+    if (trials > 1) sd = sqrt(var / (trials - 1));
+    json_object_object_add(m, "mean", json_object_new_double(mean));
+    json_object_object_add(m, "stddev", json_object_new_double(sd));
+    json_object_object_add(
+        m, "ci95",
+        json_object_new_double(
+            trials > 1 ? bench_t95(trials - 1) * sd / sqrt(trials) : 0));
+    json_object_object_add(obj, name, m);
+}
+
+/* Writes the results of the whole run as one JSON document: the benchmark
+ * configuration, startup time, and for each configuration the results of
+ * every trial and their spread.  Latency quantiles are means of the
+ * per-rank quantiles, except min and max which cover all ranks.
+ */
+static int write_summary(const char*                path,
+                         struct json_object*        json_cfg,
+                         struct json_object*        configs,
+                         const struct trial_result* results,
+                         int                        nconfigs,
+                         int                        trials,
+                         int                        nranks,
+                         int                        ntargets,
+                         const double*              startup)
+{
+    /* metrics summarized over trials, all of them per configuration */
+    static const struct {
+        const char* name;
+        size_t      offset;
+    } metrics[] = {
+        {"ops_per_sec", offsetof(struct trial_result, ops_per_sec)},
+        {"median", offsetof(struct trial_result, median)},
+        {"q3", offsetof(struct trial_result, q3)},
+        {"p99", offsetof(struct trial_result, p99)},
+        {"mean", offsetof(struct trial_result, mean)},
+        {"client_cpu_seconds", offsetof(struct trial_result, client_cpu)},
+        {"server_cpu_seconds", offsetof(struct trial_result, server_cpu)},
+    };
+    struct json_object*        summary = json_object_new_object();
+    struct json_object*        obj;
+    struct json_object*        cfgs;
+    struct json_object*        cfg;
+    struct json_object*        list;
+    struct json_object*        trial;
+    const struct trial_result* r;
+    int                        c, t, m;
+    int                        ret = 0;
+
+    json_object_object_add(summary, "nranks", json_object_new_int(nranks));
+    json_object_object_add(summary, "nproviders",
+                           json_object_new_int(ntargets));
+    obj = json_object_new_object();
+    json_object_object_add(obj, "max_seconds",
+                           json_object_new_double(startup[0]));
+    json_object_object_add(obj, "mean_seconds",
+                           json_object_new_double(startup[1] / nranks));
+    json_object_object_add(summary, "startup", obj);
+    json_object_object_add(summary, "benchmark", json_object_get(json_cfg));
+
+    cfgs = json_object_new_array();
+    for (c = 0; c < nconfigs; c++) {
+        cfg = json_object_new_object();
+        json_object_object_add(cfg, "config", json_object_new_int(c));
+        json_object_object_add(
+            cfg, "overrides",
+            configs ? json_object_get(json_object_array_get_idx(configs, c))
+                    : json_object_new_object());
+
+        list = json_object_new_array();
+        for (t = 0; t < trials; t++) {
+            r     = &results[c * trials + t];
+            trial = json_object_new_object();
+            json_object_object_add(trial, "ops_per_sec",
+                                   json_object_new_double(r->ops_per_sec));
+            json_object_object_add(trial, "ops",
+                                   json_object_new_double(r->ops));
+            json_object_object_add(trial, "rejected",
+                                   json_object_new_double(r->rejected));
+            obj = json_object_new_object();
+            json_object_object_add(obj, "min", json_object_new_double(r->min));
+            json_object_object_add(obj, "q1", json_object_new_double(r->q1));
+            json_object_object_add(obj, "median",
+                                   json_object_new_double(r->median));
+            json_object_object_add(obj, "mean",
+                                   json_object_new_double(r->mean));
+            json_object_object_add(obj, "q3", json_object_new_double(r->q3));
+            json_object_object_add(obj, "p99", json_object_new_double(r->p99));
+            json_object_object_add(obj, "max", json_object_new_double(r->max));
+            json_object_object_add(trial, "latency_seconds", obj);
+            /* time spent in each phase of the trial */
+            obj = json_object_new_object();
+            json_object_object_add(obj, "warmup_seconds",
+                                   json_object_new_double(r->warmup_seconds));
+            json_object_object_add(obj, "measured_seconds",
+                                   json_object_new_double(r->seconds));
+            json_object_object_add(trial, "phases", obj);
+            obj = json_object_new_object();
+            json_object_object_add(obj, "client_seconds",
+                                   json_object_new_double(r->client_cpu));
+            json_object_object_add(obj, "server_seconds",
+                                   json_object_new_double(r->server_cpu));
+            json_object_object_add(trial, "cpu", obj);
+            json_object_array_add(list, trial);
+        }
+        json_object_object_add(cfg, "trials", list);
+
+        obj = json_object_new_object();
+        for (m = 0; m < (int)(sizeof(metrics) / sizeof(metrics[0])); m++)
+            summarize_metric(obj, metrics[m].name, &results[c * trials],
+                             metrics[m].offset, trials);
+        json_object_object_add(cfg, "summary", obj);
+        json_object_array_add(cfgs, cfg);
+    }
+    json_object_object_add(summary, "configurations", cfgs);
+
+    if (json_object_to_file_ext(path, summary,
+                                JSON_C_TO_STRING_PRETTY
+                                    | JSON_C_TO_STRING_NOSLASHESCAPE)
+        != 0) {
+        fprintf(stderr, "Error writing %s: %s\n", path,
+                json_util_get_last_err());
+        ret = -1;
+    }
+    json_object_put(summary);
+    return ret;
+}
+
+/* true if MPI_Wtime() is synchronized across the ranks of comm */
+static int wtime_is_global(MPI_Comm comm)
+{
+    int* flag;
+    int  found;
+
+    MPI_Comm_get_attr(comm, MPI_WTIME_IS_GLOBAL, &flag, &found);
+    return found && *flag;
+}
+
+/* copies the group view of rank 0 to the other ranks.  Members are packed
+ * as rank, provider id, and null-terminated address.
+ */
+static int bcast_group_view(flock_group_view_t* view, int my_rank)
+{
+    char*    buf = NULL;
+    char*    p;
+    long     len = 0;
+    uint64_t rank;
+    uint16_t provider_id;
+    size_t   i;
+
+    if (my_rank == 0) {
+        for (i = 0; i < flock_group_view_member_count(view); i++)
+            len += sizeof(rank) + sizeof(provider_id)
+                 + strlen(view->members.data[i].address) + 1;
+        p = buf = malloc(len);
+        if (!buf) {
+            perror("malloc");
+            return -1;
+        }
+        for (i = 0; i < flock_group_view_member_count(view); i++) {
+            rank        = view->members.data[i].rank;
+            provider_id = view->members.data[i].provider_id;
+            memcpy(p, &rank, sizeof(rank));
+            p += sizeof(rank);
+            memcpy(p, &provider_id, sizeof(provider_id));
+            p += sizeof(provider_id);
+            strcpy(p, view->members.data[i].address);
+            p += strlen(p) + 1;
+        }
+    }
+
+    MPI_Bcast(&len, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    if (my_rank != 0) {
+        buf = malloc(len);
+        if (!buf) {
+            perror("malloc");
+            return -1;
+        }
+    }
+    MPI_Bcast(buf, len, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (my_rank != 0) {
+        for (p = buf; p < buf + len; p += strlen(p) + 1) {
+            memcpy(&rank, p, sizeof(rank));
+            p += sizeof(rank);
+            memcpy(&provider_id, p, sizeof(provider_id));
+            p += sizeof(provider_id);
+            if (!flock_group_view_add_member(view, rank, provider_id, p)) {
+                fprintf(stderr, "Error: flock_group_view_add_member()\n");
+                free(buf);
+                return -1;
+            }
+        }
+    }
+
+    free(buf);
+    return 0;
+}
+
+/* copies the target list of rank 0 to the other ranks, whose targets then
+ * point into their own copy of the group view
+ */
+static int bcast_targets(const flock_group_view_t* view,
+                         struct bench_target**     targets,
+                         int*                      ntargets,
+                         int                       my_rank)
+{
+    int* ids;
+    int  i;
+
+    MPI_Bcast(ntargets, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    ids = malloc(2 * (size_t)*ntargets * sizeof(*ids));
+    if (!ids) {
         perror("malloc");
-        return (-1);
-    }
-    fread(json_cfg_str, 1, fsize, f);
-    fclose(f);
-    json_cfg_str[fsize] = 0;
-
-    /* parse json */
-    tokener = json_tokener_new();
-    *json_cfg
-        = json_tokener_parse_ex(tokener, json_cfg_str, strlen(json_cfg_str));
-    if (!(*json_cfg)) {
-        jerr = json_tokener_get_error(tokener);
-        fprintf(stderr, "JSON parse error: %s", json_tokener_error_desc(jerr));
-        json_tokener_free(tokener);
-        free(json_cfg_str);
         return -1;
     }
-    json_tokener_free(tokener);
-    free(json_cfg_str);
+    if (my_rank == 0) {
+        for (i = 0; i < *ntargets; i++) {
+            ids[2 * i]     = (*targets)[i].member;
+            ids[2 * i + 1] = (*targets)[i].provider_id;
+        }
+    }
+    MPI_Bcast(ids, 2 * *ntargets, MPI_INT, 0, MPI_COMM_WORLD);
 
-    /* validate input params or fill in defaults */
-    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
-    CONFIG_OVERRIDE_INTEGER(*json_cfg, "nranks", nranks, 1);
-
-    /* set defaults if not present */
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "provider_id", 1, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "duration_seconds", 2, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "req_buffer_size", 128, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "resp_buffer_size", 128, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "bulk_size", 16384, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, string, "bulk_direction", "pull", val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, int, "warmup_iterations", 10, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "use_server_poolset", 1, val);
-    CONFIG_HAS_OR_CREATE(*json_cfg, boolean, "trace", 1, val);
-
-    return (0);
+    if (my_rank != 0) {
+        *targets = calloc(*ntargets, sizeof(**targets));
+        if (!*targets) {
+            perror("calloc");
+            free(ids);
+            return -1;
+        }
+        for (i = 0; i < *ntargets; i++) {
+            (*targets)[i].member      = ids[2 * i];
+            (*targets)[i].address     = view->members.data[ids[2 * i]].address;
+            (*targets)[i].provider_id = ids[2 * i + 1];
+        }
+    }
+
+    free(ids);
+    return 0;
 }
 
 static int parse_args(int                  argc,
@@ -606,6 +1413,7 @@ static int parse_args(int                  argc,
 {
     int opt;
     int ret;
+    int nranks;
 
     memset(opts, 0, sizeof(*opts));
 
@@ -639,7 +1447,8 @@ static int parse_args(int                  argc,
         strcat(opts->output_file, ".gz");
     }
 
-    return (parse_json(opts->json_file, json_cfg));
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    return (bench_parse_json(opts->json_file, nranks, json_cfg));
 }
 
 static void usage(void)
@@ -650,33 +1459,3 @@ static void usage(void)
             "<output file>\n");
     return;
 }
-
-static int sample_compare(const void* p1, const void* p2)
-{
-    double d1 = *((double*)p1);
-    double d2 = *((double*)p2);
-
-    if (d1 > d2) return 1;
-    if (d1 < d2) return -1;
-    return 0;
-}
-
-static int local_stat(double* utime_sec, double* stime_sec, double* alltime_sec)
-{
-    struct rusage usage;
-    int           ret;
-
-    ret = getrusage(RUSAGE_SELF, &usage);
-    if (ret != 0) {
-        perror("getrusage");
-        return (-1);
-    }
-
-    *utime_sec = (double)usage.ru_utime.tv_sec
-               + (double)usage.ru_utime.tv_usec / (double)1E6L;
-    *stime_sec = (double)usage.ru_stime.tv_sec
-               + (double)usage.ru_utime.tv_usec / (double)1E6L;
-    *alltime_sec = *utime_sec + *stime_sec;
-
-    return (0);
-}
@@ -10,14 +10,18 @@
 #include <quintain-client.h>
 
 #include "quintain-rpc.h"
+#include "quintain-payload.h"
 
 struct quintain_client {
     margo_instance_id mid;
 
     hg_id_t qtn_work_rpc_id;
     hg_id_t qtn_stat_rpc_id;
+    hg_id_t qtn_set_config_rpc_id;
+    hg_id_t qtn_work_batch_rpc_id;
 
     uint64_t num_provider_handles;
+    uint64_t payload_seq; /* distinguishes payload patterns across ops */
 };
 
 struct quintain_provider_handle {
@@ -27,6 +31,20 @@ struct quintain_provider_handle {
     uint64_t                refcount;
 };
 
+static hg_return_t qtn_strided_bulk_create(margo_instance_id mid,
+                                           void*             buffer,
+                                           hg_size_t         bulk_size,
+                                           uint32_t          count,
+                                           hg_size_t         stride,
+                                           uint8_t           bulk_flags,
+                                           hg_bulk_t*        handle);
+static uint32_t qtn_strided_buffer_touch(void*     buffer,
+                                         hg_size_t bulk_size,
+                                         uint32_t  count,
+                                         hg_size_t stride,
+                                         int       fill,
+                                         uint64_t  seed);
+
 int quintain_client_init(margo_instance_id mid, quintain_client_t* client)
 {
     hg_bool_t already_registered_flag;
@@ -45,11 +63,23 @@ int quintain_client_init(margo_instance_id mid, quintain_client_t* client)
                               &already_registered_flag);
         margo_registered_name(mid, "qtn_stat_rpc", &c->qtn_stat_rpc_id,
                               &already_registered_flag);
+        margo_registered_name(mid, "qtn_set_config_rpc",
+                              &c->qtn_set_config_rpc_id,
+                              &already_registered_flag);
+        margo_registered_name(mid, "qtn_work_batch_rpc",
+                              &c->qtn_work_batch_rpc_id,
+                              &already_registered_flag);
     } else { /* RPCs not already registered */
         c->qtn_work_rpc_id = MARGO_REGISTER(mid, "qtn_work_rpc", qtn_work_in_t,
                                             qtn_work_out_t, NULL);
         c->qtn_stat_rpc_id
             = MARGO_REGISTER(mid, "qtn_stat_rpc", void, qtn_stat_out_t, NULL);
+        c->qtn_set_config_rpc_id
+            = MARGO_REGISTER(mid, "qtn_set_config_rpc", qtn_set_config_in_t,
+                             qtn_set_config_out_t, NULL);
+        c->qtn_work_batch_rpc_id
+            = MARGO_REGISTER(mid, "qtn_work_batch_rpc", qtn_work_batch_in_t,
+                             qtn_work_batch_out_t, NULL);
     }
 
     *client = c;
@@ -108,6 +138,120 @@ int quintain_provider_handle_release(quintain_provider_handle_t handle)
     return QTN_SUCCESS;
 }
 
+/* creates a handle for a work request to provider and forwards it without
+ * waiting for the response
+ */
+static hg_return_t qtn_work_send(quintain_provider_handle_t provider,
+                                 qtn_work_in_t*             in,
+                                 double                     timeout_ms,
+                                 hg_handle_t*               handle,
+                                 margo_request*             req)
+{
+    hg_return_t hret;
+
+    hret = margo_create(provider->client->mid, provider->addr,
+                        provider->client->qtn_work_rpc_id, handle);
+    if (hret != HG_SUCCESS) return hret;
+    if (timeout_ms > 0)
+        hret = margo_provider_iforward_timed(provider->provider_id, *handle,
+                                             in, timeout_ms, req);
+    else
+        hret = margo_provider_iforward(provider->provider_id, *handle, in,
+                                       req);
+    if (hret != HG_SUCCESS) {
+        margo_destroy(*handle);
+        *handle = HG_HANDLE_NULL;
+    }
+    return hret;
+}
+
+/* returns true if two handles refer to the same provider */
+static int qtn_same_provider(quintain_provider_handle_t a,
+                             quintain_provider_handle_t b)
+{
+    return a == b
+        || (a->provider_id == b->provider_id
+            && margo_addr_cmp(a->client->mid, a->addr, b->addr));
+}
+
+/* Sends one attempt of a work request and waits for it to complete.  If
+ * info asks for hedging and the provider has not answered within the hedge
+ * delay, a duplicate goes to the hedge provider (unless that is the same
+ * provider); the first of the two to complete without a Mercury error is
+ * kept, whatever its response says, and the other is cancelled.  *handle
+ * is set to the handle holding the response (or the failure), which the
+ * caller destroys.
+ */
+static hg_return_t qtn_work_forward(quintain_provider_handle_t       provider,
+                                    qtn_work_in_t*                   in,
+                                    const struct quintain_work_info* info,
+                                    struct quintain_work_outcome*    outcome,
+                                    hg_handle_t*                     handle)
+{
+    hg_handle_t   handles[2] = {HG_HANDLE_NULL, HG_HANDLE_NULL};
+    margo_request reqs[2]    = {MARGO_REQUEST_NULL, MARGO_REQUEST_NULL};
+    double        timeout_ms = info ? info->timeout_ms : 0;
+    double        hedge_ts;
+    double        wait_ms;
+    size_t        count = 1;
+    size_t        index = 0;
+    size_t        other;
+    int           flag = 0;
+    hg_return_t   hret;
+    hg_return_t   other_hret;
+
+    hret = qtn_work_send(provider, in, timeout_ms, &handles[0], &reqs[0]);
+    if (hret != HG_SUCCESS) return hret;
+    outcome->attempts++;
+
+    if (info && info->hedge_provider
+        && !qtn_same_provider(provider, info->hedge_provider)) {
+        /* check for the response until it is time to hedge, sleeping for a
+         * tenth of the hedge delay at a time rather than spinning
+         */
+        hedge_ts = ABT_get_wtime() + info->hedge_delay_ms / 1e3;
+        while (margo_test(reqs[0], &flag) == 0 && !flag) {
+            wait_ms = (hedge_ts - ABT_get_wtime()) * 1e3;
+            if (wait_ms <= 0) {
+                if (qtn_work_send(info->hedge_provider, in, timeout_ms,
+                                  &handles[1], &reqs[1])
+                    == HG_SUCCESS) {
+                    count = 2;
+                    outcome->hedges++;
+                }
+                break;
+            }
+            if (wait_ms > info->hedge_delay_ms / 10)
+                wait_ms = info->hedge_delay_ms / 10;
+            margo_thread_sleep(provider->client->mid, wait_ms);
+        }
+    }
+
+    hret = margo_wait_any(count, reqs, &index);
+    if (hret == HG_TIMEOUT) outcome->timeouts++;
+    if (count == 2) {
+        other = 1 - index;
+        if (hret == HG_SUCCESS) {
+            /* abandon the slower request */
+            HG_Cancel(handles[other]);
+            margo_wait(reqs[other]);
+        } else {
+            /* the other request may still succeed */
+            other_hret = margo_wait(reqs[other]);
+            if (other_hret == HG_TIMEOUT) outcome->timeouts++;
+            if (other_hret == HG_SUCCESS) {
+                other = index;
+                index = 1 - other;
+                hret  = other_hret;
+            }
+        }
+        margo_destroy(handles[other]);
+        if (hret == HG_SUCCESS && index == 1) outcome->hedge_won++;
+    }
+    *handle = handles[index];
+    return hret;
+}
+
 int quintain_work(quintain_provider_handle_t provider,
                   int                        req_buffer_size,
                   int                        resp_buffer_size,
@@ -116,31 +260,101 @@ int quintain_work(quintain_provider_handle_t provider,
                   void*                      bulk_buffer,
                   int                        flags)
 {
-    hg_handle_t    handle = HG_HANDLE_NULL;
-    qtn_work_in_t  in;
-    qtn_work_out_t out;
-    int            ret = 0;
-    hg_return_t    hret;
-    int            bulk_flags = HG_BULK_READ_ONLY;
+    return (quintain_work_ext(provider, req_buffer_size, resp_buffer_size,
+                              bulk_size, bulk_op, bulk_buffer, flags, NULL));
+}
 
-    hret = margo_create(provider->client->mid, provider->addr,
-                        provider->client->qtn_work_rpc_id, &handle);
-    if (hret != HG_SUCCESS) {
-        ret = QTN_ERR_MERCURY;
-        goto finish;
-    }
+int quintain_work_ext(quintain_provider_handle_t       provider,
+                      int                              req_buffer_size,
+                      int                              resp_buffer_size,
+                      hg_size_t                        bulk_size,
+                      hg_bulk_op_t                     bulk_op,
+                      void*                            bulk_buffer,
+                      int                              flags,
+                      const struct quintain_work_info* info)
+{
+    hg_handle_t                  handle = HG_HANDLE_NULL;
+    qtn_work_in_t                in;
+    qtn_work_out_t               out;
+    int                          ret = 0;
+    hg_return_t                  hret;
+    int                          bulk_flags = HG_BULK_READ_ONLY;
+    int                          verify     = flags & QTN_WORK_VERIFY_PAYLOAD;
+    uint32_t                     seg_count  = 1;
+    hg_size_t                    seg_stride = 0;
+    int                          have_out   = 0;
+    uint32_t                     retries    = 0;
+    double                       backoff_ms = 0;
+    struct quintain_work_outcome outcome;
+
+    memset(&outcome, 0, sizeof(outcome));
 
     in.bulk_op = bulk_op;
+    in.flags   = flags;
+    if (info) {
+        in.chunk_size       = info->bulk_chunk_size;
+        in.pipeline_depth   = info->bulk_pipeline_depth;
+        in.server_segments  = info->server_segment_count;
+        in.payload_seed     = info->payload_seed;
+        in.raw_size         = info->raw_size;
+        in.fault_delay_usec = info->fault_delay_usec;
+        retries             = info->max_retries;
+        backoff_ms          = info->retry_backoff_ms;
+        if (info->bulk_segment_count > 1) {
+            seg_count  = info->bulk_segment_count;
+            seg_stride = info->bulk_segment_stride;
+        }
+    } else {
+        in.chunk_size       = 0;
+        in.pipeline_depth   = 0;
+        in.server_segments  = 0;
+        in.payload_seed     = 0;
+        in.raw_size         = 0;
+        in.fault_delay_usec = 0;
+    }
+    in.req_crc  = 0;
+    in.bulk_crc = 0;
+    if (verify)
+        in.payload_seed += __atomic_fetch_add(&provider->client->payload_seq, 1,
+                                              __ATOMIC_RELAXED);
     if (bulk_op == HG_BULK_PUSH) bulk_flags = HG_BULK_WRITE_ONLY;
     in.bulk_handle      = HG_BULK_NULL;
     in.resp_buffer_size = resp_buffer_size;
     in.req_buffer_size  = req_buffer_size;
-    if (req_buffer_size)
+    if (req_buffer_size) {
         in.req_buffer = calloc(1, req_buffer_size);
-    else
+        if (!in.req_buffer) {
+            ret  = QTN_ERR_ALLOCATION;
+            hret = HG_NOMEM;
+            goto finish;
+        }
+        if (verify) {
+            qtn_payload_fill(in.req_buffer, req_buffer_size,
+                             in.payload_seed ^ QTN_PAYLOAD_SALT_REQ, 0);
+            in.req_crc = qtn_crc32c(0, in.req_buffer, req_buffer_size);
+        }
+    } else
         in.req_buffer = NULL;
     in.bulk_size = bulk_size;
-    if (bulk_size) {
+    if (bulk_size && verify && bulk_op == HG_BULK_PULL) {
+        /* the provider will pull this data; generate it and record its
+         * checksum so that the provider can verify it
+         */
+        in.bulk_crc = qtn_strided_buffer_touch(
+            bulk_buffer, bulk_size, seg_count, seg_stride, 1,
+            in.payload_seed ^ QTN_PAYLOAD_SALT_BULK);
+    }
+    if (bulk_size && seg_count > 1) {
+        hret = qtn_strided_bulk_create(provider->client->mid, bulk_buffer,
+                                       bulk_size, seg_count, seg_stride,
+                                       bulk_flags, &in.bulk_handle);
+        if (hret != HG_SUCCESS) {
+            ret = QTN_ERR_MERCURY;
+            QTN_ERROR(provider->client->mid, "margo_bulk_create: %s",
+                      HG_Error_to_string(hret));
+            goto finish;
+        }
+    } else if (bulk_size) {
         hret = margo_bulk_create(provider->client->mid, 1,
                                  (void**)(&bulk_buffer), &bulk_size, bulk_flags,
                                  &in.bulk_handle);
@@ -152,6 +366,159 @@ int quintain_work(quintain_provider_handle_t provider,
         }
     }
 
+    for (;;) {
+        hret = qtn_work_forward(provider, &in, info, &outcome, &handle);
+        if (hret == HG_SUCCESS) {
+            hret = margo_get_output(handle, &out);
+            if (hret != HG_SUCCESS) {
+                ret = QTN_ERR_MERCURY;
+                QTN_ERROR(provider->client->mid, "margo_get_output: %s",
+                          HG_Error_to_string(hret));
+                goto finish;
+            }
+            have_out = 1;
+            ret      = out.ret;
+        } else if (hret == HG_TIMEOUT) {
+            ret = QTN_ERR_TIMEOUT;
+        } else {
+            ret = QTN_ERR_MERCURY;
+            QTN_ERROR(provider->client->mid, "margo_provider_iforward: %s",
+                      HG_Error_to_string(hret));
+            goto finish;
+        }
+
+        /* failures that another attempt might avoid are retried after a
+         * growing pause
+         */
+        if (retries == 0
+            || (ret != QTN_ERR_TIMEOUT && ret != QTN_ERR_BUSY
+                && ret != QTN_ERR_INJECTED))
+            break;
+        retries--;
+        if (have_out) margo_free_output(handle, &out);
+        have_out = 0;
+        if (handle != HG_HANDLE_NULL) margo_destroy(handle);
+        handle = HG_HANDLE_NULL;
+        if (backoff_ms > 0)
+            margo_thread_sleep(provider->client->mid, backoff_ms);
+        backoff_ms *= 2;
+    }
+
+    if (verify && ret == QTN_SUCCESS) {
+        /* check the payloads that the provider generated */
+        if (out.resp_buffer_size
+            && qtn_crc32c(0, out.resp_buffer, out.resp_buffer_size)
+                   != out.resp_crc) {
+            QTN_ERROR(provider->client->mid,
+                      "response payload failed verification");
+            ret = QTN_ERR_INTEGRITY;
+        }
+        if (bulk_size && bulk_op == HG_BULK_PUSH
+            && qtn_strided_buffer_touch(bulk_buffer, bulk_size, seg_count,
+                                        seg_stride, 0, 0)
+                   != out.bulk_crc) {
+            QTN_ERROR(provider->client->mid,
+                      "bulk payload failed verification");
+            ret = QTN_ERR_INTEGRITY;
+        }
+    }
+
+finish:
+
+    if (in.bulk_handle != HG_BULK_NULL) margo_bulk_free(in.bulk_handle);
+    if (in.req_buffer) free(in.req_buffer);
+    if (have_out) margo_free_output(handle, &out);
+    if (handle != HG_HANDLE_NULL) margo_destroy(handle);
+    if (info && info->outcome) *info->outcome = outcome;
+
+    return (ret);
+}
+
+int quintain_work_batch(quintain_provider_handle_t provider,
+                        size_t                     count,
+                        struct quintain_work_op*   ops,
+                        int                        batch_flags)
+{
+    hg_handle_t          handle = HG_HANDLE_NULL;
+    qtn_work_batch_in_t  in;
+    qtn_work_batch_out_t out;
+    int                  ret = 0;
+    hg_return_t          hret;
+    void**               seg_ptrs    = NULL;
+    hg_size_t*           seg_sizes   = NULL;
+    uint32_t             nsegs       = 0;
+    int                  bulk_flags  = 0;
+    hg_size_t            bulk_offset = 0;
+    size_t               i;
+
+    memset(&in, 0, sizeof(in));
+    in.bulk_handle = HG_BULK_NULL;
+
+    if (count == 0 || count > UINT32_MAX) return QTN_ERR_INVALID_ARG;
+
+    hret = margo_create(provider->client->mid, provider->addr,
+                        provider->client->qtn_work_batch_rpc_id, &handle);
+    if (hret != HG_SUCCESS) {
+        ret = QTN_ERR_MERCURY;
+        goto finish;
+    }
+
+    in.count  = count;
+    in.flags  = batch_flags;
+    in.ops    = calloc(count, sizeof(*in.ops));
+    seg_ptrs  = calloc(count, sizeof(*seg_ptrs));
+    seg_sizes = calloc(count, sizeof(*seg_sizes));
+    if (!in.ops || !seg_ptrs || !seg_sizes) {
+        ret  = QTN_ERR_ALLOCATION;
+        hret = HG_NOMEM;
+        goto finish;
+    }
+
+    /* describe each operation and collect the bulk buffers of all of them
+     * so that they can be registered together
+     */
+    for (i = 0; i < count; i++) {
+        in.ops[i].req_buffer_size  = ops[i].req_buffer_size;
+        in.ops[i].resp_buffer_size = ops[i].resp_buffer_size;
+        in.ops[i].bulk_size        = ops[i].bulk_size;
+        in.ops[i].bulk_offset      = bulk_offset;
+        in.ops[i].flags            = ops[i].flags;
+        in.ops[i].bulk_op          = ops[i].bulk_op;
+        in.req_size += ops[i].req_buffer_size;
+        if (ops[i].bulk_size) {
+            seg_ptrs[nsegs]  = ops[i].bulk_buffer;
+            seg_sizes[nsegs] = ops[i].bulk_size;
+            nsegs++;
+            bulk_offset += ops[i].bulk_size;
+            /* the provider reads from pulled buffers and writes to pushed
+             * ones
+             */
+            bulk_flags |= (ops[i].bulk_op == HG_BULK_PUSH) ? HG_BULK_WRITE_ONLY
+                                                           : HG_BULK_READ_ONLY;
+        }
+        ops[i].ret = QTN_SUCCESS;
+    }
+    if (in.req_size) {
+        in.req_buffer = calloc(1, in.req_size);
+        if (!in.req_buffer) {
+            ret  = QTN_ERR_ALLOCATION;
+            hret = HG_NOMEM;
+            goto finish;
+        }
+    }
+    if (nsegs) {
+        if (bulk_flags == (HG_BULK_READ_ONLY | HG_BULK_WRITE_ONLY))
+            bulk_flags = HG_BULK_READWRITE;
+        hret = margo_bulk_create(provider->client->mid, nsegs, seg_ptrs,
+                                 seg_sizes, bulk_flags, &in.bulk_handle);
+        if (hret != HG_SUCCESS) {
+            ret = QTN_ERR_MERCURY;
+            QTN_ERROR(provider->client->mid, "margo_bulk_create: %s",
+                      HG_Error_to_string(hret));
+            goto finish;
+        }
+    }
+
     hret = margo_provider_forward(provider->provider_id, handle, &in);
     if (hret != HG_SUCCESS) {
         ret = QTN_ERR_MERCURY;
@@ -169,21 +536,112 @@ int quintain_work(quintain_provider_handle_t provider,
     }
 
     ret = out.ret;
+    if (ret == QTN_SUCCESS && out.count != count) {
+        QTN_ERROR(provider->client->mid,
+                  "batch response has %u results for %zu operations",
+                  out.count, count);
+        ret = QTN_ERR_MERCURY;
+    } else if (ret == QTN_SUCCESS) {
+        for (i = 0; i < count; i++) ops[i].ret = out.rets[i];
+    }
 
 finish:
 
     if (in.bulk_handle != HG_BULK_NULL) margo_bulk_free(in.bulk_handle);
-    if (in.req_buffer) free(in.req_buffer);
+    free(in.req_buffer);
+    free(in.ops);
+    free(seg_ptrs);
+    free(seg_sizes);
     if (hret == HG_SUCCESS) margo_free_output(handle, &out);
     if (handle != HG_HANDLE_NULL) margo_destroy(handle);
 
     return (ret);
 }
 
-int quintain_stat(quintain_provider_handle_t provider,
-                  double*                    utime_sec,
-                  double*                    stime_sec,
-                  double*                    alltime_sec)
+/* Registers bulk_size bytes of buffer as a multi-segment bulk handle made of
+ * count equally sized segments whose start addresses are stride bytes apart.
+ */
+static hg_return_t qtn_strided_bulk_create(margo_instance_id mid,
+                                           void*             buffer,
+                                           hg_size_t         bulk_size,
+                                           uint32_t          count,
+                                           hg_size_t         stride,
+                                           uint8_t           bulk_flags,
+                                           hg_bulk_t*        handle)
+{
+    void**      ptrs;
+    hg_size_t*  sizes;
+    hg_size_t   seg_size;
+    hg_return_t hret;
+    uint32_t    i;
+
+    if (count > bulk_size) count = bulk_size;
+    seg_size = bulk_size / count;
+    if (stride < seg_size) stride = seg_size;
+
+    ptrs  = malloc(count * sizeof(*ptrs));
+    sizes = malloc(count * sizeof(*sizes));
+    if (!ptrs || !sizes) {
+        free(ptrs);
+        free(sizes);
+        return HG_NOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        ptrs[i]  = (char*)buffer + i * stride;
+        sizes[i] = seg_size;
+    }
+    /* last segment picks up any remainder */
+    sizes[count - 1] += bulk_size % count;
+
+    hret = margo_bulk_create(mid, count, ptrs, sizes, bulk_flags, handle);
+
+    free(ptrs);
+    free(sizes);
+
+    return hret;
+}
+
+/* Walks the same strided layout as qtn_strided_bulk_create(), optionally
+ * filling each segment with the payload pattern, and returns the CRC32C of
+ * the segments taken in order.
+ */
+static uint32_t qtn_strided_buffer_touch(void*     buffer,
+                                         hg_size_t bulk_size,
+                                         uint32_t  count,
+                                         hg_size_t stride,
+                                         int       fill,
+                                         uint64_t  seed)
+{
+    hg_size_t seg_size;
+    hg_size_t this_size;
+    hg_size_t offset = 0;
+    uint32_t  crc    = 0;
+    char*     seg;
+    uint32_t  i;
+
+    if (count > bulk_size) count = bulk_size;
+    if (count == 0) count = 1;
+    seg_size = bulk_size / count;
+    if (stride < seg_size) stride = seg_size;
+
+    for (i = 0; i < count; i++) {
+        seg       = (char*)buffer + i * stride;
+        this_size = seg_size;
+        if (i == count - 1) this_size += bulk_size % count;
+        if (fill) qtn_payload_fill(seg, this_size, seed, offset);
+        crc = qtn_crc32c(crc, seg, this_size);
+        offset += this_size;
+    }
+
+    return crc;
+}
+
+/* issues a stat RPC; the output contains only scalars so it is copied out
+ * and the handle released before returning
+ */
+static int qtn_stat_query(quintain_provider_handle_t provider,
+                          qtn_stat_out_t*            stat_out)
 {
     hg_handle_t    handle = HG_HANDLE_NULL;
     qtn_stat_out_t out;
@@ -213,11 +671,83 @@ int quintain_stat(quintain_provider_handle_t provider,
         goto finish;
     }
 
-    ret        = out.ret;
+    ret       = out.ret;
+    *stat_out = out;
+
+finish:
+
+    if (hret == HG_SUCCESS) margo_free_output(handle, &out);
+    if (handle != HG_HANDLE_NULL) margo_destroy(handle);
+
+    return (ret);
+}
+
+int quintain_stat(quintain_provider_handle_t provider,
+                  double*                    utime_sec,
+                  double*                    stime_sec,
+                  double*                    alltime_sec)
+{
+    qtn_stat_out_t out;
+    int            ret;
+
+    ret = qtn_stat_query(provider, &out);
+    if (ret != QTN_SUCCESS) return (ret);
+
     *utime_sec = (double)out.utime_sec + (double)out.utime_usec / (double)1E6L;
     *stime_sec = (double)out.stime_sec + (double)out.stime_usec / (double)1E6L;
     *alltime_sec = *utime_sec + *stime_sec;
 
+    return (ret);
+}
+
+int quintain_stat_energy(quintain_provider_handle_t provider, double* joules)
+{
+    qtn_stat_out_t out;
+    int            ret;
+
+    ret = qtn_stat_query(provider, &out);
+    if (ret != QTN_SUCCESS) return (ret);
+
+    *joules = out.energy_uj < 0 ? -1 : (double)out.energy_uj / 1e6;
+
+    return (ret);
+}
+
+int quintain_set_config(quintain_provider_handle_t provider,
+                        const char*                json_config)
+{
+    hg_handle_t          handle = HG_HANDLE_NULL;
+    qtn_set_config_in_t  in;
+    qtn_set_config_out_t out;
+    int                  ret = 0;
+    hg_return_t          hret;
+
+    hret = margo_create(provider->client->mid, provider->addr,
+                        provider->client->qtn_set_config_rpc_id, &handle);
+    if (hret != HG_SUCCESS) {
+        ret = QTN_ERR_MERCURY;
+        goto finish;
+    }
+
+    in.json_config = json_config;
+    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    if (hret != HG_SUCCESS) {
+        ret = QTN_ERR_MERCURY;
+        QTN_ERROR(provider->client->mid, "margo_provider_forward: %s",
+                  HG_Error_to_string(hret));
+        goto finish;
+    }
+
+    hret = margo_get_output(handle, &out);
+    if (hret != HG_SUCCESS) {
+        ret = QTN_ERR_MERCURY;
+        QTN_ERROR(provider->client->mid, "margo_get_output: %s",
+                  HG_Error_to_string(hret));
+        goto finish;
+    }
+
+    ret = out.ret;
+
 finish:
 
     if (hret == HG_SUCCESS) margo_free_output(handle, &out);
@@ -0,0 +1,305 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "quintain.h"
+#include "quintain-macros.h"
+#include "quintain-payload.h"
+#include "quintain-fault.h"
+
+static const char* const qtn_fault_delay_names[]
+    = {"none", "fixed", "exponential", "pareto", NULL};
+
+int qtn_fault_init(struct qtn_fault* fault)
+{
+    memset(fault, 0, sizeof(*fault));
+    if (ABT_mutex_create(&fault->mutex) != ABT_SUCCESS) {
+        fault->mutex = ABT_MUTEX_NULL;
+        return -1;
+    }
+    fault->epoch = ABT_get_wtime();
+    return 0;
+}
+
+void qtn_fault_finalize(struct qtn_fault* fault)
+{
+    if (fault->mutex != ABT_MUTEX_NULL) ABT_mutex_free(&fault->mutex);
+    fault->mutex = ABT_MUTEX_NULL;
+}
+
+/* Looks up a non-negative numeric setting of the "fault_injection" object,
+ * creating it with a default value if it is absent.  Integers are accepted
+ * where a fraction is expected.  max < 0 means no upper bound.
+ */
+static int qtn_fault_number(struct json_object* obj,
+                            const char*         key,
+                            int                 integral,
+                            double              def,
+                            double              max,
+                            double*             out)
+{
+    struct json_object* val = json_object_object_get(obj, key);
+
+    if (!val) {
+        val = integral ? json_object_new_int64((int64_t)def)
+                       : json_object_new_double(def);
+        json_object_object_add(obj, key, val);
+    }
+    if (!json_object_is_type(val, json_type_int)
+        && !json_object_is_type(val, json_type_double)) {
+        fprintf(stderr,
+                "\"fault_injection.%s\" in configuration but is not a "
+                "number\n",
+                key);
+        return -1;
+    }
+    *out = json_object_get_double(val);
+    if (*out < 0 || (max >= 0 && *out > max)) {
+        fprintf(stderr, "\"fault_injection.%s\" (%g) is out of range\n", key,
+                *out);
+        return -1;
+    }
+    return 0;
+}
+
+int qtn_fault_parse(struct json_object* config, struct qtn_fault_spec* spec)
+{
+    struct json_object*   fi;
+    struct json_object*   val;
+    struct qtn_fault_spec tmp;
+    const char*           name;
+
+    fi = json_object_object_get(config, "fault_injection");
+    if (!fi) {
+        fi = json_object_new_object();
+        json_object_object_add(config, "fault_injection", fi);
+    }
+    if (!json_object_is_type(fi, json_type_object)) {
+        fprintf(stderr,
+                "\"fault_injection\" in configuration but is not an "
+                "object\n");
+        return -1;
+    }
+
+    memset(&tmp, 0, sizeof(tmp));
+
+    CONFIG_HAS_OR_CREATE(fi, int64, "seed", 0, val);
+    tmp.seed = json_object_get_int64(val);
+
+    /* distribution of the extra delay: "fixed" always waits delay_usec,
+     * "exponential" and "pareto" draw a delay with that mean, the latter
+     * with a heavy tail whose weight is set by delay_pareto_alpha (smaller
+     * is heavier); delay_max_usec truncates long draws
+     */
+    CONFIG_HAS_OR_CREATE(fi, string, "delay_distribution", "none", val);
+    name = json_object_get_string(val);
+    while (qtn_fault_delay_names[tmp.delay]
+           && strcmp(qtn_fault_delay_names[tmp.delay], name))
+        tmp.delay++;
+    if (!qtn_fault_delay_names[tmp.delay]) {
+        fprintf(stderr, "unknown fault_injection delay_distribution \"%s\"\n",
+                name);
+        return -1;
+    }
+    if (qtn_fault_number(fi, "delay_probability", 0, 1.0, 1.0,
+                         &tmp.delay_probability)
+            != 0
+        || qtn_fault_number(fi, "delay_usec", 1, 0, -1, &tmp.delay_mean) != 0
+        || qtn_fault_number(fi, "delay_pareto_alpha", 0, 1.5, -1,
+                            &tmp.delay_alpha)
+               != 0
+        || qtn_fault_number(fi, "delay_max_usec", 1, 0, -1, &tmp.delay_max)
+               != 0)
+        return -1;
+    if (tmp.delay == QTN_FAULT_DELAY_PARETO && tmp.delay_alpha <= 1.0) {
+        fprintf(stderr, "fault_injection delay_pareto_alpha must be > 1\n");
+        return -1;
+    }
+    tmp.delay_mean /= 1e6;
+    tmp.delay_max /= 1e6;
+
+    /* stall the provider for stall_duration_ms out of every
+     * stall_interval_ms
+     */
+    if (qtn_fault_number(fi, "stall_interval_ms", 1, 0, -1,
+                         &tmp.stall_interval)
+            != 0
+        || qtn_fault_number(fi, "stall_duration_ms", 1, 0, -1,
+                            &tmp.stall_duration)
+               != 0)
+        return -1;
+    if (tmp.stall_duration > tmp.stall_interval) {
+        fprintf(stderr, "fault_injection stall_duration_ms exceeds "
+                        "stall_interval_ms\n");
+        return -1;
+    }
+    tmp.stall_interval /= 1e3;
+    tmp.stall_duration /= 1e3;
+
+    /* fractions of requests that fail or never get a response */
+    if (qtn_fault_number(fi, "error_rate", 0, 0.0, 1.0, &tmp.error_rate) != 0
+        || qtn_fault_number(fi, "drop_rate", 0, 0.0, 1.0, &tmp.drop_rate)
+               != 0)
+        return -1;
+
+    if (spec) *spec = tmp;
+    return 0;
+}
+
+static int qtn_fault_spec_equal(const struct qtn_fault_spec* a,
+                                const struct qtn_fault_spec* b)
+{
+    return a->seed == b->seed && a->delay == b->delay
+        && a->delay_probability == b->delay_probability
+        && a->delay_mean == b->delay_mean && a->delay_alpha == b->delay_alpha
+        && a->delay_max == b->delay_max
+        && a->stall_interval == b->stall_interval
+        && a->stall_duration == b->stall_duration
+        && a->error_rate == b->error_rate && a->drop_rate == b->drop_rate;
+}
+
+void qtn_fault_configure(struct qtn_fault*            fault,
+                         const struct qtn_fault_spec* spec)
+{
+    int enabled;
+
+    /* leave the schedule alone when some unrelated setting changed */
+    ABT_mutex_lock(fault->mutex);
+    if (!qtn_fault_spec_equal(&fault->spec, spec)) {
+        fault->spec     = *spec;
+        fault->epoch    = ABT_get_wtime();
+        fault->sequence = 0;
+    }
+    ABT_mutex_unlock(fault->mutex);
+
+    enabled = spec->delay != QTN_FAULT_DELAY_NONE
+           || (spec->stall_interval > 0 && spec->stall_duration > 0)
+           || spec->error_rate > 0 || spec->drop_rate > 0;
+    __atomic_store_n(&fault->enabled, enabled, __ATOMIC_RELAXED);
+}
+
+/* the i-th uniform draw in [0, 1) for the request with the given key */
+static double qtn_fault_uniform(uint64_t key, int i)
+{
+    return (qtn_mix64(key + i) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double qtn_fault_delay(const struct qtn_fault_spec* spec, double u)
+{
+    double delay = spec->delay_mean;
+
+    switch (spec->delay) {
+    case QTN_FAULT_DELAY_EXPONENTIAL:
+        delay = -spec->delay_mean * log(1.0 - u);
+        break;
+    case QTN_FAULT_DELAY_PARETO:
+        /* scale chosen so that the mean is delay_mean */
+        delay = spec->delay_mean * (spec->delay_alpha - 1.0)
+              / spec->delay_alpha / pow(1.0 - u, 1.0 / spec->delay_alpha);
+        break;
+    default:
+        break;
+    }
+    if (spec->delay_max > 0 && delay > spec->delay_max)
+        delay = spec->delay_max;
+    return delay;
+}
+
+int qtn_fault_inject(struct qtn_fault* fault,
+                     margo_instance_id mid,
+                     uint32_t          delay_usec,
+                     uint32_t          flags)
+{
+    struct qtn_fault_spec spec;
+    double                delay  = delay_usec / 1e6;
+    double                stall  = 0;
+    double                since;
+    uint64_t              key;
+    int                   action = QTN_FAULT_PASS;
+
+    if (flags & QTN_WORK_FAULT_DROP)
+        action = QTN_FAULT_DROP;
+    else if (flags & QTN_WORK_FAULT_ERROR)
+        action = QTN_FAULT_ERROR;
+
+    if (!(flags & QTN_WORK_NO_FAULTS) && qtn_fault_enabled(fault)) {
+        ABT_mutex_lock(fault->mutex);
+        spec  = fault->spec;
+        since = ABT_get_wtime() - fault->epoch;
+        key   = qtn_mix64(spec.seed ^ qtn_mix64(fault->sequence++));
+        ABT_mutex_unlock(fault->mutex);
+
+        if (spec.stall_interval > 0) {
+            since -= floor(since / spec.stall_interval) * spec.stall_interval;
+            if (since < spec.stall_duration)
+                stall = spec.stall_duration - since;
+        }
+        if (spec.delay != QTN_FAULT_DELAY_NONE
+            && qtn_fault_uniform(key, 0) < spec.delay_probability)
+            delay += qtn_fault_delay(&spec, qtn_fault_uniform(key, 1));
+        if (action == QTN_FAULT_PASS) {
+            if (qtn_fault_uniform(key, 2) < spec.drop_rate)
+                action = QTN_FAULT_DROP;
+            else if (qtn_fault_uniform(key, 3) < spec.error_rate)
+                action = QTN_FAULT_ERROR;
+        }
+    }
+
+    if (stall > 0) {
+        __atomic_fetch_add(&fault->stalled, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&fault->stall_ns, (uint64_t)(stall * 1e9),
+                           __ATOMIC_RELAXED);
+        margo_thread_sleep(mid, stall * 1e3);
+    }
+    if (delay > 0) {
+        __atomic_fetch_add(&fault->delayed, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&fault->delay_ns, (uint64_t)(delay * 1e9),
+                           __ATOMIC_RELAXED);
+        margo_thread_sleep(mid, delay * 1e3);
+    }
+    if (action == QTN_FAULT_ERROR)
+        __atomic_fetch_add(&fault->errors, 1, __ATOMIC_RELAXED);
+    else if (action == QTN_FAULT_DROP)
+        __atomic_fetch_add(&fault->drops, 1, __ATOMIC_RELAXED);
+
+    return action;
+}
+
+struct json_object* qtn_fault_to_json(struct qtn_fault* fault)
+{
+    struct json_object* obj = json_object_new_object();
+
+    json_object_object_add(
+        obj, "requests_delayed",
+        json_object_new_int64(
+            __atomic_load_n(&fault->delayed, __ATOMIC_RELAXED)));
+    json_object_object_add(
+        obj, "delay_seconds",
+        json_object_new_double(
+            __atomic_load_n(&fault->delay_ns, __ATOMIC_RELAXED) / 1e9));
+    json_object_object_add(
+        obj, "requests_stalled",
+        json_object_new_int64(
+            __atomic_load_n(&fault->stalled, __ATOMIC_RELAXED)));
+    json_object_object_add(
+        obj, "stall_seconds",
+        json_object_new_double(
+            __atomic_load_n(&fault->stall_ns, __ATOMIC_RELAXED) / 1e9));
+    json_object_object_add(
+        obj, "errors_injected",
+        json_object_new_int64(
+            __atomic_load_n(&fault->errors, __ATOMIC_RELAXED)));
+    json_object_object_add(
+        obj, "responses_dropped",
+        json_object_new_int64(
+            __atomic_load_n(&fault->drops, __ATOMIC_RELAXED)));
+
+    return obj;
+}
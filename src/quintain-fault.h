@@ -0,0 +1,106 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __QUINTAIN_FAULT
+#define __QUINTAIN_FAULT
+
+#include <stdint.h>
+#include <abt.h>
+#include <margo.h>
+#include <json-c/json.h>
+
+/* Fault and latency injection for work requests.  Each request may be
+ * delayed by an amount drawn from a fixed, exponential, or Pareto
+ * (heavy-tailed) distribution, failed with QTN_ERR_INJECTED, or have its
+ * response dropped, each at a configured rate.  Independently, the
+ * provider can stall periodically: requests that arrive during a stall
+ * wait until it is over.  Clients only recover from a dropped response if
+ * they set a timeout.  Batches are delayed and stalled like single
+ * requests, but one that draws a drop is failed instead, as batches cannot
+ * time out.
+ *
+ * The decisions for a request are drawn from a counter-based generator
+ * keyed by the seed and the position of the request in arrival order, so
+ * a given seed always yields the same sequence of faults.
+ */
+
+enum qtn_fault_delay {
+    QTN_FAULT_DELAY_NONE = 0,
+    QTN_FAULT_DELAY_FIXED,
+    QTN_FAULT_DELAY_EXPONENTIAL,
+    QTN_FAULT_DELAY_PARETO
+};
+
+/* what to do with a request once any delay has passed */
+enum qtn_fault_action {
+    QTN_FAULT_PASS = 0, /* carry it out as usual */
+    QTN_FAULT_ERROR,    /* respond with QTN_ERR_INJECTED */
+    QTN_FAULT_DROP      /* do not respond at all */
+};
+
+/* settings from the "fault_injection" configuration object */
+struct qtn_fault_spec {
+    uint64_t seed;
+    int      delay;             /* enum qtn_fault_delay */
+    double   delay_probability; /* fraction of requests that are delayed */
+    double   delay_mean;        /* mean delay in seconds */
+    double   delay_alpha;       /* Pareto shape parameter (> 1) */
+    double   delay_max;         /* longest single delay (0 = no limit) */
+    double   stall_interval;    /* seconds between stalls (0 = never) */
+    double   stall_duration;    /* seconds that each stall lasts */
+    double   error_rate;        /* fraction of requests failed */
+    double   drop_rate;         /* fraction of responses dropped */
+};
+
+struct qtn_fault {
+    int                   enabled; /* any fault is configured */
+    ABT_mutex             mutex;   /* protects spec, epoch, and sequence */
+    struct qtn_fault_spec spec;
+    double                epoch;    /* when the stall schedule started */
+    uint64_t              sequence; /* requests drawn for so far */
+
+    /* statistics */
+    uint64_t delayed;  /* requests delayed */
+    uint64_t delay_ns; /* total time spent in delays */
+    uint64_t stalled;  /* requests that arrived during a stall */
+    uint64_t stall_ns; /* total time requests spent waiting out stalls */
+    uint64_t errors;   /* requests failed */
+    uint64_t drops;    /* responses dropped */
+};
+
+int  qtn_fault_init(struct qtn_fault* fault);
+void qtn_fault_finalize(struct qtn_fault* fault);
+
+/* validates the "fault_injection" object of a provider configuration,
+ * creating it and filling in defaults as needed.  If spec is not NULL the
+ * settings are also extracted into it.
+ */
+int qtn_fault_parse(struct json_object* config, struct qtn_fault_spec* spec);
+
+/* replaces the settings in effect and restarts the stall schedule */
+void qtn_fault_configure(struct qtn_fault*            fault,
+                         const struct qtn_fault_spec* spec);
+
+/* returns true if the provider injects faults of its own */
+static inline int qtn_fault_enabled(struct qtn_fault* fault)
+{
+    return __atomic_load_n(&fault->enabled, __ATOMIC_RELAXED);
+}
+
+/* Decides the fate of one work request, combining the configured faults
+ * with those the request asks for itself (a fixed delay and the
+ * QTN_WORK_FAULT_* and QTN_WORK_NO_FAULTS flags).  Sleeps through any stall
+ * and delay and returns an enum qtn_fault_action.
+ */
+int qtn_fault_inject(struct qtn_fault* fault,
+                     margo_instance_id mid,
+                     uint32_t          delay_usec,
+                     uint32_t          flags);
+
+/* returns an object with the injection statistics */
+struct json_object* qtn_fault_to_json(struct qtn_fault* fault);
+
+#endif /* __QUINTAIN_FAULT */
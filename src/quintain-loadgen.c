@@ -0,0 +1,860 @@
+/*
+ * Copyright (c) 2021 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "mochi-quintain-config.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#include <json-c/json.h>
+
+#include <abt.h>
+#include <quintain-client.h>
+#include <quintain-server.h>
+#include <flock/flock-group-view.h>
+#include <flock/flock-group.h>
+
+#include "quintain-benchmark-util.h"
+#include "quintain-rapl.h"
+#include "bedrock-c-wrapper.h"
+
+/* Standalone load generator.  This runs the same workloads as
+ * quintain-benchmark and produces the same output format, but uses
+ * pthreads within a single process in place of MPI ranks.  Each pthread
+ * drives one client context and is reported as if it were a rank.
+ *
+ * With -l the provider runs inside this process instead of in a bedrock
+ * daemon, either on the client's own margo instance ("self") or on a
+ * second margo instance using the given protocol (e.g. "na+sm").  This
+ * measures the software overhead of the RPC path without a network.
+ */
+
+struct options {
+    char group_file[256];
+    char json_file[256];
+    char output_file[256];
+    char loopback[64];
+    int  ncontexts;
+};
+
+/* a provider running in this process (-l) */
+struct loopback {
+    margo_instance_id   svr_mid; /* dedicated instance, unless "self" */
+    quintain_provider_t provider;
+    int                 provider_id;
+};
+
+/* one client context, run by its own pthread */
+struct loadgen_context {
+    struct bench_workload      wl;
+    struct bench_client        bc;
+    quintain_provider_handle_t qph;
+    hg_addr_t                  addr;
+    quintain_provider_handle_t hedge_qph;  /* next target, for hedging */
+    hg_addr_t                  hedge_addr;
+    int                        svr_idx;
+    const char*                svr_addr_str;
+    int                        provider_id;
+    pthread_barrier_t*         barrier;
+    pthread_mutex_t*           start_mutex; /* held while contexts start */
+    int*                       start_abort; /* set if one failed to start */
+    int                        ret;
+};
+
+static int   parse_args(int                  argc,
+                        char**               argv,
+                        struct options*      opts,
+                        struct json_object** json_cfg);
+static void  usage(void);
+static void* loadgen_context_fn(void* arg);
+static int   loopback_start(const char*         mode,
+                            struct json_object* json_cfg,
+                            margo_instance_id*  mid,
+                            struct loopback*    lb,
+                            flock_group_view_t* view);
+static char* loopback_query_config(struct loopback* lb);
+static void  loopback_stop(struct loopback* lb);
+
+static struct json_object* loadgen_margo_config(struct json_object* json_cfg,
+                                                int                 server);
+
+int main(int argc, char** argv)
+{
+    int                      nproviders;
+    int                      ret;
+    flock_group_view_t       group_view      = FLOCK_GROUP_VIEW_INITIALIZER;
+    char*                    svr_addr_str    = NULL;
+    char                     proto[64]       = {0};
+    char*                    svr_cfg_str_raw = NULL;
+    char*                    cli_cfg_str     = NULL;
+    margo_instance_id        mid             = MARGO_INSTANCE_NULL;
+    quintain_client_t        qcl             = QTN_CLIENT_NULL;
+    flock_group_handle_t     fh              = FLOCK_GROUP_HANDLE_NULL;
+    bedrock_client_t         bcl             = NULL;
+    flock_client_t           fcl             = FLOCK_CLIENT_NULL;
+    bedrock_service_t        bsh             = NULL;
+    hg_addr_t                svr_addr        = HG_ADDR_NULL;
+    struct options           opts;
+    struct json_object*      json_cfg        = NULL;
+    double*                  samples         = NULL;
+    gzFile                   f               = NULL;
+    int                      i;
+    struct sample_statistics stats           = {0};
+    struct margo_init_info   mii             = {0};
+    struct json_object*      margo_config    = NULL;
+    struct json_object*      cli_margo       = NULL;
+    struct json_object*      svr_config      = NULL;
+    double                   svr_utime1, svr_stime1, svr_alltime1;
+    double                   svr_utime2, svr_stime2, svr_alltime2;
+    double                   svr_utime, svr_stime, svr_alltime;
+    double                   cli_utime1, cli_stime1, cli_alltime1;
+    double                   cli_utime2, cli_stime2, cli_alltime2;
+    double                   cli_utime, cli_stime, cli_alltime;
+    int                      provider_id     = -1;
+    struct bench_target*     targets         = NULL;
+    int                      ntargets        = 0;
+    double                   svr_raw_bytes   = 0;
+    struct loadgen_context*  contexts        = NULL;
+    pthread_t*               tids            = NULL;
+    pthread_barrier_t        barrier;
+    pthread_mutex_t          start_mutex     = PTHREAD_MUTEX_INITIALIZER;
+    int                      start_abort     = 0;
+    int                      ncontexts;
+    int                      nstarted        = 0;
+    int                      max_samples;
+    struct qtn_rapl          rapl            = {0};
+    double                   cli_joules1     = -1, cli_joules2 = -1;
+    double                   svr_joules1     = -1, svr_joules2 = -1;
+    double                   total_ops       = 0;
+    double                   origin;
+    struct loopback          lb              = {0};
+
+    ret = parse_args(argc, argv, &opts, &json_cfg);
+    if (ret < 0) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+    ncontexts = opts.ncontexts;
+
+    if (opts.loopback[0]) {
+        /* run the provider in this process; the group is just that one
+         * provider
+         */
+        ret = loopback_start(opts.loopback, json_cfg, &mid, &lb, &group_view);
+        if (ret != 0) goto err_margo_cleanup;
+        goto group_ready;
+    }
+
+    /* load the Flock group view */
+    flock_return_t fret
+        = flock_group_view_from_file(opts.group_file, &group_view);
+    if (fret != FLOCK_SUCCESS) {
+        fprintf(stderr, "Error: flock_group_view_from_file(): %d.\n", fret);
+        ret = -1;
+        goto err_json_cleanup;
+    }
+
+    /* find transport to initialize margo to match provider */
+    svr_addr_str = group_view.members.data[0].address;
+    provider_id  = group_view.members.data[0].provider_id;
+    for (int i = 0; i < 64 && svr_addr_str[i] != ':'; ++i)
+        proto[i] = svr_addr_str[i];
+
+    /* pass the "margo" section of the json configuration (if any) to
+     * margo_init_ext(), with a progress thread
+     */
+    cli_margo       = loadgen_margo_config(json_cfg, 0);
+    mii.json_config = json_object_to_json_string_ext(cli_margo,
+                                                     JSON_C_TO_STRING_PLAIN);
+    mid             = margo_init_ext(proto, MARGO_CLIENT_MODE, &mii);
+    if (!mid) {
+        fprintf(stderr, "Error: failed to initialize margo with %s protocol.\n",
+                proto);
+        ret = -1;
+        goto err_flock_cleanup;
+    }
+
+    /* initialize a Flock client and refresh the view in case it diverges
+     * from what was in the initial group file
+     */
+    ret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
+    if (ret != HG_SUCCESS) {
+        fprintf(stderr, "Error: margo_addr_lookup()\n");
+        goto err_margo_cleanup;
+    }
+
+    ret = flock_client_init(mid, ABT_POOL_NULL, &fcl);
+    if (ret != FLOCK_SUCCESS) {
+        fprintf(stderr, "Error: flock_client_init() failure, ret: %d.\n", ret);
+        goto err_flock_cleanup;
+    }
+
+    ret = flock_group_handle_create(fcl, svr_addr, provider_id, true, &fh);
+    if (ret != FLOCK_SUCCESS) {
+        fprintf(stderr,
+                "Error: flock_group_handle_create() failure, ret: %d.\n", ret);
+        goto err_flock_cleanup;
+    }
+
+    ret = flock_group_update_view(fh, NULL);
+    if (ret != FLOCK_SUCCESS) {
+        fprintf(stderr, "Error: flock_group_update_view() failure, ret: %d.\n",
+                ret);
+        goto err_flock_cleanup;
+    }
+
+    ret = flock_group_get_view(fh, &group_view);
+    if (ret != FLOCK_SUCCESS) {
+        fprintf(stderr, "Error: flock_group_get_view() failure, ret: %d.\n",
+                ret);
+        goto err_flock_cleanup;
+    }
+
+    ret = bedrock_client_init(mid, &bcl);
+    if (ret != BEDROCK_SUCCESS) {
+        fprintf(stderr, "Error: bedrock_client_init() failure.\n");
+        goto err_flock_cleanup;
+    }
+
+    /* configuration and server statistics come from the first provider */
+    ret = bedrock_service_handle_create(
+        bcl, group_view.members.data[0].address, 0, &bsh);
+    if (ret != BEDROCK_SUCCESS) {
+        fprintf(stderr, "Error: bedrock_service_handle_create() failure.\n");
+        goto err_br_cleanup;
+    }
+
+group_ready:
+    /* get the number of providers */
+    nproviders = flock_group_view_member_count(&group_view);
+    if (nproviders == 0) {
+        fprintf(stderr, "Error: flock group has no members.\n");
+        ret = -1;
+        goto err_br_cleanup;
+    }
+
+    ret = quintain_client_init(mid, &qcl);
+    if (ret != QTN_SUCCESS) {
+        fprintf(stderr, "Error: quintain_client_init() failure.\n");
+        goto err_br_cleanup;
+    }
+
+    /* find the quintain providers of every server (just the configured one
+     * for a loopback provider)
+     */
+    provider_id
+        = json_object_get_int(json_object_object_get(json_cfg, "provider_id"));
+    ret = bench_find_targets(
+        json_object_get_boolean(
+            json_object_object_get(json_cfg, "discover_providers"))
+            ? bcl
+            : NULL,
+        &group_view, provider_id, &targets, &ntargets);
+    if (ret != 0) goto err_qtn_cleanup;
+
+    /* if the configuration includes provider settings to change, apply them
+     * to every provider before the run starts (a loopback provider was
+     * registered with them already)
+     */
+    if (!opts.loopback[0]
+        && json_object_object_get(json_cfg, "server_config")) {
+        ret = bench_apply_server_config(
+            mid, qcl, targets, ntargets,
+            json_object_object_get(json_cfg, "server_config"));
+        if (ret != 0) goto err_qtn_cleanup;
+    }
+
+    /* the sample budget of one benchmark rank is shared by all contexts.
+     * Allocate with mmap rather than malloc just so we can use the
+     * MAP_POPULATE flag to get the paging out of the way before we start
+     * measurements
+     */
+    samples = mmap(NULL, MAX_SAMPLES * sizeof(double), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, 0, 0);
+    if (samples == MAP_FAILED) {
+        perror("mmap");
+        samples = NULL;
+        ret     = -1;
+        goto err_qtn_cleanup;
+    }
+    max_samples = MAX_SAMPLES / ncontexts;
+
+    /* each context selects exactly one provider to contact, the same way
+     * that benchmark ranks do
+     */
+    contexts = calloc(ncontexts, sizeof(*contexts));
+    tids     = calloc(ncontexts, sizeof(*tids));
+    if (!contexts || !tids) {
+        perror("calloc");
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+    if (ntargets < 2
+        && json_object_get_int(
+            json_object_object_get(json_cfg, "hedge_percentile")))
+        fprintf(stderr, "Warning: only one provider; requests will not be "
+                        "hedged.\n");
+    for (i = 0; i < ncontexts; i++) {
+        struct loadgen_context* ctx = &contexts[i];
+
+        ctx->barrier      = &barrier;
+        ctx->start_mutex  = &start_mutex;
+        ctx->start_abort  = &start_abort;
+        ctx->addr         = HG_ADDR_NULL;
+        ctx->hedge_addr   = HG_ADDR_NULL;
+        ctx->svr_idx      = targets[i % ntargets].member;
+        ctx->svr_addr_str = targets[i % ntargets].address;
+        ctx->provider_id  = targets[i % ntargets].provider_id;
+
+        ret = bench_workload_init(json_cfg, mid, (uint64_t)i << 40,
+                                  &ctx->wl);
+        if (ret != 0) goto err_qtn_cleanup;
+
+        ret = margo_addr_lookup(mid, ctx->svr_addr_str, &ctx->addr);
+        if (ret != HG_SUCCESS) {
+            fprintf(stderr, "Error: margo_addr_lookup()\n");
+            goto err_qtn_cleanup;
+        }
+        ret = quintain_provider_handle_create(qcl, ctx->addr,
+                                              ctx->provider_id, &ctx->qph);
+        if (ret != QTN_SUCCESS) {
+            fprintf(stderr,
+                    "Error: quintain_provider_handle_create() failure.\n");
+            goto err_qtn_cleanup;
+        }
+        /* hedged requests go to the next target, if there is another */
+        if (ntargets > 1) {
+            ret = margo_addr_lookup(mid, targets[(i + 1) % ntargets].address,
+                                    &ctx->hedge_addr);
+            if (ret != HG_SUCCESS) {
+                fprintf(stderr, "Error: margo_addr_lookup()\n");
+                goto err_qtn_cleanup;
+            }
+            ret = quintain_provider_handle_create(
+                qcl, ctx->hedge_addr, targets[(i + 1) % ntargets].provider_id,
+                &ctx->hedge_qph);
+            if (ret != QTN_SUCCESS) {
+                fprintf(stderr,
+                        "Error: quintain_provider_handle_create() failure.\n");
+                goto err_qtn_cleanup;
+            }
+        }
+        ret = bench_client_init(&ctx->bc, &ctx->wl, ctx->qph, ctx->hedge_qph,
+                                samples + (size_t)i * max_samples,
+                                max_samples);
+        if (ret != 0) goto err_qtn_cleanup;
+    }
+
+    /* energy counters for this node, if readable */
+    ret = qtn_rapl_init(&rapl, json_object_get_string(json_object_object_get(
+                                   json_cfg, "rapl_root")));
+    if (ret != 0) goto err_qtn_cleanup;
+
+    /* the main thread joins the contexts at the barrier that separates
+     * warm up from measurement, and again once measurement is about to
+     * start.  No context proceeds until all of them have been created,
+     * since the barrier could not be satisfied otherwise.
+     */
+    pthread_barrier_init(&barrier, NULL, ncontexts + 1);
+    pthread_mutex_lock(&start_mutex);
+    for (i = 0; i < ncontexts; i++) {
+        ret = pthread_create(&tids[i], NULL, loadgen_context_fn, &contexts[i]);
+        if (ret != 0) {
+            fprintf(stderr, "Error: pthread_create() failure: %s\n",
+                    strerror(ret));
+            start_abort = 1;
+            break;
+        }
+        nstarted++;
+    }
+    pthread_mutex_unlock(&start_mutex);
+    if (start_abort) {
+        for (i = 0; i < nstarted; i++) pthread_join(tids[i], NULL);
+        pthread_barrier_destroy(&barrier);
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+
+    /* wait for all contexts to finish warming up */
+    pthread_barrier_wait(&barrier);
+
+    ret = bench_local_stat(&cli_utime1, &cli_stime1, &cli_alltime1);
+    cli_joules1 = qtn_rapl_read(&rapl);
+    if (ret == 0)
+        ret = quintain_stat(contexts[0].qph, &svr_utime1, &svr_stime1,
+                            &svr_alltime1);
+    if (ret == 0) ret = quintain_stat_energy(contexts[0].qph, &svr_joules1);
+
+    /* start measurements, with the time series of every context counting
+     * from the same instant
+     */
+    origin = ABT_get_wtime();
+    for (i = 0; i < ncontexts; i++) contexts[i].bc.ts_origin = origin;
+    pthread_barrier_wait(&barrier);
+
+    for (i = 0; i < nstarted; i++) pthread_join(tids[i], NULL);
+    pthread_barrier_destroy(&barrier);
+    nstarted = 0;
+    if (ret != QTN_SUCCESS) {
+        fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
+        goto err_qtn_cleanup;
+    }
+    for (i = 0; i < ncontexts; i++) {
+        if (contexts[i].ret != 0) {
+            ret = contexts[i].ret;
+            goto err_qtn_cleanup;
+        }
+    }
+
+    ret = bench_local_stat(&cli_utime2, &cli_stime2, &cli_alltime2);
+    if (ret != 0) goto err_qtn_cleanup;
+    cli_joules2 = qtn_rapl_read(&rapl);
+    cli_utime   = cli_utime2 - cli_utime1;
+    cli_stime   = cli_stime2 - cli_stime1;
+    cli_alltime = cli_alltime2 - cli_alltime1;
+
+    ret = quintain_stat(contexts[0].qph, &svr_utime2, &svr_stime2,
+                        &svr_alltime2);
+    if (ret == QTN_SUCCESS)
+        ret = quintain_stat_energy(contexts[0].qph, &svr_joules2);
+    if (ret != QTN_SUCCESS) {
+        fprintf(stderr, "Error: quintain_stat() failure: (%d)\n", ret);
+        goto err_qtn_cleanup;
+    }
+    svr_utime   = svr_utime2 - svr_utime1;
+    svr_stime   = svr_stime2 - svr_stime1;
+    svr_alltime = svr_alltime2 - svr_alltime1;
+
+    /* uncompressed payload bytes handled by the first server */
+    for (i = 0; i < ncontexts; i++)
+        if (contexts[i].svr_idx == 0) svr_raw_bytes += contexts[i].bc.raw_bytes;
+
+    /* store results */
+    f = gzopen(opts.output_file, "w");
+    if (!f) {
+        fprintf(stderr, "Error opening %s\n", opts.output_file);
+        ret = -1;
+        goto err_qtn_cleanup;
+    }
+
+    /* report configuration */
+    {
+        struct json_tokener*    tokener;
+        enum json_tokener_error jerr;
+
+        /* retrieve configuration from provider */
+        if (opts.loopback[0])
+            svr_cfg_str_raw = loopback_query_config(&lb);
+        else
+            svr_cfg_str_raw
+                = bedrock_service_query_config(bsh, "return $__config__;");
+        if (!svr_cfg_str_raw) {
+            fprintf(stderr, "Error: could not query provider configuration.\n");
+            ret = -1;
+            goto err_qtn_cleanup;
+        }
+
+        /* the string emitted by bedrock_service_query_config() is not
+         * formatted for human readability.  Parse it in json-c and emit it
+         * again with pretty options for better legibility.
+         */
+        tokener    = json_tokener_new();
+        svr_config = json_tokener_parse_ex(tokener, svr_cfg_str_raw,
+                                           strlen(svr_cfg_str_raw));
+        if (!svr_config) {
+            jerr = json_tokener_get_error(tokener);
+            fprintf(stderr, "JSON parse error: %s",
+                    json_tokener_error_desc(jerr));
+            json_tokener_free(tokener);
+            ret = -1;
+            goto err_qtn_cleanup;
+        }
+        json_tokener_free(tokener);
+
+        /* retrieve local margo configuration */
+        cli_cfg_str = margo_get_config(mid);
+
+        /* parse margo config and injected into the benchmark config */
+        tokener = json_tokener_new();
+        margo_config
+            = json_tokener_parse_ex(tokener, cli_cfg_str, strlen(cli_cfg_str));
+        if (!margo_config) {
+            jerr = json_tokener_get_error(tokener);
+            fprintf(stderr, "JSON parse error: %s",
+                    json_tokener_error_desc(jerr));
+            json_tokener_free(tokener);
+            ret = -1;
+            goto err_qtn_cleanup;
+        }
+        json_tokener_free(tokener);
+        /* delete existing margo object, if present */
+        json_object_object_del(json_cfg, "margo");
+        /* add new one, derived at run time */
+        json_object_object_add(json_cfg, "margo", margo_config);
+
+        gzprintf(f, "\"quintain-provider (first of %d)\" : %s\n", nproviders,
+                 json_object_to_json_string_ext(
+                     svr_config,
+                     JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_NOSLASHESCAPE));
+        gzprintf(f, "\"quintain-benchmark\" : %s\n",
+                 json_object_to_json_string_ext(
+                     json_cfg,
+                     JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_NOSLASHESCAPE));
+        bench_write_server_perf(svr_config, f);
+    }
+
+    /* report each context in the same way that quintain-benchmark reports
+     * each rank.  CPU time is only available for the whole process, so it
+     * is reported once and split evenly between contexts for per-operation
+     * costs.
+     */
+    for (i = 0; i < ncontexts; i++) {
+        struct loadgen_context* ctx = &contexts[i];
+
+        if (ctx->wl.trace_flag) bench_client_write_trace(&ctx->bc, f, i);
+        bench_client_stats(&ctx->bc, &stats);
+
+        gzprintf(f,
+                 "# client_mapping\t<rank>\t<svr_idx>\t<svr_addr_string>\t"
+                 "<provider_id>\n");
+        gzprintf(f, "client_mapping\t%d\t%d\t%s\t%d\n", i, ctx->svr_idx,
+                 ctx->svr_addr_str, ctx->provider_id);
+        gzprintf(f,
+                 "# "
+                 "sample_stats\t<rank>\t<min>\t<q1>\t<median>\t<q3>\t<max>\t<"
+                 "mean>\t<ops/s>\n");
+        gzprintf(f,
+                 "sample_stats\t%d\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.9f\t%.3f\n",
+                 i, stats.min, stats.q1, stats.median, stats.q3, stats.max,
+                 stats.mean, stats.ops_per_sec);
+        if (i == 0) {
+            gzprintf(
+                f,
+                "# server_stats\t<server_rank>\t<utime>\t<stime>\t<alltime>\n");
+            gzprintf(f, "server_stats\t%d\t%.9f\t%.9f\t%.9f\n", 0, svr_utime,
+                     svr_stime, svr_alltime);
+            gzprintf(f,
+                     "# client_stats\t<rank>\t<utime>\t<stime>\t<alltime>\n");
+            gzprintf(f, "client_stats\t%d\t%.9f\t%.9f\t%.9f\n", i, cli_utime,
+                     cli_stime, cli_alltime);
+        }
+        bench_client_write_stats(&ctx->bc, &stats,
+                                 (cli_utime + cli_stime) / ncontexts, f, i);
+        if (i == 0
+            && (ctx->wl.work_flags
+                & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS))) {
+            gzprintf(f,
+                     "# compression_server_stats\t<server_rank>\t<raw_bytes>"
+                     "\t<server_cpu_ns/byte>\n");
+            gzprintf(f, "compression_server_stats\t%d\t%.0f\t%.6f\n", 0,
+                     svr_raw_bytes,
+                     svr_raw_bytes
+                         ? (svr_utime + svr_stime) * 1e9 / svr_raw_bytes
+                         : 0.0);
+        }
+    }
+
+    /* energy over the measurement window */
+    if (cli_joules1 >= 0 || svr_joules1 >= 0) {
+        for (i = 0; i < ncontexts; i++)
+            total_ops += (double)(contexts[i].bc.sample_index
+                                  - contexts[i].bc.busy_rejections)
+                       * contexts[i].wl.batch_size;
+        bench_write_energy(f, cli_joules1 >= 0 ? cli_joules2 - cli_joules1 : -1,
+                           svr_joules1 >= 0 ? svr_joules2 - svr_joules1 : -1,
+                           total_ops, contexts[0].bc.elapsed);
+    }
+
+    /* one timeline for the whole process */
+    if (contexts[0].bc.bins) {
+        for (i = 1; i < ncontexts; i++)
+            bench_timeseries_merge(contexts[0].bc.bins, contexts[i].bc.bins,
+                                   contexts[0].bc.nbins);
+        bench_timeseries_write(contexts[0].bc.bins, contexts[0].bc.nbins,
+                               contexts[0].wl.ts_bin_seconds, f);
+    }
+    ret = 0;
+
+err_qtn_cleanup:
+    if (contexts) {
+        for (i = 0; i < ncontexts; i++) {
+            bench_client_destroy(&contexts[i].bc);
+            if (contexts[i].qph != QTN_PROVIDER_HANDLE_NULL)
+                quintain_provider_handle_release(contexts[i].qph);
+            if (contexts[i].addr != HG_ADDR_NULL)
+                margo_addr_free(mid, contexts[i].addr);
+            if (contexts[i].hedge_qph != QTN_PROVIDER_HANDLE_NULL)
+                quintain_provider_handle_release(contexts[i].hedge_qph);
+            if (contexts[i].hedge_addr != HG_ADDR_NULL)
+                margo_addr_free(mid, contexts[i].hedge_addr);
+        }
+        free(contexts);
+    }
+    free(tids);
+    qtn_rapl_finalize(&rapl);
+    if (svr_cfg_str_raw) free(svr_cfg_str_raw);
+    if (cli_cfg_str) free(cli_cfg_str);
+    if (f) gzclose(f);
+    if (samples) munmap(samples, MAX_SAMPLES * sizeof(double));
+    if (qcl != QTN_CLIENT_NULL) quintain_client_finalize(qcl);
+    free(targets);
+err_br_cleanup:
+    if (bsh != NULL) bedrock_service_handle_destroy(bsh);
+    if (bcl != NULL) bedrock_client_finalize(bcl);
+err_flock_cleanup:
+    flock_group_view_clear(&group_view);
+    if (fh != FLOCK_GROUP_HANDLE_NULL) flock_group_handle_release(fh);
+    if (fcl != FLOCK_CLIENT_NULL) flock_client_finalize(fcl);
+err_margo_cleanup:
+    if (svr_addr != HG_ADDR_NULL) margo_addr_free(mid, svr_addr);
+    loopback_stop(&lb);
+    if (mid != MARGO_INSTANCE_NULL) margo_finalize(mid);
+err_json_cleanup:
+    if (json_cfg) json_object_put(json_cfg);
+    if (svr_config) json_object_put(svr_config);
+    if (cli_margo) json_object_put(cli_margo);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* body of each context thread: warm up, then wait for the main thread to
+ * sample starting statistics, then run the measurement loop
+ */
+static void* loadgen_context_fn(void* arg)
+{
+    struct loadgen_context* ctx = arg;
+    int                     abort_start;
+
+    pthread_mutex_lock(ctx->start_mutex);
+    abort_start = *ctx->start_abort;
+    pthread_mutex_unlock(ctx->start_mutex);
+    if (abort_start) return NULL;
+
+    ctx->ret = bench_client_warmup(&ctx->bc);
+    pthread_barrier_wait(ctx->barrier);
+    pthread_barrier_wait(ctx->barrier);
+    if (ctx->ret == 0) ctx->ret = bench_client_run(&ctx->bc);
+
+    return NULL;
+}
+
+/* Returns the margo configuration for an instance in this process: a copy
+ * of the "margo" section of the benchmark configuration, if any, with a
+ * progress thread.  The client contexts block in pthreads rather than in
+ * Argobots, so they cannot drive progress on the primary xstream.  A
+ * provider (server) also gets a handler xstream unless the configuration
+ * already arranges for one.  The caller releases the returned object.
+ */
+static struct json_object* loadgen_margo_config(struct json_object* json_cfg,
+                                                int                 server)
+{
+    struct json_object* config = NULL;
+    struct json_object* val;
+
+    val = json_object_object_get(json_cfg, "margo");
+    if (val)
+        json_object_deep_copy(val, &config, NULL);
+    else
+        config = json_object_new_object();
+    json_object_object_add(config, "use_progress_thread",
+                           json_object_new_boolean(1));
+    if (server && !json_object_object_get(config, "rpc_thread_count"))
+        json_object_object_add(config, "rpc_thread_count",
+                               json_object_new_int(1));
+    return config;
+}
+
+/* Starts margo and a quintain provider in this process, and describes the
+ * provider as a one member group.  The provider is registered with the
+ * benchmark's "server_config" settings, so registration-time options such
+ * as "fast_path" apply too.
+ */
+static int loopback_start(const char*         mode,
+                          struct json_object* json_cfg,
+                          margo_instance_id*  mid,
+                          struct loopback*    lb,
+                          flock_group_view_t* view)
+{
+    struct quintain_provider_init_info qii
+        = QTN_PROVIDER_INIT_INFO_INITIALIZER;
+    struct margo_init_info mii          = {0};
+    struct margo_init_info svr_mii      = {0};
+    struct json_object*    margo_config = NULL;
+    struct json_object*    svr_config   = NULL;
+    struct json_object*    val;
+    int                    self         = !strcmp(mode, "self");
+    hg_addr_t              addr         = HG_ADDR_NULL;
+    char                   addr_str[256];
+    hg_size_t              addr_str_size = sizeof(addr_str);
+    int                    ret           = -1;
+
+    /* in "self" mode the provider's settings apply to the client's instance
+     * as well
+     */
+    svr_config = loadgen_margo_config(json_cfg, 1);
+    svr_mii.json_config
+        = json_object_to_json_string_ext(svr_config, JSON_C_TO_STRING_PLAIN);
+
+    if (self) {
+        *mid = margo_init_ext("na+sm", MARGO_SERVER_MODE, &svr_mii);
+    } else {
+        margo_config    = loadgen_margo_config(json_cfg, 0);
+        mii.json_config = json_object_to_json_string_ext(
+            margo_config, JSON_C_TO_STRING_PLAIN);
+        *mid            = margo_init_ext(mode, MARGO_CLIENT_MODE, &mii);
+        if (*mid)
+            lb->svr_mid = margo_init_ext(mode, MARGO_SERVER_MODE, &svr_mii);
+    }
+    if (!*mid || (!self && !lb->svr_mid)) {
+        fprintf(stderr, "Error: failed to initialize margo with %s protocol.\n",
+                self ? "na+sm" : mode);
+        goto finish;
+    }
+    lb->provider_id
+        = json_object_get_int(json_object_object_get(json_cfg, "provider_id"));
+    val = json_object_object_get(json_cfg, "server_config");
+    if (val)
+        qii.json_config
+            = json_object_to_json_string_ext(val, JSON_C_TO_STRING_PLAIN);
+    ret = quintain_provider_register(self ? *mid : lb->svr_mid,
+                                     lb->provider_id, &qii, &lb->provider);
+    if (ret != QTN_SUCCESS) {
+        fprintf(stderr, "Error: quintain_provider_register() failure: %d\n",
+                ret);
+        lb->provider = NULL;
+        goto finish;
+    }
+
+    ret = margo_addr_self(self ? *mid : lb->svr_mid, &addr);
+    if (ret == HG_SUCCESS)
+        ret = margo_addr_to_string(self ? *mid : lb->svr_mid, addr_str,
+                                   &addr_str_size, addr);
+    if (ret != HG_SUCCESS) {
+        fprintf(stderr, "Error: could not determine provider address.\n");
+        goto finish;
+    }
+    if (!flock_group_view_add_member(view, 0, lb->provider_id, addr_str)) {
+        ret = -1;
+        goto finish;
+    }
+    ret = 0;
+
+finish:
+    if (addr != HG_ADDR_NULL) margo_addr_free(self ? *mid : lb->svr_mid, addr);
+    json_object_put(svr_config);
+    if (margo_config) json_object_put(margo_config);
+    return ret;
+}
+
+/* returns the configuration of a loopback provider in the same form that
+ * bedrock reports it, or NULL on failure
+ */
+static char* loopback_query_config(struct loopback* lb)
+{
+    struct json_object* cfg;
+    struct json_object* provider;
+    struct json_object* providers;
+    char*               cfg_str;
+    char*               ret;
+
+    cfg_str = quintain_provider_get_config(lb->provider);
+    if (!cfg_str) return NULL;
+    provider = json_object_new_object();
+    json_object_object_add(provider, "name",
+                           json_object_new_string("loopback"));
+    json_object_object_add(provider, "type",
+                           json_object_new_string("quintain"));
+    json_object_object_add(provider, "provider_id",
+                           json_object_new_int(lb->provider_id));
+    json_object_object_add(provider, "config", json_tokener_parse(cfg_str));
+    providers = json_object_new_array();
+    json_object_array_add(providers, provider);
+    cfg = json_object_new_object();
+    json_object_object_add(cfg, "providers", providers);
+
+    ret = strdup(json_object_to_json_string_ext(cfg, JSON_C_TO_STRING_PLAIN));
+    json_object_put(cfg);
+    free(cfg_str);
+    return ret;
+}
+
+/* tears down a loopback provider and its margo instance, if any */
+static void loopback_stop(struct loopback* lb)
+{
+    if (lb->provider) quintain_provider_deregister(lb->provider);
+    lb->provider = NULL;
+    if (lb->svr_mid != MARGO_INSTANCE_NULL) margo_finalize(lb->svr_mid);
+    lb->svr_mid = MARGO_INSTANCE_NULL;
+}
+
+static int parse_args(int                  argc,
+                      char**               argv,
+                      struct options*      opts,
+                      struct json_object** json_cfg)
+{
+    int opt;
+    int ret;
+
+    memset(opts, 0, sizeof(*opts));
+    opts->ncontexts = 1;
+
+    while ((opt = getopt(argc, argv, "g:j:o:c:l:")) != -1) {
+        switch (opt) {
+        case 'g':
+            ret = sscanf(optarg, "%s", opts->group_file);
+            if (ret != 1) return (-1);
+            break;
+        case 'j':
+            ret = sscanf(optarg, "%s", opts->json_file);
+            if (ret != 1) return (-1);
+            break;
+        case 'o':
+            ret = sscanf(optarg, "%s", opts->output_file);
+            if (ret != 1) return (-1);
+            break;
+        case 'c':
+            ret = sscanf(optarg, "%d", &opts->ncontexts);
+            if (ret != 1 || opts->ncontexts < 1) return (-1);
+            break;
+        case 'l':
+            ret = sscanf(optarg, "%63s", opts->loopback);
+            if (ret != 1) return (-1);
+            break;
+        default:
+            return (-1);
+        }
+    }
+
+    if (strlen(opts->group_file) == 0 && strlen(opts->loopback) == 0)
+        return (-1);
+    if (strlen(opts->json_file) == 0) return (-1);
+    if (strlen(opts->output_file) == 0) return (-1);
+
+    /* add .gz on to the output file name if it isn't already there */
+    if ((strlen(opts->output_file) < 3)
+        || (strcmp(".gz", &opts->output_file[strlen(opts->output_file) - 3])
+            != 0)) {
+        strcat(opts->output_file, ".gz");
+    }
+
+    /* each context is reported as a rank */
+    return (bench_parse_json(opts->json_file, opts->ncontexts, json_cfg));
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: "
+            "quintain-loadgen {-g <group_file> | -l <self | protocol>} -j "
+            "<configuration json> -o <output file> [-c <number of client "
+            "contexts>]\n");
+    return;
+}
@@ -0,0 +1,121 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #include <nmmintrin.h>
+    #define QTN_HAVE_X86_CRC32C 1
+#endif
+
+#include "quintain-payload.h"
+
+void qtn_payload_fill(void* buf, size_t size, uint64_t seed, uint64_t offset)
+{
+    unsigned char* p = buf;
+    uint64_t       word;
+    size_t         n;
+
+    /* leading bytes until offset is word aligned */
+    while (size && (offset % 8)) {
+        word = qtn_mix64(seed ^ (offset / 8));
+        *p++ = (unsigned char)(word >> (8 * (offset % 8)));
+        offset++;
+        size--;
+    }
+
+    /* whole words */
+    for (; size >= 8; size -= 8, p += 8, offset += 8) {
+        word = qtn_mix64(seed ^ (offset / 8));
+        memcpy(p, &word, 8);
+    }
+
+    /* trailing bytes */
+    if (size) {
+        word = qtn_mix64(seed ^ (offset / 8));
+        for (n = 0; n < size; n++) p[n] = (unsigned char)(word >> (8 * n));
+    }
+}
+
+void qtn_payload_fill_compressible(void*    buf,
+                                   size_t   size,
+                                   uint64_t seed,
+                                   double   ratio)
+{
+    unsigned char* p = buf;
+    size_t         block;
+    size_t         random_len;
+    uint64_t       offset = 0;
+
+    if (ratio < 1.0) ratio = 1.0;
+    random_len = (size_t)(QTN_PAYLOAD_BLOCK_SIZE / ratio);
+
+    for (; size > 0; size -= block, p += block, offset += block) {
+        block = size < QTN_PAYLOAD_BLOCK_SIZE ? size : QTN_PAYLOAD_BLOCK_SIZE;
+        if (random_len >= block) {
+            qtn_payload_fill(p, block, seed, offset);
+        } else {
+            qtn_payload_fill(p, random_len, seed, offset);
+            memset(p + random_len, 0, block - random_len);
+        }
+    }
+}
+
+/* table for the portable byte-at-a-time implementation */
+static uint32_t       crc32c_table[256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init_table(void)
+{
+    uint32_t i, j, crc;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1));
+        crc32c_table[i] = crc;
+    }
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t size)
+{
+    pthread_once(&crc32c_table_once, crc32c_init_table);
+
+    while (size--) crc = (crc >> 8) ^ crc32c_table[(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#ifdef QTN_HAVE_X86_CRC32C
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_hw(uint32_t crc, const unsigned char* p, size_t size)
+{
+    uint64_t crc64 = crc;
+    uint64_t word;
+
+    while (size && ((uintptr_t)p & 7)) {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+        size--;
+    }
+    for (; size >= 8; size -= 8, p += 8) {
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    while (size--) crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+
+    return (uint32_t)crc64;
+}
+#endif
+
+uint32_t qtn_crc32c(uint32_t crc, const void* buf, size_t size)
+{
+#ifdef QTN_HAVE_X86_CRC32C
+    static int have_sse42 = -1;
+
+    if (have_sse42 < 0) have_sse42 = __builtin_cpu_supports("sse4.2");
+    if (have_sse42) return ~crc32c_hw(~crc, buf, size);
+#endif
+    return ~crc32c_sw(~crc, buf, size);
+}
@@ -0,0 +1,60 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __QUINTAIN_PAYLOAD
+#define __QUINTAIN_PAYLOAD
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Helpers for generating and checking synthetic payload contents.  These are
+ * shared by the client and provider so that both sides agree on how data is
+ * produced and verified.
+ */
+
+/* splitmix64 finalizer; cheap and good enough to defeat any accidental
+ * pattern matching or compression in the transport
+ */
+static inline uint64_t qtn_mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/* distinguishes the pattern used for each payload in a single operation */
+#define QTN_PAYLOAD_SALT_REQ  0x72657175ULL
+#define QTN_PAYLOAD_SALT_RESP 0x72657370ULL
+#define QTN_PAYLOAD_SALT_BULK 0x62756c6bULL
+
+/* Fills buf with a deterministic pseudo-random pattern derived from seed.
+ * The pattern is position dependent: offset is the position of buf[0]
+ * within the logical payload, so that a payload can be generated in
+ * arbitrary pieces (e.g., chunks or segments) with identical results.
+ */
+void qtn_payload_fill(void* buf, size_t size, uint64_t seed, uint64_t offset);
+
+/* granularity at which qtn_payload_fill_compressible() mixes data */
+#define QTN_PAYLOAD_BLOCK_SIZE 4096
+
+/* Fills buf with data that compresses by roughly the given ratio: each
+ * QTN_PAYLOAD_BLOCK_SIZE block starts with 1/ratio of pseudo-random bytes
+ * and is padded with zeros.  A ratio of 1.0 or less produces incompressible
+ * data.
+ */
+void qtn_payload_fill_compressible(void*    buf,
+                                   size_t   size,
+                                   uint64_t seed,
+                                   double   ratio);
+
+/* Computes or extends a CRC32C (Castagnoli) checksum.  Pass 0 as crc to
+ * start a new checksum or the previous return value to continue one.  Uses
+ * the hardware CRC32C instruction when the CPU supports it.
+ */
+uint32_t qtn_crc32c(uint32_t crc, const void* buf, size_t size);
+
+#endif /* __QUINTAIN_PAYLOAD */
@@ -0,0 +1,291 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "quintain-perf.h"
+
+static const char* const qtn_perf_names[QTN_PERF_COUNT]
+    = {"cycles", "instructions", "llc_misses", "context_switches",
+       "task_clock_ns"};
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} qtn_perf_events[QTN_PERF_COUNT]
+    = {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+       {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+       {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+       {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+       {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}};
+
+/* opens a counter for the calling thread on any CPU */
+static int qtn_perf_open(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.exclude_kernel = (type == PERF_TYPE_HARDWARE);
+    attr.exclude_hv     = 1;
+    attr.read_format
+        = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void qtn_perf_xstream_open(struct qtn_perf_xstream* xs,
+                                  int                      counters,
+                                  const char*              role)
+{
+    int i;
+
+    for (i = 0; i < QTN_PERF_COUNT; i++)
+        xs->fds[i] = counters ? qtn_perf_open(qtn_perf_events[i].type,
+                                              qtn_perf_events[i].config)
+                              : -1;
+    xs->has_cpu_clock
+        = pthread_getcpuclockid(pthread_self(), &xs->cpu_clock) == 0;
+    xs->use_cpu_clock = counters && xs->has_cpu_clock
+                     && xs->fds[QTN_PERF_TASK_CLOCK] < 0;
+    xs->role    = role;
+    xs->open_ts = ABT_get_wtime();
+    xs->opened  = 1;
+}
+
+/* reads the CPU time of an xstream in seconds */
+static double qtn_perf_xstream_cpu(const struct qtn_perf_xstream* xs)
+{
+    struct timespec ts;
+
+    if (!xs->has_cpu_clock || clock_gettime(xs->cpu_clock, &ts) != 0)
+        return -1;
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* returns the tracking state of the calling xstream, or NULL */
+static struct qtn_perf_xstream* qtn_perf_self(struct qtn_perf* perf)
+{
+    int rank;
+
+    if (!perf->xstreams) return NULL;
+    if (ABT_self_get_xstream_rank(&rank) != ABT_SUCCESS || rank < 0
+        || rank >= QTN_PERF_MAX_XSTREAMS)
+        return NULL;
+    return &perf->xstreams[rank];
+}
+
+/* Reads a counter, scaled up to the time it was enabled if the kernel had
+ * to multiplex it with other events.  Returns 0 if it never ran.
+ */
+static uint64_t qtn_perf_read_scaled(int fd)
+{
+    uint64_t data[3]; /* value, time enabled, time running */
+
+    if (read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0)
+        return 0;
+    if (data[2] >= data[1]) return data[0];
+    return (uint64_t)((double)data[0] * data[1] / data[2]);
+}
+
+/* reads every counter of an xstream; may be called from any thread since
+ * perf event fds and CPU clock ids refer to the thread that opened them
+ */
+static void qtn_perf_xstream_read(const struct qtn_perf_xstream* xs,
+                                  uint64_t*                      values)
+{
+    struct timespec ts;
+    int             i;
+
+    for (i = 0; i < QTN_PERF_COUNT; i++)
+        values[i] = xs->fds[i] >= 0 ? qtn_perf_read_scaled(xs->fds[i]) : 0;
+    if (xs->use_cpu_clock && clock_gettime(xs->cpu_clock, &ts) == 0)
+        values[QTN_PERF_TASK_CLOCK]
+            = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int qtn_perf_init(struct qtn_perf* perf, int counters)
+{
+    int i;
+
+    perf->counters = counters;
+    perf->xstreams = calloc(QTN_PERF_MAX_XSTREAMS, sizeof(*perf->xstreams));
+    if (!perf->xstreams) return -1;
+    for (i = 0; i < QTN_PERF_MAX_XSTREAMS; i++) {
+        if (ABT_mutex_create(&perf->xstreams[i].mutex) != ABT_SUCCESS) {
+            perf->xstreams[i].mutex = ABT_MUTEX_NULL;
+            qtn_perf_finalize(perf);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void qtn_perf_finalize(struct qtn_perf* perf)
+{
+    int i, j;
+
+    if (!perf->xstreams) return;
+    for (i = 0; i < QTN_PERF_MAX_XSTREAMS; i++) {
+        struct qtn_perf_xstream* xs = &perf->xstreams[i];
+
+        if (xs->opened)
+            for (j = 0; j < QTN_PERF_COUNT; j++)
+                if (xs->fds[j] >= 0) close(xs->fds[j]);
+        if (xs->mutex != ABT_MUTEX_NULL) ABT_mutex_free(&xs->mutex);
+    }
+    free(perf->xstreams);
+    perf->xstreams = NULL;
+}
+
+/* opens the calling xstream under a role, or marks it as "mixed" if it was
+ * already seen in a different one; the caller holds the mutex
+ */
+static void qtn_perf_xstream_role(struct qtn_perf_xstream* xs,
+                                  int                      counters,
+                                  const char*              role)
+{
+    if (!xs->opened)
+        qtn_perf_xstream_open(xs, counters, role);
+    else if (strcmp(xs->role, role) != 0)
+        xs->role = "mixed";
+}
+
+void qtn_perf_register(struct qtn_perf* perf, const char* role)
+{
+    struct qtn_perf_xstream* xs = qtn_perf_self(perf);
+
+    if (!xs) return;
+    ABT_mutex_lock(xs->mutex);
+    qtn_perf_xstream_role(xs, perf->counters, role);
+    ABT_mutex_unlock(xs->mutex);
+}
+
+void qtn_perf_begin(struct qtn_perf* perf, struct qtn_perf_section* section)
+{
+    struct qtn_perf_xstream* xs = qtn_perf_self(perf);
+
+    section->xstream = -1;
+    if (!xs) return;
+
+    ABT_mutex_lock(xs->mutex);
+    /* counters must be opened by the thread they will measure */
+    qtn_perf_xstream_role(xs, perf->counters, "handler");
+    ABT_mutex_unlock(xs->mutex);
+
+    section->xstream = (int)(xs - perf->xstreams);
+    qtn_perf_xstream_read(xs, section->start);
+    section->start_ts = ABT_get_wtime();
+}
+
+void qtn_perf_end(struct qtn_perf* perf, struct qtn_perf_section* section)
+{
+    struct qtn_perf_xstream* xs = qtn_perf_self(perf);
+    uint64_t                 values[QTN_PERF_COUNT];
+    double                   end_ts;
+    int                      i;
+
+    if (section->xstream < 0) return;
+    /* the counters of another xstream would not cover this section */
+    if (!xs || xs - perf->xstreams != section->xstream) return;
+
+    qtn_perf_xstream_read(xs, values);
+    end_ts = ABT_get_wtime();
+
+    ABT_mutex_lock(xs->mutex);
+    /* scaled counters are estimates and may not be monotonic */
+    for (i = 0; i < QTN_PERF_COUNT; i++)
+        if (values[i] > section->start[i])
+            xs->work[i] += values[i] - section->start[i];
+    xs->work_seconds += end_ts - section->start_ts;
+    ABT_mutex_unlock(xs->mutex);
+}
+
+struct json_object* qtn_perf_to_json(struct qtn_perf* perf)
+{
+    struct json_object* all;
+    struct json_object* obj;
+    struct json_object* total;
+    struct json_object* work;
+    uint64_t            values[QTN_PERF_COUNT];
+    uint64_t            in_work[QTN_PERF_COUNT];
+    char                key[16];
+    double              work_seconds, wall_seconds, cpu_seconds;
+    const char*         counters;
+    int                 available;
+    int                 i, j;
+
+    if (!perf->xstreams) return NULL;
+
+    all = json_object_new_object();
+    for (i = 0; i < QTN_PERF_MAX_XSTREAMS; i++) {
+        struct qtn_perf_xstream* xs = &perf->xstreams[i];
+
+        ABT_mutex_lock(xs->mutex);
+        if (!xs->opened) {
+            ABT_mutex_unlock(xs->mutex);
+            continue;
+        }
+        qtn_perf_xstream_read(xs, values);
+        memcpy(in_work, xs->work, sizeof(in_work));
+        work_seconds = xs->work_seconds;
+        wall_seconds = ABT_get_wtime() - xs->open_ts;
+        cpu_seconds  = qtn_perf_xstream_cpu(xs);
+        if (xs->fds[QTN_PERF_CYCLES] >= 0)
+            counters = "hardware";
+        else if (xs->fds[QTN_PERF_TASK_CLOCK] >= 0)
+            counters = "software";
+        else if (xs->use_cpu_clock)
+            counters = "clock";
+        else
+            counters = "none";
+        ABT_mutex_unlock(xs->mutex);
+
+        obj = json_object_new_object();
+        json_object_object_add(obj, "role", json_object_new_string(xs->role));
+        json_object_object_add(obj, "counters",
+                               json_object_new_string(counters));
+        json_object_object_add(obj, "wall_seconds",
+                               json_object_new_double(wall_seconds));
+        json_object_object_add(obj, "busy_seconds",
+                               json_object_new_double(work_seconds));
+        json_object_object_add(
+            obj, "idle_seconds",
+            json_object_new_double(wall_seconds - work_seconds));
+        json_object_object_add(obj, "cpu_seconds",
+                               json_object_new_double(cpu_seconds));
+
+        snprintf(key, sizeof(key), "%d", i);
+        json_object_object_add(all, key, obj);
+        if (!perf->counters) continue;
+
+        /* unavailable counters are left out rather than reported as 0 */
+        total = json_object_new_object();
+        work  = json_object_new_object();
+        for (j = 0; j < QTN_PERF_COUNT; j++) {
+            available = xs->fds[j] >= 0
+                     || (j == QTN_PERF_TASK_CLOCK && xs->use_cpu_clock);
+            if (!available) continue;
+            json_object_object_add(total, qtn_perf_names[j],
+                                   json_object_new_int64(values[j]));
+            json_object_object_add(work, qtn_perf_names[j],
+                                   json_object_new_int64(in_work[j]));
+        }
+        json_object_object_add(obj, "total", total);
+        json_object_object_add(obj, "work", work);
+    }
+
+    return all;
+}
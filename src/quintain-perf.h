@@ -0,0 +1,93 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __QUINTAIN_PERF
+#define __QUINTAIN_PERF
+
+#include <stdint.h>
+#include <time.h>
+#include <abt.h>
+#include <json-c/json.h>
+
+/* Per execution stream accounting for the provider.  Each xstream is
+ * tracked from the first time it runs a compute section of a work handler
+ * (or registers itself, as the progress xstream does).  CPU time comes from
+ * the thread CPU clock and wall time is split into busy time, spent in
+ * compute sections (payload generation, checksums, and compression), and
+ * idle time (progress, bulk transfers, other RPCs, and waiting).  Compute
+ * sections never yield, so each one is charged to exactly the ULT that ran
+ * it rather than to whatever else ran on the xstream while a handler was
+ * blocked.
+ *
+ * Optionally, perf_event_open() counters are split the same way.  If the
+ * PMU is not accessible the hardware counters are reported as unavailable
+ * and the software counters are used alone; if perf events are not
+ * accessible at all, the task clock falls back to the thread CPU clock.
+ * Counters that the kernel multiplexed are scaled up by the fraction of
+ * time they were actually running.
+ */
+
+enum qtn_perf_counter {
+    QTN_PERF_CYCLES = 0,
+    QTN_PERF_INSTRUCTIONS,
+    QTN_PERF_LLC_MISSES,
+    QTN_PERF_CTX_SWITCHES,
+    QTN_PERF_TASK_CLOCK, /* CPU time in nanoseconds */
+    QTN_PERF_COUNT
+};
+
+/* xstreams beyond this rank are not tracked */
+#define QTN_PERF_MAX_XSTREAMS 256
+
+struct qtn_perf_xstream {
+    int         opened;
+    const char* role;                /* "handler", "progress" or "mixed" */
+    int         fds[QTN_PERF_COUNT]; /* -1 if unavailable */
+    clockid_t   cpu_clock;           /* thread CPU time */
+    int         has_cpu_clock;
+    int         use_cpu_clock; /* cpu_clock stands in for the task clock */
+    ABT_mutex   mutex;
+    uint64_t    work[QTN_PERF_COUNT]; /* accumulated in compute sections */
+    double      open_ts;              /* when tracking started */
+    double      work_seconds;         /* wall time in compute sections */
+};
+
+/* one compute section, owned by the ULT that runs it */
+struct qtn_perf_section {
+    int      xstream; /* rank it began on, or -1 if not tracked */
+    uint64_t start[QTN_PERF_COUNT];
+    double   start_ts;
+};
+
+struct qtn_perf {
+    struct qtn_perf_xstream* xstreams; /* NULL if disabled */
+    int                      counters; /* open perf event counters */
+};
+
+/* counters selects whether perf event counters are collected in addition
+ * to CPU and busy time
+ */
+int  qtn_perf_init(struct qtn_perf* perf, int counters);
+void qtn_perf_finalize(struct qtn_perf* perf);
+
+/* starts tracking the calling xstream under the given role; an xstream
+ * that also runs work handlers is reported as "mixed"
+ */
+void qtn_perf_register(struct qtn_perf* perf, const char* role);
+
+/* Brackets a compute section, which must not block or yield between the
+ * two calls.  A section that nonetheless ends on a different xstream than
+ * it began on is discarded.
+ */
+void qtn_perf_begin(struct qtn_perf* perf, struct qtn_perf_section* section);
+void qtn_perf_end(struct qtn_perf* perf, struct qtn_perf_section* section);
+
+/* returns an object with the counters of every xstream that has run a
+ * compute section, keyed by xstream rank, or NULL if disabled
+ */
+struct json_object* qtn_perf_to_json(struct qtn_perf* perf);
+
+#endif /* __QUINTAIN_PERF */
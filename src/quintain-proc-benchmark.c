@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2021 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "mochi-quintain-config.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <abt.h>
+#include <margo.h>
+
+#include "quintain-rpc.h"
+
+/* Serialization microbenchmark.  This runs the quintain RPC encoders and
+ * decoders from quintain-rpc.h through Mercury's hg_proc interface in a
+ * tight loop, with no network traffic, so that changes to the copy paths
+ * can be measured directly.  Margo is only initialized to obtain a Mercury
+ * class to create procs with.
+ *
+ * Each (type, operation, payload size) case is calibrated so that one
+ * repetition takes roughly the target time, warmed up for one repetition,
+ * and then measured for the requested number of repetitions.  Results are
+ * written to stdout in the same tab-separated format as the other
+ * benchmark output.
+ */
+
+struct options {
+    unsigned long max_payload;
+    int           factor;
+    int           repetitions;
+    double        target_seconds;
+};
+
+/* one encoder to measure */
+struct proc_type {
+    const char*  name;
+    hg_proc_cb_t proc_cb;
+    int          has_payload; /* request or response buffer varies */
+    /* fills in a structure to encode with the given payload */
+    void (*init)(void* data, char* payload, uint64_t size);
+};
+
+/* any of the structures being measured */
+union proc_data {
+    qtn_work_in_t  work_in;
+    qtn_work_out_t work_out;
+    qtn_stat_out_t stat_out;
+};
+
+/* state for one measured case */
+struct proc_case {
+    const struct proc_type* type;
+    hg_proc_op_t            op;
+    hg_proc_t               proc;
+    void*                   buf;      /* encoded form */
+    hg_size_t               buf_size; /* capacity of buf */
+    hg_size_t               encoded;  /* bytes used by the encoded form */
+    union proc_data         data;     /* the structure being encoded */
+};
+
+static int  parse_args(int argc, char** argv, struct options* opts);
+static void usage(void);
+
+static void work_in_init(void* data, char* payload, uint64_t size)
+{
+    qtn_work_in_t* in = data;
+
+    memset(in, 0, sizeof(*in));
+    in->req_buffer_size  = size;
+    in->req_buffer       = payload;
+    in->resp_buffer_size = size;
+    in->payload_seed     = 0x5eed;
+    in->bulk_handle      = HG_BULK_NULL;
+}
+
+static void work_out_init(void* data, char* payload, uint64_t size)
+{
+    qtn_work_out_t* out = data;
+
+    memset(out, 0, sizeof(*out));
+    out->resp_buffer_size = size;
+    out->resp_buffer      = payload;
+}
+
+static void stat_out_init(void* data, char* payload, uint64_t size)
+{
+    qtn_stat_out_t* out = data;
+
+    (void)payload;
+    (void)size;
+    memset(out, 0, sizeof(*out));
+    out->utime_sec  = 12;
+    out->utime_usec = 345678;
+    out->stime_sec  = 9;
+    out->stime_usec = 876543;
+    out->energy_uj  = -1;
+}
+
+static const struct proc_type proc_types[]
+    = {{"qtn_work_in_t", hg_proc_qtn_work_in_t, 1, work_in_init},
+       {"qtn_work_out_t", hg_proc_qtn_work_out_t, 1, work_out_init},
+       {"qtn_stat_out_t", hg_proc_qtn_stat_out_t, 0, stat_out_init}};
+
+/* runs one iteration of a case: encode into the buffer, or decode from it
+ * and free the result the way margo_free_input() would
+ */
+static hg_return_t proc_case_iter(struct proc_case* pc)
+{
+    union proc_data decoded;
+    hg_return_t     hret;
+
+    if (pc->op == HG_ENCODE) {
+        hret = hg_proc_reset(pc->proc, pc->buf, pc->buf_size, HG_ENCODE);
+        if (hret == HG_SUCCESS) hret = pc->type->proc_cb(pc->proc, &pc->data);
+        if (hret == HG_SUCCESS) hret = hg_proc_flush(pc->proc);
+        return hret;
+    }
+
+    hret = hg_proc_reset(pc->proc, pc->buf, pc->encoded, HG_DECODE);
+    if (hret == HG_SUCCESS) hret = pc->type->proc_cb(pc->proc, &decoded);
+    if (hret == HG_SUCCESS) hret = hg_proc_flush(pc->proc);
+    if (hret != HG_SUCCESS) return hret;
+    hret = hg_proc_reset(pc->proc, pc->buf, pc->encoded, HG_FREE);
+    if (hret == HG_SUCCESS) hret = pc->type->proc_cb(pc->proc, &decoded);
+    return hret;
+}
+
+/* returns the time taken by n iterations, or a negative value on error */
+static double proc_case_run(struct proc_case* pc, long n)
+{
+    double start = ABT_get_wtime();
+    long   i;
+
+    for (i = 0; i < n; i++)
+        if (proc_case_iter(pc) != HG_SUCCESS) return -1;
+    return ABT_get_wtime() - start;
+}
+
+static int double_cmp(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+
+    return (da > db) - (da < db);
+}
+
+/* calibrates, warms up, and measures one case, then writes its proc_stats
+ * line
+ */
+static int proc_case_measure(struct proc_case*     pc,
+                             uint64_t              payload,
+                             const struct options* opts,
+                             double*               rep_ns)
+{
+    long   iterations = 1;
+    double elapsed;
+    int    i;
+
+    /* double the iteration count until a repetition is long enough to time
+     * reliably; this also brings caches and allocator state to steady state
+     */
+    for (;;) {
+        elapsed = proc_case_run(pc, iterations);
+        if (elapsed < 0) return -1;
+        if (elapsed >= opts->target_seconds / 8) break;
+        iterations *= 2;
+    }
+    iterations = (long)(iterations * (opts->target_seconds / elapsed)) + 1;
+    if (proc_case_run(pc, iterations) < 0) return -1;
+
+    for (i = 0; i < opts->repetitions; i++) {
+        elapsed = proc_case_run(pc, iterations);
+        if (elapsed < 0) return -1;
+        rep_ns[i] = elapsed * 1e9 / iterations;
+    }
+    qsort(rep_ns, opts->repetitions, sizeof(*rep_ns), double_cmp);
+
+    printf("proc_stats\t%s\t%s\t%lu\t%lu\t%ld\t%.3f\t%.3f\t%.3f\t%.3f\n",
+           pc->type->name, pc->op == HG_ENCODE ? "encode" : "decode",
+           (unsigned long)payload, (unsigned long)pc->encoded, iterations,
+           rep_ns[0], rep_ns[opts->repetitions / 2],
+           rep_ns[opts->repetitions - 1],
+           pc->encoded / rep_ns[opts->repetitions / 2] * 1e9 / (1024 * 1024));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    struct options    opts;
+    margo_instance_id mid     = MARGO_INSTANCE_NULL;
+    char*             payload = NULL;
+    double*           rep_ns  = NULL;
+    struct proc_case  pc;
+    uint64_t          size;
+    size_t            t;
+    int               op;
+    hg_return_t       hret;
+    int               ret = -1;
+
+    memset(&pc, 0, sizeof(pc));
+
+    if (parse_args(argc, argv, &opts) < 0) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    mid = margo_init("na+sm", MARGO_CLIENT_MODE, 0, 0);
+    if (!mid) {
+        fprintf(stderr, "Error: failed to initialize margo.\n");
+        goto finish;
+    }
+
+    /* room for the largest payload plus the fixed fields of any type */
+    pc.buf_size = opts.max_payload + 4096;
+    pc.buf      = malloc(pc.buf_size);
+    payload     = malloc(opts.max_payload ? opts.max_payload : 1);
+    rep_ns      = calloc(opts.repetitions, sizeof(*rep_ns));
+    if (!pc.buf || !payload || !rep_ns) {
+        perror("malloc");
+        goto finish;
+    }
+    memset(payload, 0xa5, opts.max_payload);
+    memset(pc.buf, 0, pc.buf_size);
+
+    hret = hg_proc_create_set(margo_get_class(mid), pc.buf, pc.buf_size,
+                              HG_ENCODE, HG_NOHASH, &pc.proc);
+    if (hret != HG_SUCCESS) {
+        fprintf(stderr, "Error: hg_proc_create_set(): %d\n", hret);
+        goto finish;
+    }
+
+    printf("# proc_stats\t<type>\t<op>\t<payload_bytes>\t<encoded_bytes>\t"
+           "<iterations>\t<min_ns/op>\t<median_ns/op>\t<max_ns/op>\t"
+           "<median_MiB/s>\n");
+    for (t = 0; t < sizeof(proc_types) / sizeof(proc_types[0]); t++) {
+        pc.type = &proc_types[t];
+        /* payload sizes 0, factor, factor^2, ... up to max_payload */
+        for (size = 0; size <= opts.max_payload;
+             size = size ? size * opts.factor : opts.factor) {
+            pc.type->init(&pc.data, payload, size);
+
+            /* encode once to find the encoded size and to have something
+             * to decode
+             */
+            pc.op = HG_ENCODE;
+            if (proc_case_iter(&pc) != HG_SUCCESS) {
+                fprintf(stderr, "Error: could not encode %s\n", pc.type->name);
+                goto finish;
+            }
+            pc.encoded = hg_proc_get_size_used(pc.proc);
+
+            for (op = 0; op < 2; op++) {
+                pc.op = op ? HG_DECODE : HG_ENCODE;
+                if (proc_case_measure(&pc, size, &opts, rep_ns) != 0) {
+                    fprintf(stderr, "Error: %s failed\n", pc.type->name);
+                    goto finish;
+                }
+            }
+            if (!pc.type->has_payload) break;
+        }
+    }
+    ret = 0;
+
+finish:
+    if (pc.proc) hg_proc_free(pc.proc);
+    free(pc.buf);
+    free(payload);
+    free(rep_ns);
+    if (mid != MARGO_INSTANCE_NULL) margo_finalize(mid);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int parse_args(int argc, char** argv, struct options* opts)
+{
+    int opt;
+    int ret;
+
+    memset(opts, 0, sizeof(*opts));
+    opts->max_payload    = 1024 * 1024;
+    opts->factor         = 4;
+    opts->repetitions    = 5;
+    opts->target_seconds = 0.05;
+
+    while ((opt = getopt(argc, argv, "m:f:r:t:")) != -1) {
+        switch (opt) {
+        case 'm':
+            ret = sscanf(optarg, "%lu", &opts->max_payload);
+            if (ret != 1) return (-1);
+            break;
+        case 'f':
+            ret = sscanf(optarg, "%d", &opts->factor);
+            if (ret != 1 || opts->factor < 2) return (-1);
+            break;
+        case 'r':
+            ret = sscanf(optarg, "%d", &opts->repetitions);
+            if (ret != 1 || opts->repetitions < 1) return (-1);
+            break;
+        case 't':
+            ret = sscanf(optarg, "%lf", &opts->target_seconds);
+            if (ret != 1 || opts->target_seconds <= 0) return (-1);
+            break;
+        default:
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: "
+            "quintain-proc-benchmark [-m <max payload bytes>] [-f <payload "
+            "size factor>] [-r <repetitions>] [-t <seconds per "
+            "repetition>]\n");
+    return;
+}
@@ -0,0 +1,140 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "quintain-rapl.h"
+
+static int read_u64(const char* path, uint64_t* value)
+{
+    FILE*              f;
+    unsigned long long v;
+    int                ret;
+
+    f = fopen(path, "r");
+    if (!f) return -1;
+    ret = fscanf(f, "%llu", &v);
+    fclose(f);
+    if (ret != 1) return -1;
+    *value = v;
+
+    return 0;
+}
+
+static int read_name(const char* path, char* name, size_t len)
+{
+    FILE* f;
+
+    f = fopen(path, "r");
+    if (!f) return -1;
+    if (!fgets(name, len, f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    name[strcspn(name, "\n")] = 0;
+
+    return 0;
+}
+
+int qtn_rapl_init(struct qtn_rapl* rapl, const char* root)
+{
+    DIR*           dir;
+    struct dirent* entry;
+    char           path[1024];
+    char           name[64];
+    uint64_t       value, range;
+    int            idx, n;
+    int            nalloc = 0;
+
+    memset(rapl, 0, sizeof(*rapl));
+    if (!root) root = QTN_RAPL_DEFAULT_ROOT;
+
+    dir = opendir(root);
+    if (!dir) return 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        /* top level zones only; subzones are counted by their parents */
+        n = 0;
+        if (sscanf(entry->d_name, "intel-rapl:%d%n", &idx, &n) != 1
+            || entry->d_name[n] != '\0')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s/name", root, entry->d_name);
+        if (read_name(path, name, sizeof(name)) == 0
+            && !strcmp(name, "psys"))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", root,
+                 entry->d_name);
+        if (read_u64(path, &range) != 0) range = 0;
+        snprintf(path, sizeof(path), "%s/%s/energy_uj", root, entry->d_name);
+        /* counters are often readable only by root */
+        if (read_u64(path, &value) != 0) continue;
+
+        if (rapl->nzones == nalloc) {
+            nalloc = nalloc ? nalloc * 2 : 4;
+            rapl->energy_paths = realloc(
+                rapl->energy_paths, nalloc * sizeof(*rapl->energy_paths));
+            rapl->max_range_uj = realloc(
+                rapl->max_range_uj, nalloc * sizeof(*rapl->max_range_uj));
+            rapl->last_uj
+                = realloc(rapl->last_uj, nalloc * sizeof(*rapl->last_uj));
+            if (!rapl->energy_paths || !rapl->max_range_uj || !rapl->last_uj) {
+                closedir(dir);
+                qtn_rapl_finalize(rapl);
+                return -1;
+            }
+        }
+        rapl->energy_paths[rapl->nzones] = strdup(path);
+        if (!rapl->energy_paths[rapl->nzones]) {
+            closedir(dir);
+            qtn_rapl_finalize(rapl);
+            return -1;
+        }
+        rapl->max_range_uj[rapl->nzones] = range;
+        rapl->last_uj[rapl->nzones]      = value;
+        rapl->nzones++;
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+void qtn_rapl_finalize(struct qtn_rapl* rapl)
+{
+    int i;
+
+    if (rapl->energy_paths) {
+        for (i = 0; i < rapl->nzones; i++) free(rapl->energy_paths[i]);
+        free(rapl->energy_paths);
+    }
+    free(rapl->max_range_uj);
+    free(rapl->last_uj);
+    memset(rapl, 0, sizeof(*rapl));
+}
+
+double qtn_rapl_read(struct qtn_rapl* rapl)
+{
+    uint64_t value;
+    int      i;
+
+    if (rapl->nzones == 0) return -1;
+
+    for (i = 0; i < rapl->nzones; i++) {
+        /* keep the previous reading if a zone cannot be read this time */
+        if (read_u64(rapl->energy_paths[i], &value) != 0) continue;
+        if (value >= rapl->last_uj[i])
+            rapl->total_uj += (double)(value - rapl->last_uj[i]);
+        else if (rapl->max_range_uj[i])
+            rapl->total_uj
+                += (double)(rapl->max_range_uj[i] - rapl->last_uj[i] + value);
+        rapl->last_uj[i] = value;
+    }
+
+    return rapl->total_uj / 1e6;
+}
@@ -0,0 +1,43 @@
+/*
+ * (C) 2021 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __QUINTAIN_RAPL
+#define __QUINTAIN_RAPL
+
+#include <stdint.h>
+
+/* Energy measurement from the Linux powercap interface to RAPL counters.
+ * Shared by the provider and the benchmark drivers so that both sides
+ * account for energy the same way.
+ */
+
+/* default location of the powercap sysfs tree */
+#define QTN_RAPL_DEFAULT_ROOT "/sys/class/powercap"
+
+struct qtn_rapl {
+    int       nzones;
+    char**    energy_paths; /* energy_uj file of each zone */
+    uint64_t* max_range_uj; /* value at which each counter wraps */
+    uint64_t* last_uj;      /* previous reading of each counter */
+    double    total_uj;     /* energy accumulated since init */
+};
+
+/* Finds the readable top level RAPL zones (one per package; "psys" zones
+ * are skipped since they overlap the packages) under root.  Succeeds with
+ * nzones set to 0 if there are none, so that callers can treat energy as
+ * unavailable rather than as an error.
+ */
+int  qtn_rapl_init(struct qtn_rapl* rapl, const char* root);
+void qtn_rapl_finalize(struct qtn_rapl* rapl);
+
+/* Returns the energy in joules consumed by all zones since qtn_rapl_init(),
+ * or -1 if no zones are available.  Counter wraparound is corrected as long
+ * as reads are more frequent than the wrap period (minutes on current
+ * hardware).  Not thread safe; callers serialize reads.
+ */
+double qtn_rapl_read(struct qtn_rapl* rapl);
+
+#endif /* __QUINTAIN_RAPL */
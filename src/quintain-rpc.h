@@ -14,18 +14,28 @@
 typedef struct {
     uint64_t
         resp_buffer_size; /* size of buffer provider should give in response */
-    uint64_t  req_buffer_size; /* size of buffer in this request */
-    uint64_t  bulk_size;       /* bulk xfer size */
-    uint32_t  flags;           /* flags to modify behavior */
-    uint32_t  bulk_op;         /* what type of bulk xfer to do */
-    hg_bulk_t bulk_handle;     /* bulk handle (if set) for bulk xfer */
-    char*     req_buffer;      /* dummy buffer */
+    uint64_t  req_buffer_size;  /* size of buffer in this request */
+    uint64_t  bulk_size;        /* bulk xfer size */
+    uint64_t  chunk_size;       /* bulk xfer chunk size (0 = default) */
+    uint64_t  raw_size;         /* decompressed size of bulk data */
+    uint32_t  pipeline_depth;   /* chunk xfers in flight (0 = default) */
+    uint32_t  server_segments;  /* segments in provider's local bulk buffer */
+    uint32_t  fault_delay_usec; /* extra delay to inject before executing */
+    uint64_t  payload_seed;     /* seed for payload patterns (if verifying) */
+    uint32_t  req_crc;          /* checksum of req_buffer (if verifying) */
+    uint32_t  bulk_crc;         /* checksum of pulled bulk data (if verify) */
+    uint32_t  flags;            /* flags to modify behavior */
+    uint32_t  bulk_op;          /* what type of bulk xfer to do */
+    hg_bulk_t bulk_handle;      /* bulk handle (if set) for bulk xfer */
+    char*     req_buffer;       /* dummy buffer */
 } qtn_work_in_t;
 static inline hg_return_t hg_proc_qtn_work_in_t(hg_proc_t proc, void* v_out_p);
 
 typedef struct {
     uint64_t resp_buffer_size; /* size of buffer in this response */
     char*    resp_buffer;      /* dummy buffer */
+    uint32_t resp_crc;         /* checksum of resp_buffer (if verifying) */
+    uint32_t bulk_crc;         /* checksum of pushed bulk data (if verify) */
     int32_t  ret;              /* return code */
 } qtn_work_out_t;
 static inline hg_return_t hg_proc_qtn_work_out_t(hg_proc_t proc, void* v_out_p);
@@ -39,6 +49,15 @@ static inline hg_return_t hg_proc_qtn_work_in_t(hg_proc_t proc, void* v_out_p)
     hg_proc_uint64_t(proc, &in->resp_buffer_size);
     hg_proc_uint64_t(proc, &in->req_buffer_size);
     hg_proc_uint64_t(proc, &in->bulk_size);
+    hg_proc_uint64_t(proc, &in->chunk_size);
+    hg_proc_uint64_t(proc, &in->raw_size);
+    hg_proc_uint32_t(proc, &in->pipeline_depth);
+    hg_proc_uint32_t(proc, &in->server_segments);
+    hg_proc_uint32_t(proc, &in->fault_delay_usec);
+    hg_proc_uint64_t(proc, &in->payload_seed);
+    hg_proc_uint32_t(proc, &in->req_crc);
+    hg_proc_uint32_t(proc, &in->bulk_crc);
+    hg_proc_uint32_t(proc, &in->flags);
     hg_proc_uint32_t(proc, &in->bulk_op);
     hg_proc_hg_bulk_t(proc, &in->bulk_handle);
 
@@ -86,6 +105,8 @@ static inline hg_return_t hg_proc_qtn_work_out_t(hg_proc_t proc, void* v_out_p)
     /* these components are general, regardless of hg_proc_op_t */
     hg_proc_uint32_t(proc, &out->ret);
     hg_proc_uint64_t(proc, &out->resp_buffer_size);
+    hg_proc_uint32_t(proc, &out->resp_crc);
+    hg_proc_uint32_t(proc, &out->bulk_crc);
 
     /* The remainder of the response contains the resp_buffer; differentiate
      * how we handle it depending on the hg_proc_op_t mode.
@@ -123,8 +144,123 @@ static inline hg_return_t hg_proc_qtn_work_out_t(hg_proc_t proc, void* v_out_p)
     return (HG_SUCCESS);
 }
 
+/* one operation within a batch */
+typedef struct {
+    uint64_t req_buffer_size;  /* bytes of the batch req_buffer for this op */
+    uint64_t resp_buffer_size; /* bytes of the batch resp_buffer for this op */
+    uint64_t bulk_size;        /* bulk xfer size */
+    uint64_t bulk_offset;      /* offset of this op's data in bulk_handle */
+    uint32_t flags;            /* flags to modify behavior */
+    uint32_t bulk_op;          /* what type of bulk xfer to do */
+} qtn_work_op_t;
+
+typedef struct {
+    uint32_t       count;       /* number of operations */
+    uint32_t       flags;       /* flags to modify batch execution */
+    qtn_work_op_t* ops;         /* operation descriptors */
+    uint64_t       req_size;    /* total size of req_buffer */
+    hg_bulk_t      bulk_handle; /* bulk data for all ops (if any) */
+    char*          req_buffer;  /* dummy buffers for all ops, concatenated */
+} qtn_work_batch_in_t;
+
+typedef struct {
+    int32_t  ret;         /* return code for the batch as a whole */
+    uint32_t count;       /* number of per-op results */
+    int32_t* rets;        /* per-op return codes */
+    uint64_t resp_size;   /* total size of resp_buffer */
+    char*    resp_buffer; /* dummy buffers for all ops, concatenated */
+} qtn_work_batch_out_t;
+
+/* encodes a raw byte buffer of the given size (see req_buffer above) */
+static inline void
+qtn_proc_raw_buffer(hg_proc_t proc, char** buffer, uint64_t size)
+{
+    void* buf;
+
+    if (!size) return;
+    switch (hg_proc_get_op(proc)) {
+    case HG_ENCODE:
+        buf = hg_proc_save_ptr(proc, size);
+        memcpy(buf, *buffer, size);
+        hg_proc_restore_ptr(proc, buf, size);
+        break;
+    case HG_DECODE:
+        buf     = hg_proc_save_ptr(proc, size);
+        *buffer = buf;
+        hg_proc_restore_ptr(proc, buf, size);
+        break;
+    case HG_FREE:
+        break;
+    }
+}
+
+static inline hg_return_t hg_proc_qtn_work_batch_in_t(hg_proc_t proc,
+                                                      void*     v_out_p)
+{
+    qtn_work_batch_in_t* in = v_out_p;
+    uint32_t             i;
+
+    hg_proc_uint32_t(proc, &in->count);
+    hg_proc_uint32_t(proc, &in->flags);
+
+    if (hg_proc_get_op(proc) == HG_DECODE) {
+        in->ops = calloc(in->count, sizeof(*in->ops));
+        if (in->count && !in->ops) return HG_NOMEM;
+    }
+    for (i = 0; i < in->count; i++) {
+        hg_proc_uint64_t(proc, &in->ops[i].req_buffer_size);
+        hg_proc_uint64_t(proc, &in->ops[i].resp_buffer_size);
+        hg_proc_uint64_t(proc, &in->ops[i].bulk_size);
+        hg_proc_uint64_t(proc, &in->ops[i].bulk_offset);
+        hg_proc_uint32_t(proc, &in->ops[i].flags);
+        hg_proc_uint32_t(proc, &in->ops[i].bulk_op);
+    }
+
+    hg_proc_uint64_t(proc, &in->req_size);
+    hg_proc_hg_bulk_t(proc, &in->bulk_handle);
+    qtn_proc_raw_buffer(proc, &in->req_buffer, in->req_size);
+
+    if (hg_proc_get_op(proc) == HG_FREE) {
+        free(in->ops);
+        in->ops = NULL;
+    }
+
+    return (HG_SUCCESS);
+}
+
+static inline hg_return_t hg_proc_qtn_work_batch_out_t(hg_proc_t proc,
+                                                       void*     v_out_p)
+{
+    qtn_work_batch_out_t* out = v_out_p;
+    uint32_t              i;
+
+    hg_proc_int32_t(proc, &out->ret);
+    hg_proc_uint32_t(proc, &out->count);
+
+    if (hg_proc_get_op(proc) == HG_DECODE) {
+        out->rets = calloc(out->count, sizeof(*out->rets));
+        if (out->count && !out->rets) return HG_NOMEM;
+    }
+    for (i = 0; i < out->count; i++) hg_proc_int32_t(proc, &out->rets[i]);
+
+    hg_proc_uint64_t(proc, &out->resp_size);
+    qtn_proc_raw_buffer(proc, &out->resp_buffer, out->resp_size);
+
+    if (hg_proc_get_op(proc) == HG_FREE) {
+        free(out->rets);
+        out->rets = NULL;
+    }
+
+    return (HG_SUCCESS);
+}
+
+/* energy_uj is -1 if the provider cannot read energy counters */
 MERCURY_GEN_PROC(qtn_stat_out_t,
                  ((int32_t)(ret))((int64_t)(utime_sec))((int64_t)(utime_usec))(
-                     (int64_t)(stime_sec))((int64_t)(stime_usec)))
+                     (int64_t)(stime_sec))((int64_t)(stime_usec))(
+                     (int64_t)(energy_uj)))
+
+MERCURY_GEN_PROC(qtn_set_config_in_t, ((hg_const_string_t)(json_config)))
+MERCURY_GEN_PROC(qtn_set_config_out_t, ((int32_t)(ret)))
 
 #endif /* __QUINTAIN_RPC */
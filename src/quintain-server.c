@@ -13,6 +13,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <zlib.h>
 
 #include <margo.h>
 #include <margo-bulk-pool.h>
@@ -24,25 +25,163 @@
 
 #include "quintain-rpc.h"
 #include "quintain-macros.h"
+#include "quintain-payload.h"
+#include "quintain-rapl.h"
+#include "quintain-perf.h"
+#include "quintain-fault.h"
 
 DECLARE_MARGO_RPC_HANDLER(qtn_work_ult)
 DECLARE_MARGO_RPC_HANDLER(qtn_stat_ult)
+DECLARE_MARGO_RPC_HANDLER(qtn_set_config_ult)
+DECLARE_MARGO_RPC_HANDLER(qtn_work_batch_ult)
+
+/* A buffer poolset that can be replaced by quintain_provider_set_config()
+ * while requests are still using it.  The provider holds one reference and
+ * each request that draws buffers from it holds another; the poolset is
+ * destroyed when the last reference is released.
+ */
+struct qtn_poolset_ref {
+    margo_bulk_poolset_t poolset;
+    int                  refcount;
+};
+
+/* handler pools that work requests can be routed to */
+enum qtn_pool_class {
+    QTN_POOL_DEFAULT = 0, /* the provider's rpc_pool */
+    QTN_POOL_BULK,        /* the provider's bulk_pool */
+    QTN_POOL_FAST,        /* the fast path, if enabled */
+    QTN_POOL_COUNT
+};
+static const char* const qtn_pool_names[QTN_POOL_COUNT]
+    = {"default", "bulk", "fast"};
+
+/* how small work requests are handled (see "fast_path") */
+enum qtn_fast_path {
+    QTN_FAST_PATH_NONE = 0, /* a new ULT per request, like everything else */
+    QTN_FAST_PATH_INLINE,   /* answered in the Mercury callback */
+    QTN_FAST_PATH_WORKER    /* queued to pre-spawned worker ULTs */
+};
+static const char* const qtn_fast_path_names[]
+    = {"none", "inline", "worker", NULL};
+
+/* per-pool request statistics */
+struct qtn_pool_stats {
+    uint64_t requests;     /* requests completed */
+    uint64_t busy_ns;      /* time spent executing requests */
+    uint64_t queue_ns;     /* time spent waiting to be re-dispatched */
+    uint64_t size_samples; /* pool length samples taken on arrival */
+    uint64_t size_sum;     /* sum of the sampled pool lengths */
+    uint64_t size_max;     /* longest pool length sampled */
+};
+
+/* a work request handed off from the RPC handler to the ULT running it */
+struct qtn_work_dispatch {
+    hg_handle_t               handle;
+    quintain_provider_t       provider;
+    qtn_work_in_t             in;
+    double                    dispatch_ts;  /* when it was handed off */
+    int                       admitted;     /* holds an admission slot */
+    int                       fast_pending; /* counted by the provider */
+    int                       responded;    /* only req is left to wait for */
+    margo_request             req;          /* fast path response in flight */
+    struct qtn_work_dispatch* next;         /* fast path worker queue */
+};
 
 static int validate_and_complete_config(struct json_object* _config,
                                         ABT_pool            _progress_pool);
-static int setup_poolset(quintain_provider_t provider);
+static int qtn_poolset_create(margo_instance_id        mid,
+                              struct json_object*      config,
+                              struct qtn_poolset_ref** ref);
+static struct qtn_poolset_ref*
+            qtn_poolset_acquire(quintain_provider_t provider);
+static void qtn_poolset_release(struct qtn_poolset_ref* ref);
+static void qtn_apply_workload_config(quintain_provider_t provider,
+                                      struct json_object* config);
+static hg_return_t qtn_work_fast_cb(hg_handle_t handle);
+static int         qtn_fast_path_start(quintain_provider_t provider, int n);
+static void        qtn_fast_path_stop(quintain_provider_t provider);
+
+static void qtn_fast_path_drain(quintain_provider_t provider);
+struct qtn_bulk_stage;
+static hg_return_t
+qtn_bulk_transfer_pipelined(quintain_provider_t    provider,
+                            const qtn_work_in_t*   in,
+                            hg_addr_t              addr,
+                            hg_size_t              chunk_size,
+                            uint32_t               pipeline_depth,
+                            struct qtn_bulk_stage* stage);
+static hg_return_t qtn_segmented_bulk_create(margo_instance_id mid,
+                                             hg_size_t         size,
+                                             uint32_t          nsegments,
+                                             uint8_t           bulk_flag,
+                                             void***           buffers,
+                                             uint32_t*         nbuffers,
+                                             hg_bulk_t*        handle);
 
 struct quintain_provider {
     margo_instance_id mid;
     ABT_pool handler_pool; // pool used to run RPC handlers for this provider
-    margo_bulk_poolset_t poolset; /* intermediate buffers, if used */
+    ABT_pool bulk_pool;    // pool used to run large requests, if any
+    struct qtn_poolset_ref* poolset; /* intermediate buffers, if used */
+
+    /* workload defaults; updated by quintain_provider_set_config() */
+    hg_size_t bulk_chunk_size;     /* default chunk size for bulk xfers */
+    uint32_t  bulk_pipeline_depth; /* default chunk xfers in flight */
+    int       compression_level;   /* zlib level for QTN_WORK_COMPRESS */
+    uint64_t  bulk_pool_threshold; /* request size routed to bulk_pool */
+    uint64_t  max_inflight;        /* concurrently executing requests */
+    uint64_t  max_queued;          /* requests waiting for admission */
+
+    /* statistics */
+    uint64_t integrity_errors;      /* payloads that failed verification */
+    uint64_t compression_bytes_in;  /* bytes fed to compression stage */
+    uint64_t compression_bytes_out; /* bytes produced by compression stage */
+    uint64_t queued_requests;       /* requests that waited for admission */
+    uint64_t rejected_requests;     /* requests refused as busy */
+    struct qtn_pool_stats pool_stats[QTN_POOL_COUNT];
+    struct qtn_rapl       rapl;       /* node energy counters */
+    ABT_mutex             rapl_mutex; /* serializes energy counter reads */
+    struct qtn_perf       perf;       /* per-xstream accounting, if enabled */
+    struct qtn_fault      fault;      /* injected faults and their counts */
+
+    /* admission control state */
+    ABT_mutex admit_mutex;
+    ABT_cond  admit_cond; /* signaled when an execution slot frees up */
+    uint64_t  inflight;   /* admitted requests still executing */
+    uint64_t  waiting;    /* requests waiting for a slot */
+
+    /* fast path state; fixed when the provider is registered */
+    int                       fast_path;     /* enum qtn_fast_path */
+    uint64_t                  fast_max_size; /* largest eligible request */
+    ABT_mutex                 fast_mutex;    /* protects the worker queue */
+    ABT_cond                  fast_cond;     /* signaled on enqueue/stop */
+    struct qtn_work_dispatch* fast_head;     /* requests awaiting a worker */
+    struct qtn_work_dispatch* fast_tail;
+    uint64_t                  fast_queued;   /* requests awaiting execution */
+    uint64_t                  fast_pending;  /* handed off, not completed */
+    ABT_cond                  fast_idle;     /* fast_pending dropped to 0 */
+    int                       fast_stop;     /* workers should exit */
+    int                       fast_nworkers;
+    ABT_thread*               fast_workers;
 
     hg_id_t qtn_work_rpc_id;
     hg_id_t qtn_stat_rpc_id;
+    hg_id_t qtn_set_config_rpc_id;
+    hg_id_t qtn_work_batch_rpc_id;
 
     struct json_object* json_cfg;
+    ABT_mutex config_mutex;   /* protects json_cfg and poolset pointer */
+    ABT_mutex reconfig_mutex; /* serializes configuration changes */
 };
 
+/* runs while margo's progress loop, which the requests being drained may
+ * still need, is running
+ */
+static void quintain_server_prefinalize_cb(void* data)
+{
+    qtn_fast_path_drain(data);
+}
+
 static void quintain_server_finalize_cb(void* data)
 {
     struct quintain_provider* provider = (struct quintain_provider*)data;
@@ -50,15 +189,43 @@ static void quintain_server_finalize_cb(void* data)
 
     margo_deregister(provider->mid, provider->qtn_work_rpc_id);
     margo_deregister(provider->mid, provider->qtn_stat_rpc_id);
+    margo_deregister(provider->mid, provider->qtn_set_config_rpc_id);
+    margo_deregister(provider->mid, provider->qtn_work_batch_rpc_id);
 
-    if (provider->poolset) margo_bulk_poolset_destroy(provider->poolset);
+    qtn_fast_path_drain(provider);
+    qtn_fast_path_stop(provider);
+
+    if (provider->poolset) qtn_poolset_release(provider->poolset);
 
     if (provider->json_cfg) json_object_put(provider->json_cfg);
 
+    ABT_mutex_free(&provider->config_mutex);
+    ABT_mutex_free(&provider->reconfig_mutex);
+    ABT_mutex_free(&provider->admit_mutex);
+    ABT_cond_free(&provider->admit_cond);
+    ABT_mutex_free(&provider->rapl_mutex);
+    ABT_mutex_free(&provider->fast_mutex);
+    ABT_cond_free(&provider->fast_cond);
+    ABT_cond_free(&provider->fast_idle);
+    qtn_rapl_finalize(&provider->rapl);
+    qtn_perf_finalize(&provider->perf);
+    qtn_fault_finalize(&provider->fault);
+
     free(provider);
     return;
 }
 
+static void qtn_perf_register_progress_ult(void* arg)
+{
+    qtn_perf_register(arg, "progress");
+}
+
+/* for a progress pool that is shared with work handlers */
+static void qtn_perf_register_mixed_ult(void* arg)
+{
+    qtn_perf_register(arg, "mixed");
+}
+
 int quintain_provider_register(margo_instance_id mid,
                                uint16_t          provider_id,
                                const struct quintain_provider_init_info* uargs,
@@ -69,6 +236,10 @@ int quintain_provider_register(margo_instance_id mid,
     int                                ret;
     hg_id_t                            rpc_id;
     struct json_object*                config = NULL;
+    int                                perf_counters;
+    const char*                        fast_path;
+    ABT_pool                           progress_pool = ABT_POOL_NULL;
+    int                                shared;
 
     /* check if a provider with the same provider id already exists */
     {
@@ -122,25 +293,117 @@ int quintain_provider_register(margo_instance_id mid,
         ret = QTN_ERR_ALLOCATION;
         goto error;
     }
-    tmp_provider->json_cfg = config;
-    tmp_provider->mid      = mid;
+    tmp_provider->json_cfg       = config;
+    tmp_provider->mid            = mid;
+    tmp_provider->config_mutex   = ABT_MUTEX_NULL;
+    tmp_provider->reconfig_mutex = ABT_MUTEX_NULL;
+    tmp_provider->admit_mutex    = ABT_MUTEX_NULL;
+    tmp_provider->admit_cond     = ABT_COND_NULL;
+    tmp_provider->rapl_mutex     = ABT_MUTEX_NULL;
+    tmp_provider->fast_mutex     = ABT_MUTEX_NULL;
+    tmp_provider->fast_cond      = ABT_COND_NULL;
+    tmp_provider->fast_idle      = ABT_COND_NULL;
+    if (ABT_mutex_create(&tmp_provider->config_mutex) != ABT_SUCCESS
+        || ABT_mutex_create(&tmp_provider->reconfig_mutex) != ABT_SUCCESS
+        || ABT_mutex_create(&tmp_provider->admit_mutex) != ABT_SUCCESS
+        || ABT_cond_create(&tmp_provider->admit_cond) != ABT_SUCCESS
+        || ABT_mutex_create(&tmp_provider->rapl_mutex) != ABT_SUCCESS
+        || ABT_mutex_create(&tmp_provider->fast_mutex) != ABT_SUCCESS
+        || ABT_cond_create(&tmp_provider->fast_cond) != ABT_SUCCESS
+        || ABT_cond_create(&tmp_provider->fast_idle) != ABT_SUCCESS
+        || qtn_fault_init(&tmp_provider->fault) != 0) {
+        ret = QTN_ERR_ALLOCATION;
+        goto error;
+    }
+
+    /* energy counters; the provider runs without them if the node has no
+     * readable RAPL zones
+     */
+    ret = qtn_rapl_init(
+        &tmp_provider->rapl,
+        json_object_get_string(json_object_object_get(config, "rapl_root")));
+    if (ret != 0) {
+        ret = QTN_ERR_ALLOCATION;
+        goto error;
+    }
 
     if (args.rpc_pool != NULL)
         tmp_provider->handler_pool = args.rpc_pool;
     else
         margo_get_handler_pool(mid, &(tmp_provider->handler_pool));
+    tmp_provider->bulk_pool = args.bulk_pool;
+
+    /* per-xstream accounting; perf event counters imply it */
+    perf_counters = json_object_get_boolean(
+        json_object_object_get(config, "perf_counters"));
+    if (perf_counters
+        || json_object_get_boolean(
+            json_object_object_get(config, "xstream_stats"))) {
+        if (qtn_perf_init(&tmp_provider->perf, perf_counters) != 0) {
+            ret = QTN_ERR_ALLOCATION;
+            goto error;
+        }
+    }
+
+    qtn_apply_workload_config(tmp_provider, config);
 
     /* create buffer poolset if needed for config */
-    ret = setup_poolset(tmp_provider);
+    ret = qtn_poolset_create(mid, config, &tmp_provider->poolset);
     if (ret != 0) {
         QTN_ERROR(mid, "could not create poolset");
         goto error;
     }
 
-    /* register RPCs */
-    rpc_id = MARGO_REGISTER_PROVIDER(mid, "qtn_work_rpc", qtn_work_in_t,
-                                     qtn_work_out_t, qtn_work_ult, provider_id,
-                                     tmp_provider->handler_pool);
+    /* optional fast path for small work requests */
+    fast_path
+        = json_object_get_string(json_object_object_get(config, "fast_path"));
+    while (qtn_fast_path_names[tmp_provider->fast_path]
+           && strcmp(qtn_fast_path_names[tmp_provider->fast_path], fast_path))
+        tmp_provider->fast_path++;
+    if (!qtn_fast_path_names[tmp_provider->fast_path]) {
+        QTN_ERROR(mid, "unknown fast_path \"%s\"", fast_path);
+        ret = QTN_ERR_INVALID_ARG;
+        goto error;
+    }
+    tmp_provider->fast_max_size = json_object_get_int64(
+        json_object_object_get(config, "fast_path_max_size"));
+    if (tmp_provider->fast_path != QTN_FAST_PATH_NONE) {
+        ret = qtn_fast_path_start(
+            tmp_provider, json_object_get_int(json_object_object_get(
+                              config, "fast_path_workers")));
+        if (ret != 0) {
+            QTN_ERROR(mid, "could not start fast path workers");
+            goto error;
+        }
+    }
+
+    /* the progress xstream may never run a work handler, so have it
+     * register itself; it is only a dedicated progress xstream if none of
+     * the provider's handlers are scheduled on its pool (e.g. not with
+     * rpc_thread_count 0).  The ULT is detached, so it is only created once
+     * nothing else can fail and free the provider.
+     */
+    margo_get_progress_pool(mid, &progress_pool);
+    if (tmp_provider->perf.xstreams && progress_pool != ABT_POOL_NULL) {
+        shared = progress_pool == tmp_provider->handler_pool
+              || progress_pool == tmp_provider->bulk_pool;
+        ABT_thread_create(progress_pool,
+                          shared ? qtn_perf_register_mixed_ult
+                                 : qtn_perf_register_progress_ult,
+                          &tmp_provider->perf, ABT_THREAD_ATTR_NULL, NULL);
+    }
+
+    /* register RPCs.  With a fast path, work requests arrive in a plain
+     * Mercury callback instead of a ULT created by margo.
+     */
+    if (tmp_provider->fast_path != QTN_FAST_PATH_NONE)
+        rpc_id = margo_provider_register_name(
+            mid, "qtn_work_rpc", hg_proc_qtn_work_in_t, hg_proc_qtn_work_out_t,
+            qtn_work_fast_cb, provider_id, tmp_provider->handler_pool);
+    else
+        rpc_id = MARGO_REGISTER_PROVIDER(
+            mid, "qtn_work_rpc", qtn_work_in_t, qtn_work_out_t, qtn_work_ult,
+            provider_id, tmp_provider->handler_pool);
     margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
     tmp_provider->qtn_work_rpc_id = rpc_id;
     rpc_id = MARGO_REGISTER_PROVIDER(mid, "qtn_stat_rpc", void, qtn_stat_out_t,
@@ -148,8 +411,20 @@ int quintain_provider_register(margo_instance_id mid,
                                      tmp_provider->handler_pool);
     margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
     tmp_provider->qtn_stat_rpc_id = rpc_id;
+    rpc_id = MARGO_REGISTER_PROVIDER(
+        mid, "qtn_set_config_rpc", qtn_set_config_in_t, qtn_set_config_out_t,
+        qtn_set_config_ult, provider_id, tmp_provider->handler_pool);
+    margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
+    tmp_provider->qtn_set_config_rpc_id = rpc_id;
+    rpc_id = MARGO_REGISTER_PROVIDER(
+        mid, "qtn_work_batch_rpc", qtn_work_batch_in_t, qtn_work_batch_out_t,
+        qtn_work_batch_ult, provider_id, tmp_provider->handler_pool);
+    margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
+    tmp_provider->qtn_work_batch_rpc_id = rpc_id;
 
-    /* install the quintain server finalize callback */
+    /* install the quintain server finalize callbacks */
+    margo_provider_push_prefinalize_callback(
+        mid, tmp_provider, &quintain_server_prefinalize_cb, tmp_provider);
     margo_provider_push_finalize_callback(
         mid, tmp_provider, &quintain_server_finalize_cb, tmp_provider);
 
@@ -161,8 +436,27 @@ error:
 
     if (config) json_object_put(config);
     if (tmp_provider) {
-        if (tmp_provider->poolset)
-            margo_bulk_poolset_destroy(tmp_provider->poolset);
+        qtn_fast_path_stop(tmp_provider);
+        if (tmp_provider->poolset) qtn_poolset_release(tmp_provider->poolset);
+        if (tmp_provider->config_mutex != ABT_MUTEX_NULL)
+            ABT_mutex_free(&tmp_provider->config_mutex);
+        if (tmp_provider->reconfig_mutex != ABT_MUTEX_NULL)
+            ABT_mutex_free(&tmp_provider->reconfig_mutex);
+        if (tmp_provider->admit_mutex != ABT_MUTEX_NULL)
+            ABT_mutex_free(&tmp_provider->admit_mutex);
+        if (tmp_provider->admit_cond != ABT_COND_NULL)
+            ABT_cond_free(&tmp_provider->admit_cond);
+        if (tmp_provider->rapl_mutex != ABT_MUTEX_NULL)
+            ABT_mutex_free(&tmp_provider->rapl_mutex);
+        if (tmp_provider->fast_mutex != ABT_MUTEX_NULL)
+            ABT_mutex_free(&tmp_provider->fast_mutex);
+        if (tmp_provider->fast_cond != ABT_COND_NULL)
+            ABT_cond_free(&tmp_provider->fast_cond);
+        if (tmp_provider->fast_idle != ABT_COND_NULL)
+            ABT_cond_free(&tmp_provider->fast_idle);
+        qtn_rapl_finalize(&tmp_provider->rapl);
+        qtn_perf_finalize(&tmp_provider->perf);
+        qtn_fault_finalize(&tmp_provider->fault);
         free(tmp_provider);
     }
 
@@ -171,6 +465,7 @@ error:
 
 int quintain_provider_deregister(quintain_provider_t provider)
 {
+    margo_provider_pop_prefinalize_callback(provider->mid, provider);
     margo_provider_pop_finalize_callback(provider->mid, provider);
     quintain_server_finalize_cb(provider);
     return QTN_SUCCESS;
@@ -180,206 +475,344 @@ int quintain_provider_deregister(quintain_provider_t provider)
 static int hpctoolkit_started = 0;
 #endif
 
-static void qtn_work_ult(hg_handle_t handle)
+/* size of scratch output buffer used by the compression stage */
+#define QTN_ZBUF_SIZE (64 * 1024)
+
+/* Processing applied to bulk data as it moves through the provider: payload
+ * generation and checksums for QTN_WORK_VERIFY_PAYLOAD, and an optional
+ * zlib compression or decompression stage.  Data is always presented to the
+ * stage in payload order, whether it moves in one transfer or in chunks.
+ */
+struct qtn_bulk_stage {
+    int              verify; /* generate or checksum payloads */
+    uint64_t         seed;   /* pattern seed for generated data */
+    uint32_t         crc;    /* running checksum of data moved so far */
+    int              zmode;  /* QTN_WORK_COMPRESS, QTN_WORK_DECOMPRESS or 0 */
+    int              zerr;   /* first zlib error encountered, if any */
+    int              zdone;  /* decompression reached end of stream */
+    z_stream         zs;     /* zlib stream state */
+    unsigned char*   zbuf;   /* scratch output (the result is discarded) */
+    struct qtn_perf* perf;   /* charged for the time spent in the stage */
+};
+
+static int qtn_bulk_stage_init(struct qtn_bulk_stage* stage,
+                               const qtn_work_in_t*   in,
+                               int                    level,
+                               struct qtn_perf*       perf)
 {
-    margo_instance_id     mid = MARGO_INSTANCE_NULL;
-    qtn_work_in_t         in;
-    qtn_work_out_t        out;
-    const struct hg_info* info     = NULL;
-    quintain_provider_t   provider = NULL;
-    hg_return_t           hret;
-    void*                 bulk_buffer = NULL;
-    int                   bulk_flag   = HG_BULK_WRITE_ONLY;
-    hg_bulk_t             bulk_handle = HG_BULK_NULL;
+    int zret;
 
-    memset(&out, 0, sizeof(out));
+    memset(stage, 0, sizeof(*stage));
+    stage->perf   = perf;
+    stage->verify = (in->flags & QTN_WORK_VERIFY_PAYLOAD) != 0;
+    stage->seed   = in->payload_seed ^ QTN_PAYLOAD_SALT_BULK;
+    stage->zmode  = in->flags & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS);
 
-#ifdef HAVE_HPCTOOLKIT
-    if (!hpctoolkit_started) {
-        hpctoolkit_sampling_start();
-        hpctoolkit_started = 1;
-    }
-#endif
+    if (!stage->zmode) return QTN_SUCCESS;
 
-    mid = margo_hg_handle_get_instance(handle);
-    assert(mid);
-    info     = margo_get_info(handle);
-    provider = margo_registered_data(mid, info->id);
-    if (!provider) {
-        out.ret = QTN_ERR_UNKNOWN_PROVIDER;
-        QTN_ERROR(mid, "Unkown provider");
-        goto finish;
+    /* the compression stage only applies to data pulled from the client */
+    if (stage->zmode == (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS)
+        || in->bulk_size == 0 || in->bulk_op != HG_BULK_PULL) {
+        stage->zmode = 0;
+        return QTN_ERR_INVALID_ARG;
     }
 
-    hret = margo_get_input(handle, &in);
-    if (hret != HG_SUCCESS) {
-        out.ret = QTN_ERR_MERCURY;
-        QTN_ERROR(mid, "margo_get_input: %s", HG_Error_to_string(hret));
-        goto finish;
+    stage->zbuf = malloc(QTN_ZBUF_SIZE);
+    if (!stage->zbuf) {
+        stage->zmode = 0;
+        return QTN_ERR_ALLOCATION;
     }
 
-    out.resp_buffer_size = in.resp_buffer_size;
-    if (in.resp_buffer_size)
-        out.resp_buffer = calloc(1, in.resp_buffer_size);
+    if (stage->zmode == QTN_WORK_COMPRESS)
+        zret = deflateInit(&stage->zs, level);
     else
-        out.resp_buffer = NULL;
+        zret = inflateInit(&stage->zs);
+    if (zret != Z_OK) {
+        free(stage->zbuf);
+        stage->zbuf  = NULL;
+        stage->zmode = 0;
+        return QTN_ERR_COMPRESSION;
+    }
 
-    if (in.bulk_size) {
-        /* we were asked to perform a bulk transfer */
-        if (in.flags & QTN_WORK_USE_SERVER_POOLSET) {
-            /* get buffer from poolset */
-            out.ret = margo_bulk_poolset_get(provider->poolset, in.bulk_size,
-                                             &bulk_handle);
-            if (out.ret != 0) {
-                out.ret = QTN_ERR_ALLOCATION;
-                QTN_ERROR(mid, "margo_bulk_poolset_get: %s",
-                          HG_Error_to_string(hret));
-                goto finish;
-            }
-        } else {
-            /* allocate buffer and register */
-            bulk_buffer = malloc(in.bulk_size);
-            if (!bulk_buffer) {
-                out.ret = QTN_ERR_ALLOCATION;
-                goto finish;
-            }
-            if (in.bulk_op == HG_BULK_PUSH) bulk_flag = HG_BULK_READ_ONLY;
-            out.ret = margo_bulk_create(mid, 1, (void**)(&bulk_buffer),
-                                        &in.bulk_size, bulk_flag, &bulk_handle);
-            if (out.ret != HG_SUCCESS) {
-                QTN_ERROR(mid, "margo_bulk_poolset_get: %s",
-                          HG_Error_to_string(hret));
-                goto finish;
-            }
+    return QTN_SUCCESS;
+}
+
+static void qtn_bulk_stage_compress(struct qtn_bulk_stage* stage,
+                                    void*                  data,
+                                    size_t                 size,
+                                    int                    flush)
+{
+    int zret;
+
+    if (stage->zerr) return;
+
+    stage->zs.next_in  = data;
+    stage->zs.avail_in = size;
+    do {
+        stage->zs.next_out  = stage->zbuf;
+        stage->zs.avail_out = QTN_ZBUF_SIZE;
+        if (stage->zmode == QTN_WORK_COMPRESS)
+            zret = deflate(&stage->zs, flush);
+        else
+            zret = inflate(&stage->zs, Z_NO_FLUSH);
+        if (zret == Z_STREAM_END) stage->zdone = 1;
+        if (zret != Z_OK && zret != Z_STREAM_END && zret != Z_BUF_ERROR) {
+            stage->zerr = zret;
+            return;
         }
+    } while (stage->zs.avail_out == 0
+             || (flush == Z_FINISH && zret != Z_STREAM_END));
+}
 
-        /* transfer */
-        out.ret
-            = margo_bulk_transfer(mid, in.bulk_op, info->addr, in.bulk_handle,
-                                  0, bulk_handle, 0, in.bulk_size);
+/* Runs the stage over the first size bytes of a local bulk handle, which
+ * hold the data at payload_offset within the logical payload.  If produce is
+ * set then the data is about to be sent and is generated first; otherwise
+ * it has just been received.
+ */
+static void qtn_bulk_stage_apply(struct qtn_bulk_stage* stage,
+                                 hg_bulk_t              handle,
+                                 hg_size_t              size,
+                                 uint64_t               payload_offset,
+                                 int                    produce)
+{
+    uint32_t                count;
+    void*                   ptr_stack[8];
+    hg_size_t               size_stack[8];
+    void**                  ptrs  = ptr_stack;
+    hg_size_t*              sizes = size_stack;
+    uint32_t                actual_count;
+    hg_size_t               this_size;
+    uint32_t                i;
+    struct qtn_perf_section section;
+
+    if (!stage->verify && (produce || !stage->zmode)) return;
+
+    qtn_perf_begin(stage->perf, &section);
+    count = HG_Bulk_get_segment_count(handle);
+    if (count > 8) {
+        ptrs  = malloc(count * sizeof(*ptrs));
+        sizes = malloc(count * sizeof(*sizes));
+        if (!ptrs || !sizes) {
+            /* poison the checksum rather than crash */
+            stage->crc = ~stage->crc;
+            stage->zerr = Z_MEM_ERROR;
+            goto finish;
+        }
     }
-    if (out.ret != HG_SUCCESS) {
-        QTN_ERROR(mid, "margo_bulk_transfer: %s", HG_Error_to_string(out.ret));
+
+    margo_bulk_access(handle, 0, size, HG_BULK_READWRITE, count, ptrs, sizes,
+                      &actual_count);
+    for (i = 0; i < actual_count && size > 0; i++) {
+        this_size = sizes[i] < size ? sizes[i] : size;
+        if (produce && stage->verify)
+            qtn_payload_fill(ptrs[i], this_size, stage->seed, payload_offset);
+        if (stage->verify)
+            stage->crc = qtn_crc32c(stage->crc, ptrs[i], this_size);
+        if (!produce && stage->zmode)
+            qtn_bulk_stage_compress(stage, ptrs[i], this_size, Z_NO_FLUSH);
+        payload_offset += this_size;
+        size -= this_size;
     }
 
 finish:
-    margo_respond(handle, &out);
-    margo_free_input(handle, &in);
-    if (bulk_handle != HG_BULK_NULL) {
-        if (in.flags & QTN_WORK_USE_SERVER_POOLSET)
-            margo_bulk_poolset_release(provider->poolset, bulk_handle);
-        else
-            margo_bulk_free(bulk_handle);
+    if (ptrs != ptr_stack) free(ptrs);
+    if (sizes != size_stack) free(sizes);
+    qtn_perf_end(stage->perf, &section);
+}
+
+/* Completes the compression stage (if any) once all data has been seen and
+ * accounts for it in the provider statistics.
+ */
+static int qtn_bulk_stage_finish(struct qtn_bulk_stage* stage,
+                                 quintain_provider_t    provider,
+                                 const qtn_work_in_t*   in)
+{
+    struct qtn_perf_section section;
+
+    if (!stage->zmode) return QTN_SUCCESS;
+
+    if (stage->zmode == QTN_WORK_COMPRESS) {
+        qtn_perf_begin(stage->perf, &section);
+        qtn_bulk_stage_compress(stage, NULL, 0, Z_FINISH);
+        qtn_perf_end(stage->perf, &section);
+    } else if (!stage->zdone || stage->zs.total_out != in->raw_size)
+        stage->zerr = stage->zerr ? stage->zerr : Z_DATA_ERROR;
+
+    if (stage->zerr) {
+        QTN_ERROR(provider->mid, "compression stage failed: %d", stage->zerr);
+        return QTN_ERR_COMPRESSION;
     }
-    if (bulk_buffer != NULL) free(bulk_buffer);
-    if (out.resp_buffer) free(out.resp_buffer);
-    margo_destroy(handle);
+
+    __atomic_fetch_add(&provider->compression_bytes_in, stage->zs.total_in,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&provider->compression_bytes_out, stage->zs.total_out,
+                       __ATOMIC_RELAXED);
+
+    return QTN_SUCCESS;
 }
-DEFINE_MARGO_RPC_HANDLER(qtn_work_ult)
 
-static int validate_and_complete_config(struct json_object* _config,
-                                        ABT_pool            _progress_pool)
+static void qtn_bulk_stage_destroy(struct qtn_bulk_stage* stage)
 {
-    struct json_object* val;
-    long                page_size;
+    if (stage->zmode == QTN_WORK_COMPRESS)
+        deflateEnd(&stage->zs);
+    else if (stage->zmode == QTN_WORK_DECOMPRESS)
+        inflateEnd(&stage->zs);
+    free(stage->zbuf);
+    stage->zmode = 0;
+    stage->zbuf  = NULL;
+}
 
-    /* report version number for this component */
-    CONFIG_OVERRIDE_STRING(_config, "version", PACKAGE_VERSION, "version", 1);
+/* returns true if a request should run on the provider's bulk pool */
+static int qtn_work_is_bulk(quintain_provider_t  provider,
+                            const qtn_work_in_t* in)
+{
+    uint64_t threshold
+        = __atomic_load_n(&provider->bulk_pool_threshold, __ATOMIC_RELAXED);
 
-    /* populate default poolset settings if not specified already */
+    if (in->flags & QTN_WORK_BULK_CLASS) return 1;
+    return threshold
+        && in->req_buffer_size + in->resp_buffer_size + in->bulk_size
+               >= threshold;
+}
 
-    /* poolset yes or no; implies intermediate buffering */
-    CONFIG_HAS_OR_CREATE(_config, boolean, "poolset_enable", 1, val);
-    /* number of preallocated buffer pools */
-    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_npools", 4, val);
-    /* buffers per buffer pool */
-    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_nbuffers_per_pool", 32, val);
-    /* size of buffers in smallest pool */
-    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_first_buffer_size", 65536,
-                         val);
-    /* factor size increase per pool */
-    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_multiplier", 4, val);
+static void qtn_work_execute(struct qtn_work_dispatch* dispatch,
+                             struct qtn_pool_stats*    stats);
+static void qtn_work_execute_small(struct qtn_work_dispatch* dispatch,
+                                   struct qtn_pool_stats*    stats);
+static void qtn_work_respond_small(struct qtn_work_dispatch* dispatch,
+                                   qtn_work_out_t*           out);
 
-    /* retrieve system page size (this can only be queried, not set by
-     * caller
-     */
-    page_size = sysconf(_SC_PAGESIZE);
-    CONFIG_OVERRIDE_INTEGER(_config, "page_size", (int)page_size, 1);
+/* records the length of a queue as a request joins it */
+static void qtn_queue_sample(struct qtn_pool_stats* stats, uint64_t size)
+{
+    uint64_t max;
 
-    return (0);
+    __atomic_fetch_add(&stats->size_samples, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->size_sum, size, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&stats->size_max, __ATOMIC_RELAXED);
+    while (size > max
+           && !__atomic_compare_exchange_n(&stats->size_max, &max, size, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
 }
 
-char* quintain_provider_get_config(quintain_provider_t provider)
+/* samples the number of ULTs waiting in a pool as a request arrives */
+static void qtn_pool_sample(ABT_pool pool, struct qtn_pool_stats* stats)
 {
-    struct rusage usage;
-    int           ret;
+    size_t size;
 
-    /* update maxrss on demand */
-    ret = getrusage(RUSAGE_SELF, &usage);
-    if (ret != 0) {
-        /* if we can't get the current rusage, then delete it from json if
-         * present so that we don't report an incorrect value.
-         */
-        json_object_object_del(provider->json_cfg, "ru_maxrss");
-    } else {
-        CONFIG_OVERRIDE_INTEGER(provider->json_cfg, "ru_maxrss",
-                                usage.ru_maxrss, 0);
+    if (ABT_pool_get_size(pool, &size) == ABT_SUCCESS)
+        qtn_queue_sample(stats, size);
+}
+
+static void qtn_work_dispatch_ult(void* arg)
+{
+    struct qtn_work_dispatch* dispatch = arg;
+    struct qtn_pool_stats*    stats
+        = &dispatch->provider->pool_stats[QTN_POOL_BULK];
+
+    /* account for time spent waiting in the bulk pool */
+    __atomic_fetch_add(
+        &stats->queue_ns,
+        (uint64_t)((ABT_get_wtime() - dispatch->dispatch_ts) * 1e9),
+        __ATOMIC_RELAXED);
+    qtn_work_execute(dispatch, stats);
+}
+
+/* Admission control: admits a request if fewer than max_inflight requests
+ * are executing, otherwise waits for a slot if fewer than max_queued
+ * requests are already waiting, otherwise rejects it with QTN_ERR_BUSY.
+ * On success *admitted is set if the request holds a slot that must be
+ * returned with qtn_admit_release().
+ */
+static int qtn_admit(quintain_provider_t provider, int* admitted)
+{
+    uint64_t max_inflight;
+    int      ret = QTN_SUCCESS;
+
+    *admitted = 0;
+    if (!__atomic_load_n(&provider->max_inflight, __ATOMIC_RELAXED))
+        return QTN_SUCCESS;
+
+    ABT_mutex_lock(provider->admit_mutex);
+    max_inflight = provider->max_inflight;
+    if (max_inflight && provider->inflight >= max_inflight) {
+        if (provider->waiting >= provider->max_queued) {
+            ret = QTN_ERR_BUSY;
+            goto finish;
+        }
+        provider->waiting++;
+        provider->queued_requests++;
+        /* limits may change while we wait */
+        while (provider->max_inflight
+               && provider->inflight >= provider->max_inflight)
+            ABT_cond_wait(provider->admit_cond, provider->admit_mutex);
+        provider->waiting--;
     }
+    provider->inflight++;
+    *admitted = 1;
 
-    const char* content = json_object_to_json_string_ext(
-        provider->json_cfg,
-        JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_NOSLASHESCAPE);
-    return strdup(content);
+finish:
+    if (ret == QTN_ERR_BUSY) provider->rejected_requests++;
+    ABT_mutex_unlock(provider->admit_mutex);
+    return ret;
 }
 
-static int setup_poolset(quintain_provider_t provider)
+static void qtn_admit_release(quintain_provider_t provider)
 {
-    hg_return_t hret;
+    ABT_mutex_lock(provider->admit_mutex);
+    provider->inflight--;
+    ABT_cond_signal(provider->admit_cond);
+    ABT_mutex_unlock(provider->admit_mutex);
+}
 
-    /* NOTE: this is called after validate, so we don't need extensive error
-     * checking on the json here
-     */
+/* Runs an admitted request whose input has been decoded, handing large
+ * requests off to the bulk pool (if there is one) so that small requests
+ * do not queue behind them.  Either way it returns only once the response
+ * has been sent, so that margo keeps accounting for the calling handler
+ * (e.g. in margo_finalize()) until the request is complete; the caller
+ * just blocks, leaving its xstream free for other handlers meanwhile.
+ */
+static void qtn_work_route(struct qtn_work_dispatch* dispatch)
+{
+    quintain_provider_t provider = dispatch->provider;
+    ABT_thread          thread;
+    int                 ret;
 
-    /* create poolset if we don't have one yet */
-    if (provider->poolset == NULL
-        && json_object_get_boolean(
-            json_object_object_get(provider->json_cfg, "poolset_enable"))) {
-        hret = margo_bulk_poolset_create(
-            provider->mid,
-            json_object_get_int(
-                json_object_object_get(provider->json_cfg, "poolset_npools")),
-            json_object_get_int(json_object_object_get(
-                provider->json_cfg, "poolset_nbuffers_per_pool")),
-            json_object_get_int(json_object_object_get(
-                provider->json_cfg, "poolset_first_buffer_size")),
-            json_object_get_int(json_object_object_get(provider->json_cfg,
-                                                       "poolset_multiplier")),
-            HG_BULK_READWRITE, &(provider->poolset));
-        if (hret != 0) return QTN_ERR_MERCURY;
-    }
-
-    /* destroy poolset if we have one but it has been disabled */
-    if (provider->poolset
-        && !json_object_get_boolean(
-            json_object_object_get(provider->json_cfg, "poolset_enable"))) {
-        hret = margo_bulk_poolset_destroy(provider->poolset);
-        if (hret != 0) return QTN_ERR_MERCURY;
-    }
-
-    /* otherwise nothing to do here */
-    return QTN_SUCCESS;
+    if (provider->bulk_pool != ABT_POOL_NULL
+        && qtn_work_is_bulk(provider, &dispatch->in)) {
+        dispatch->dispatch_ts = ABT_get_wtime();
+        qtn_pool_sample(provider->bulk_pool,
+                        &provider->pool_stats[QTN_POOL_BULK]);
+        ret = ABT_thread_create(provider->bulk_pool, qtn_work_dispatch_ult,
+                                dispatch, ABT_THREAD_ATTR_NULL, &thread);
+        if (ret == ABT_SUCCESS) {
+            ABT_thread_free(&thread);
+            return;
+        }
+        QTN_WARNING(provider->mid,
+                    "ABT_thread_create: %d; running request in place", ret);
+    }
+
+    qtn_work_execute(dispatch, &provider->pool_stats[QTN_POOL_DEFAULT]);
 }
 
-static void qtn_stat_ult(hg_handle_t handle)
+static void qtn_work_ult(hg_handle_t handle)
 {
-    margo_instance_id     mid      = MARGO_INSTANCE_NULL;
-    qtn_stat_out_t        out      = {0};
-    const struct hg_info* info     = NULL;
-    quintain_provider_t   provider = NULL;
-    struct rusage         usage;
-    int                   ret;
+    margo_instance_id         mid      = MARGO_INSTANCE_NULL;
+    qtn_work_out_t            out      = {0};
+    const struct hg_info*     info     = NULL;
+    quintain_provider_t       provider = NULL;
+    struct qtn_work_dispatch* dispatch = NULL;
+    int                       admitted = 0;
+    hg_return_t               hret;
 
-    memset(&out, 0, sizeof(out));
+#ifdef HAVE_HPCTOOLKIT
+    if (!hpctoolkit_started) {
+        hpctoolkit_sampling_start();
+        hpctoolkit_started = 1;
+    }
+#endif
 
     mid = margo_hg_handle_get_instance(handle);
     assert(mid);
@@ -388,25 +821,1424 @@ static void qtn_stat_ult(hg_handle_t handle)
     if (!provider) {
         out.ret = QTN_ERR_UNKNOWN_PROVIDER;
         QTN_ERROR(mid, "Unkown provider");
-        goto finish;
+        goto error;
     }
 
-    /* no input */
+    qtn_pool_sample(provider->handler_pool,
+                    &provider->pool_stats[QTN_POOL_DEFAULT]);
 
-    ret = getrusage(RUSAGE_SELF, &usage);
-    if (ret != 0) {
-        out.ret = QTN_ERR_STATISTICS;
-        QTN_ERROR(mid, "getrusage failure");
-        goto finish;
-    } else {
-        out.utime_sec  = usage.ru_utime.tv_sec;
-        out.utime_usec = usage.ru_utime.tv_usec;
-        out.stime_sec  = usage.ru_stime.tv_sec;
-        out.stime_usec = usage.ru_stime.tv_usec;
+    /* decide whether to accept the request before doing any work on it */
+    out.ret = qtn_admit(provider, &admitted);
+    if (out.ret != QTN_SUCCESS) goto error;
+
+    dispatch = calloc(1, sizeof(*dispatch));
+    if (!dispatch) {
+        out.ret = QTN_ERR_ALLOCATION;
+        goto error;
     }
+    dispatch->handle   = handle;
+    dispatch->provider = provider;
+    dispatch->admitted = admitted;
 
-finish:
+    hret = margo_get_input(handle, &dispatch->in);
+    if (hret != HG_SUCCESS) {
+        out.ret = QTN_ERR_MERCURY;
+        QTN_ERROR(mid, "margo_get_input: %s", HG_Error_to_string(hret));
+        goto error;
+    }
+
+    qtn_work_route(dispatch);
+    return;
+
+error:
     margo_respond(handle, &out);
     margo_destroy(handle);
+    free(dispatch);
+    if (admitted) qtn_admit_release(provider);
 }
-DEFINE_MARGO_RPC_HANDLER(qtn_stat_ult)
+DEFINE_MARGO_RPC_HANDLER(qtn_work_ult)
+
+/* returns true if a request is cheap enough for the fast path: no bulk
+ * data or compression, small buffers, and no admission control (which
+ * might have to wait for a slot) or fault injection
+ */
+static int qtn_work_is_fast(quintain_provider_t  provider,
+                            const qtn_work_in_t* in)
+{
+    if (in->bulk_size
+        || (in->flags
+            & (QTN_WORK_COMPRESS | QTN_WORK_DECOMPRESS | QTN_WORK_BULK_CLASS)))
+        return 0;
+    if (__atomic_load_n(&provider->max_inflight, __ATOMIC_RELAXED)) return 0;
+    /* injected faults may have to sleep */
+    if (in->fault_delay_usec
+        || (in->flags & (QTN_WORK_FAULT_ERROR | QTN_WORK_FAULT_DROP))
+        || qtn_fault_enabled(&provider->fault))
+        return 0;
+    return in->req_buffer_size + in->resp_buffer_size
+        <= provider->fast_max_size;
+}
+
+/* Frees a dispatch structure once its request has been answered; nothing
+ * may touch the provider afterwards.  margo only waits for the handlers
+ * that it created itself before finalizing, so the provider counts the
+ * requests that qtn_work_fast_cb() hands off and qtn_fast_path_drain()
+ * waits for them.
+ */
+static void qtn_work_dispatch_free(struct qtn_work_dispatch* dispatch)
+{
+    quintain_provider_t provider = dispatch->provider;
+    int                 pending  = dispatch->fast_pending;
+
+    free(dispatch);
+    if (!pending) return;
+    ABT_mutex_lock(provider->fast_mutex);
+    if (--provider->fast_pending == 0) ABT_cond_broadcast(provider->fast_idle);
+    ABT_mutex_unlock(provider->fast_mutex);
+}
+
+/* the regular handler for a request that arrived on the fast path but is
+ * not eligible for it; the input has already been decoded
+ */
+static void qtn_work_slow_ult(void* arg)
+{
+    struct qtn_work_dispatch* dispatch = arg;
+    quintain_provider_t       provider = dispatch->provider;
+    qtn_work_out_t            out      = {0};
+
+    out.ret = qtn_admit(provider, &dispatch->admitted);
+    if (out.ret != QTN_SUCCESS) {
+        margo_respond(dispatch->handle, &out);
+        margo_free_input(dispatch->handle, &dispatch->in);
+        margo_destroy(dispatch->handle);
+        qtn_work_dispatch_free(dispatch);
+        return;
+    }
+    qtn_work_route(dispatch);
+}
+
+/* waits for the response to a fast path request to be sent, then releases
+ * the request
+ */
+static void qtn_work_complete_small(struct qtn_work_dispatch* dispatch)
+{
+    hg_return_t hret;
+
+    if (dispatch->req != MARGO_REQUEST_NULL) {
+        hret = margo_wait(dispatch->req);
+        if (hret != HG_SUCCESS)
+            QTN_ERROR(dispatch->provider->mid, "margo_wait: %s",
+                      HG_Error_to_string(hret));
+    }
+    margo_destroy(dispatch->handle);
+    qtn_work_dispatch_free(dispatch);
+}
+
+/* Queues a request to the fast path workers, either to be carried out or,
+ * if it has been answered already, for its response to be completed.  Does
+ * not block, so that it may be called from the Mercury callback.
+ */
+static void qtn_fast_path_enqueue(quintain_provider_t       provider,
+                                  struct qtn_work_dispatch* dispatch)
+{
+    ABT_mutex_lock(provider->fast_mutex);
+    if (!dispatch->responded)
+        qtn_queue_sample(&provider->pool_stats[QTN_POOL_FAST],
+                         provider->fast_queued++);
+    if (!dispatch->fast_pending) {
+        provider->fast_pending++;
+        dispatch->fast_pending = 1;
+    }
+    if (provider->fast_tail)
+        provider->fast_tail->next = dispatch;
+    else
+        provider->fast_head = dispatch;
+    provider->fast_tail = dispatch;
+    ABT_cond_signal(provider->fast_cond);
+    ABT_mutex_unlock(provider->fast_mutex);
+}
+
+/* pre-spawned fast path worker: answers queued requests and completes their
+ * responses until stopped
+ */
+static void qtn_fast_worker_ult(void* arg)
+{
+    quintain_provider_t       provider = arg;
+    struct qtn_pool_stats*    stats    = &provider->pool_stats[QTN_POOL_FAST];
+    struct qtn_work_dispatch* dispatch;
+
+    for (;;) {
+        ABT_mutex_lock(provider->fast_mutex);
+        while (!provider->fast_head && !provider->fast_stop)
+            ABT_cond_wait(provider->fast_cond, provider->fast_mutex);
+        dispatch = provider->fast_head;
+        if (dispatch) {
+            provider->fast_head = dispatch->next;
+            if (!provider->fast_head) provider->fast_tail = NULL;
+            if (!dispatch->responded) provider->fast_queued--;
+        }
+        ABT_mutex_unlock(provider->fast_mutex);
+        if (!dispatch) break;
+
+        if (!dispatch->responded) {
+            __atomic_fetch_add(
+                &stats->queue_ns,
+                (uint64_t)((ABT_get_wtime() - dispatch->dispatch_ts) * 1e9),
+                __ATOMIC_RELAXED);
+            qtn_work_execute_small(dispatch, stats);
+        }
+        qtn_work_complete_small(dispatch);
+    }
+}
+
+/* starts n fast path workers on the handler pool */
+static int qtn_fast_path_start(quintain_provider_t provider, int n)
+{
+    int ret;
+
+    if (n < 1) n = 1;
+    provider->fast_workers = calloc(n, sizeof(*provider->fast_workers));
+    if (!provider->fast_workers) return QTN_ERR_ALLOCATION;
+    for (; provider->fast_nworkers < n; provider->fast_nworkers++) {
+        ret = ABT_thread_create(
+            provider->handler_pool, qtn_fast_worker_ult, provider,
+            ABT_THREAD_ATTR_NULL,
+            &provider->fast_workers[provider->fast_nworkers]);
+        if (ret != ABT_SUCCESS) {
+            QTN_ERROR(provider->mid, "ABT_thread_create: %d", ret);
+            return QTN_ERR_ALLOCATION;
+        }
+    }
+    return QTN_SUCCESS;
+}
+
+/* stops the fast path workers (if any) once their queue has drained */
+static void qtn_fast_path_stop(quintain_provider_t provider)
+{
+    int i;
+
+    if (provider->fast_nworkers) {
+        ABT_mutex_lock(provider->fast_mutex);
+        provider->fast_stop = 1;
+        ABT_cond_broadcast(provider->fast_cond);
+        ABT_mutex_unlock(provider->fast_mutex);
+        for (i = 0; i < provider->fast_nworkers; i++)
+            ABT_thread_free(&provider->fast_workers[i]);
+        provider->fast_nworkers = 0;
+    }
+    free(provider->fast_workers);
+    provider->fast_workers = NULL;
+}
+
+/* waits for the requests handed off by qtn_work_fast_cb() to be answered */
+static void qtn_fast_path_drain(quintain_provider_t provider)
+{
+    ABT_mutex_lock(provider->fast_mutex);
+    while (provider->fast_pending)
+        ABT_cond_wait(provider->fast_idle, provider->fast_mutex);
+    ABT_mutex_unlock(provider->fast_mutex);
+}
+
+/* Mercury callback for work requests when the provider has a fast path.
+ * This runs in the progress loop rather than in a ULT of its own, so it
+ * must not block.  Eligible requests are answered here ("inline") or
+ * queued to the fast path workers ("worker"); anything else gets a
+ * handler ULT as usual.  Responses sent from here are completed by the
+ * fast path workers.
+ */
+static hg_return_t qtn_work_fast_cb(hg_handle_t handle)
+{
+    margo_instance_id         mid      = margo_hg_handle_get_instance(handle);
+    const struct hg_info*     info     = margo_get_info(handle);
+    quintain_provider_t       provider = margo_registered_data(mid, info->id);
+    struct qtn_work_dispatch* dispatch = NULL;
+    qtn_work_out_t            out      = {0};
+    hg_return_t               hret;
+    int                       ret;
+
+    if (!provider) {
+        QTN_ERROR(mid, "Unkown provider");
+        goto drop;
+    }
+
+    dispatch = calloc(1, sizeof(*dispatch));
+    if (!dispatch) goto drop;
+    dispatch->handle   = handle;
+    dispatch->provider = provider;
+
+    hret = margo_get_input(handle, &dispatch->in);
+    if (hret != HG_SUCCESS) {
+        out.ret = QTN_ERR_MERCURY;
+        QTN_ERROR(mid, "margo_get_input: %s", HG_Error_to_string(hret));
+        goto error;
+    }
+
+    if (!qtn_work_is_fast(provider, &dispatch->in)) {
+        qtn_pool_sample(provider->handler_pool,
+                        &provider->pool_stats[QTN_POOL_DEFAULT]);
+        ABT_mutex_lock(provider->fast_mutex);
+        provider->fast_pending++;
+        ABT_mutex_unlock(provider->fast_mutex);
+        dispatch->fast_pending = 1;
+        ret = ABT_thread_create(provider->handler_pool, qtn_work_slow_ult,
+                                dispatch, ABT_THREAD_ATTR_NULL, NULL);
+        if (ret == ABT_SUCCESS) return HG_SUCCESS;
+        QTN_ERROR(mid, "ABT_thread_create: %d", ret);
+        margo_free_input(handle, &dispatch->in);
+        out.ret = QTN_ERR_ALLOCATION;
+        goto error;
+    }
+
+    if (provider->fast_path == QTN_FAST_PATH_WORKER) {
+        dispatch->dispatch_ts = ABT_get_wtime();
+        qtn_fast_path_enqueue(provider, dispatch);
+        return HG_SUCCESS;
+    }
+
+    qtn_work_execute_small(dispatch, &provider->pool_stats[QTN_POOL_FAST]);
+    qtn_fast_path_enqueue(provider, dispatch);
+    return HG_SUCCESS;
+
+error:
+    qtn_work_respond_small(dispatch, &out);
+    qtn_fast_path_enqueue(provider, dispatch);
+    return HG_SUCCESS;
+
+drop:
+    /* without a dispatch structure nothing could complete a response, so
+     * the request is dropped
+     */
+    margo_destroy(handle);
+    return HG_SUCCESS;
+}
+
+/* Carries out the bulk transfer (if any) for one operation of a batch.  The
+ * operation's data is at op->bulk_offset within the client's bulk handle.
+ */
+static int qtn_work_batch_op(quintain_provider_t  provider,
+                             hg_addr_t            addr,
+                             hg_bulk_t            remote_handle,
+                             const qtn_work_op_t* op)
+{
+    margo_instance_id       mid         = provider->mid;
+    struct qtn_poolset_ref* poolset     = NULL;
+    void*                   buffer      = NULL;
+    hg_bulk_t               bulk_handle = HG_BULK_NULL;
+    hg_size_t               size        = op->bulk_size;
+    int                     bulk_flag   = HG_BULK_WRITE_ONLY;
+    int                     ret         = QTN_SUCCESS;
+    hg_return_t             hret;
+
+    if (op->flags & ~QTN_WORK_USE_SERVER_POOLSET) return QTN_ERR_INVALID_ARG;
+    if (!size) return QTN_SUCCESS;
+    if (remote_handle == HG_BULK_NULL) return QTN_ERR_INVALID_ARG;
+
+    if (op->bulk_op == HG_BULK_PUSH) bulk_flag = HG_BULK_READ_ONLY;
+    if (op->flags & QTN_WORK_USE_SERVER_POOLSET) {
+        poolset = qtn_poolset_acquire(provider);
+        if (!poolset) return QTN_ERR_INVALID_ARG;
+        hret = margo_bulk_poolset_get(poolset->poolset, size, &bulk_handle);
+        if (hret != HG_SUCCESS) {
+            QTN_ERROR(mid, "margo_bulk_poolset_get: %s",
+                      HG_Error_to_string(hret));
+            ret = QTN_ERR_ALLOCATION;
+            goto finish;
+        }
+    } else {
+        buffer = malloc(size);
+        if (!buffer) {
+            ret = QTN_ERR_ALLOCATION;
+            goto finish;
+        }
+        hret = margo_bulk_create(mid, 1, &buffer, &size, bulk_flag,
+                                 &bulk_handle);
+        if (hret != HG_SUCCESS) {
+            QTN_ERROR(mid, "margo_bulk_create: %s", HG_Error_to_string(hret));
+            ret = QTN_ERR_MERCURY;
+            goto finish;
+        }
+    }
+
+    hret = margo_bulk_transfer(mid, op->bulk_op, addr, remote_handle,
+                               op->bulk_offset, bulk_handle, 0, size);
+    if (hret != HG_SUCCESS) {
+        QTN_ERROR(mid, "margo_bulk_transfer: %s", HG_Error_to_string(hret));
+        ret = QTN_ERR_MERCURY;
+    }
+
+finish:
+    if (bulk_handle != HG_BULK_NULL) {
+        if (poolset)
+            margo_bulk_poolset_release(poolset->poolset, bulk_handle);
+        else
+            margo_bulk_free(bulk_handle);
+    }
+    if (poolset) qtn_poolset_release(poolset);
+    free(buffer);
+    return ret;
+}
+
+/* arguments for running one operation of a batch in its own ULT */
+struct qtn_batch_op_arg {
+    quintain_provider_t  provider;
+    hg_addr_t            addr;
+    hg_bulk_t            remote_handle;
+    const qtn_work_op_t* op;
+    int32_t*             ret;
+};
+
+static void qtn_work_batch_op_ult(void* arg)
+{
+    struct qtn_batch_op_arg* a = arg;
+
+    *a->ret = qtn_work_batch_op(a->provider, a->addr, a->remote_handle, a->op);
+}
+
+static void qtn_work_batch_ult(hg_handle_t handle)
+{
+    margo_instance_id        mid       = MARGO_INSTANCE_NULL;
+    qtn_work_batch_in_t      in;
+    qtn_work_batch_out_t     out;
+    const struct hg_info*    info      = NULL;
+    quintain_provider_t      provider  = NULL;
+    struct qtn_batch_op_arg* args      = NULL;
+    ABT_thread*              threads   = NULL;
+    struct qtn_pool_stats*   stats;
+    double                   start_ts  = ABT_get_wtime();
+    int                      admitted  = 0;
+    int                      got_input = 0;
+    uint64_t                 req_size  = 0;
+    hg_return_t              hret;
+    uint32_t                 i;
+
+    memset(&out, 0, sizeof(out));
+
+    mid = margo_hg_handle_get_instance(handle);
+    assert(mid);
+    info     = margo_get_info(handle);
+    provider = margo_registered_data(mid, info->id);
+    if (!provider) {
+        out.ret = QTN_ERR_UNKNOWN_PROVIDER;
+        QTN_ERROR(mid, "Unkown provider");
+        goto finish;
+    }
+
+    /* a batch is admitted (or rejected) as a single request */
+    out.ret = qtn_admit(provider, &admitted);
+    if (out.ret != QTN_SUCCESS) goto finish;
+
+    /* and has faults injected as one; quintain_work_batch() has no timeout,
+     * so a batch that draws a drop is failed rather than left unanswered
+     */
+    if (qtn_fault_inject(&provider->fault, mid, 0, 0) != QTN_FAULT_PASS) {
+        out.ret = QTN_ERR_INJECTED;
+        goto finish;
+    }
+
+    hret = margo_get_input(handle, &in);
+    if (hret != HG_SUCCESS) {
+        out.ret = QTN_ERR_MERCURY;
+        QTN_ERROR(mid, "margo_get_input: %s", HG_Error_to_string(hret));
+        goto finish;
+    }
+    got_input = 1;
+
+    for (i = 0; i < in.count; i++) {
+        req_size += in.ops[i].req_buffer_size;
+        out.resp_size += in.ops[i].resp_buffer_size;
+    }
+    if (req_size != in.req_size) {
+        out.ret = QTN_ERR_INVALID_ARG;
+        QTN_ERROR(mid, "batch request buffer size mismatch");
+        goto finish;
+    }
+
+    out.count = in.count;
+    out.rets  = calloc(in.count, sizeof(*out.rets));
+    if (out.resp_size) out.resp_buffer = calloc(1, out.resp_size);
+    if (!out.rets || (out.resp_size && !out.resp_buffer)) {
+        out.ret       = QTN_ERR_ALLOCATION;
+        out.count     = 0;
+        out.resp_size = 0;
+        goto finish;
+    }
+
+    if (in.flags & QTN_BATCH_CONCURRENT) {
+        /* run each operation in its own ULT and wait for all of them */
+        args    = calloc(in.count, sizeof(*args));
+        threads = calloc(in.count, sizeof(*threads));
+        if (!args || !threads) {
+            out.ret = QTN_ERR_ALLOCATION;
+            goto finish;
+        }
+        for (i = 0; i < in.count; i++) {
+            args[i].provider      = provider;
+            args[i].addr          = info->addr;
+            args[i].remote_handle = in.bulk_handle;
+            args[i].op            = &in.ops[i];
+            args[i].ret           = &out.rets[i];
+            if (ABT_thread_create(provider->handler_pool, qtn_work_batch_op_ult,
+                                  &args[i], ABT_THREAD_ATTR_NULL, &threads[i])
+                != ABT_SUCCESS) {
+                threads[i] = ABT_THREAD_NULL;
+                qtn_work_batch_op_ult(&args[i]);
+            }
+        }
+        for (i = 0; i < in.count; i++)
+            if (threads[i] != ABT_THREAD_NULL) ABT_thread_free(&threads[i]);
+    } else {
+        for (i = 0; i < in.count; i++)
+            out.rets[i] = qtn_work_batch_op(provider, info->addr,
+                                            in.bulk_handle, &in.ops[i]);
+    }
+
+    stats = &provider->pool_stats[QTN_POOL_DEFAULT];
+    __atomic_fetch_add(&stats->requests, in.count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->busy_ns,
+                       (uint64_t)((ABT_get_wtime() - start_ts) * 1e9),
+                       __ATOMIC_RELAXED);
+
+finish:
+    margo_respond(handle, &out);
+    if (got_input) margo_free_input(handle, &in);
+    if (admitted) qtn_admit_release(provider);
+    free(args);
+    free(threads);
+    free(out.rets);
+    free(out.resp_buffer);
+    margo_destroy(handle);
+}
+DEFINE_MARGO_RPC_HANDLER(qtn_work_batch_ult)
+
+/* Checks the request payload and fills in the response buffer of a work
+ * request.  Sets *integrity_error if the request payload failed
+ * verification.
+ */
+static int qtn_work_prepare(quintain_provider_t  provider,
+                            const qtn_work_in_t* in,
+                            qtn_work_out_t*      out,
+                            int*                 integrity_error)
+{
+    int                     verify = in->flags & QTN_WORK_VERIFY_PAYLOAD;
+    int                     ret    = QTN_SUCCESS;
+    struct qtn_perf_section section;
+
+    qtn_perf_begin(&provider->perf, &section);
+    if (verify && in->req_buffer_size
+        && qtn_crc32c(0, in->req_buffer, in->req_buffer_size) != in->req_crc) {
+        QTN_ERROR(provider->mid, "request payload failed verification");
+        *integrity_error = 1;
+    }
+
+    out->resp_buffer_size = in->resp_buffer_size;
+    out->resp_buffer      = NULL;
+    if (in->resp_buffer_size) {
+        out->resp_buffer = calloc(1, in->resp_buffer_size);
+        if (!out->resp_buffer) {
+            out->resp_buffer_size = 0;
+            ret                   = QTN_ERR_ALLOCATION;
+        } else if (verify) {
+            qtn_payload_fill(out->resp_buffer, in->resp_buffer_size,
+                             in->payload_seed ^ QTN_PAYLOAD_SALT_RESP, 0);
+            out->resp_crc
+                = qtn_crc32c(0, out->resp_buffer, in->resp_buffer_size);
+        }
+    }
+    qtn_perf_end(&provider->perf, &section);
+    return ret;
+}
+
+/* Starts the response to a fast path request without waiting for it to be
+ * sent; qtn_work_complete_small() does that.  margo_irespond() encodes the
+ * output before it returns.
+ */
+static void qtn_work_respond_small(struct qtn_work_dispatch* dispatch,
+                                   qtn_work_out_t*           out)
+{
+    hg_return_t hret;
+
+    hret = margo_irespond(dispatch->handle, out, &dispatch->req);
+    if (hret != HG_SUCCESS) {
+        QTN_ERROR(dispatch->provider->mid, "margo_irespond: %s",
+                  HG_Error_to_string(hret));
+        dispatch->req = MARGO_REQUEST_NULL;
+    }
+    dispatch->responded = 1;
+}
+
+/* Carries out a fast path request (see qtn_work_is_fast()) and responds to
+ * it without blocking, so that it may run in the progress loop.  Frees the
+ * decoded input; the response must then be completed with
+ * qtn_work_complete_small().
+ */
+static void qtn_work_execute_small(struct qtn_work_dispatch* dispatch,
+                                   struct qtn_pool_stats*    stats)
+{
+    quintain_provider_t provider        = dispatch->provider;
+    qtn_work_out_t      out             = {0};
+    double              start_ts        = ABT_get_wtime();
+    int                 integrity_error = 0;
+
+    out.ret = qtn_work_prepare(provider, &dispatch->in, &out, &integrity_error);
+    if (integrity_error) {
+        __atomic_fetch_add(&provider->integrity_errors, 1, __ATOMIC_RELAXED);
+        if (out.ret == QTN_SUCCESS) out.ret = QTN_ERR_INTEGRITY;
+    }
+
+    qtn_work_respond_small(dispatch, &out);
+    margo_free_input(dispatch->handle, &dispatch->in);
+    if (out.resp_buffer) free(out.resp_buffer);
+
+    __atomic_fetch_add(&stats->requests, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->busy_ns,
+                       (uint64_t)((ABT_get_wtime() - start_ts) * 1e9),
+                       __ATOMIC_RELAXED);
+}
+
+/* Carries out a work request and responds to it.  Takes ownership of the
+ * dispatch structure, its decoded input, and the RPC handle.
+ */
+static void qtn_work_execute(struct qtn_work_dispatch* dispatch,
+                             struct qtn_pool_stats*    stats)
+{
+    hg_handle_t             handle   = dispatch->handle;
+    quintain_provider_t     provider = dispatch->provider;
+    margo_instance_id       mid      = provider->mid;
+    qtn_work_in_t           in       = dispatch->in;
+    qtn_work_out_t          out;
+    const struct hg_info*   info     = NULL;
+    double                  start_ts = ABT_get_wtime();
+    void*                   bulk_buffer  = NULL;
+    int                     bulk_flag    = HG_BULK_WRITE_ONLY;
+    hg_bulk_t               bulk_handle  = HG_BULK_NULL;
+    void**                  seg_buffers  = NULL;
+    uint32_t                nseg_buffers = 0;
+    int                     from_poolset = 0;
+    struct qtn_poolset_ref* poolset      = NULL;
+    hg_size_t               chunk_size;
+    uint32_t                pipeline_depth;
+    int                     verify          = 0;
+    int                     integrity_error = 0;
+    struct qtn_bulk_stage   stage;
+    int                     fault;
+
+    memset(&out, 0, sizeof(out));
+    memset(&stage, 0, sizeof(stage));
+
+    info = margo_get_info(handle);
+
+    /* injected faults come first, as though the provider had been slow to
+     * get to the request
+     */
+    fault = qtn_fault_inject(&provider->fault, mid, in.fault_delay_usec,
+                             in.flags);
+    if (fault == QTN_FAULT_ERROR) {
+        out.ret = QTN_ERR_INJECTED;
+        goto finish;
+    }
+    if (fault == QTN_FAULT_DROP) goto finish;
+
+    verify  = (in.flags & QTN_WORK_VERIFY_PAYLOAD) != 0;
+    out.ret = qtn_work_prepare(provider, &in, &out, &integrity_error);
+    if (out.ret != QTN_SUCCESS) goto finish;
+
+    out.ret = qtn_bulk_stage_init(
+        &stage, &in,
+        __atomic_load_n(&provider->compression_level, __ATOMIC_RELAXED),
+        &provider->perf);
+    if (out.ret != QTN_SUCCESS) {
+        QTN_ERROR(mid, "invalid bulk processing options");
+        goto finish;
+    }
+
+    /* per-request chunking parameters override the provider defaults */
+    chunk_size = in.chunk_size ? in.chunk_size
+                               : __atomic_load_n(&provider->bulk_chunk_size,
+                                                 __ATOMIC_RELAXED);
+    pipeline_depth = in.pipeline_depth
+                       ? in.pipeline_depth
+                       : __atomic_load_n(&provider->bulk_pipeline_depth,
+                                         __ATOMIC_RELAXED);
+
+    if (in.bulk_size && chunk_size && in.bulk_size > chunk_size) {
+        /* we were asked to perform a bulk transfer that is large enough to
+         * split into a pipeline of smaller transfers.  Chunks are staged
+         * through their own buffers, so a multi-segment layout for the
+         * provider's buffer cannot be honored.
+         */
+        if (in.server_segments > 1) {
+            QTN_ERROR(mid,
+                      "server_segments (%u) cannot be combined with chunked "
+                      "transfers (chunk size %llu)",
+                      in.server_segments, (long long unsigned)chunk_size);
+            out.ret = QTN_ERR_INVALID_ARG;
+            goto finish;
+        }
+        out.ret = qtn_bulk_transfer_pipelined(
+            provider, &in, info->addr, chunk_size, pipeline_depth, &stage);
+    } else if (in.bulk_size) {
+        /* we were asked to perform a bulk transfer */
+        if (in.bulk_op == HG_BULK_PUSH) bulk_flag = HG_BULK_READ_ONLY;
+        if (in.server_segments > 1) {
+            /* allocate separate buffers and register them together as one
+             * multi-segment bulk handle; this always bypasses the poolset
+             */
+            out.ret = qtn_segmented_bulk_create(
+                mid, in.bulk_size, in.server_segments, bulk_flag, &seg_buffers,
+                &nseg_buffers, &bulk_handle);
+            if (out.ret != HG_SUCCESS) {
+                QTN_ERROR(mid, "margo_bulk_create: %s",
+                          HG_Error_to_string(out.ret));
+                goto finish;
+            }
+        } else if (in.flags & QTN_WORK_USE_SERVER_POOLSET) {
+            /* get buffer from poolset */
+            poolset = qtn_poolset_acquire(provider);
+            if (!poolset) {
+                out.ret = QTN_ERR_INVALID_ARG;
+                QTN_ERROR(mid, "poolset requested but not enabled in provider");
+                goto finish;
+            }
+            out.ret = margo_bulk_poolset_get(poolset->poolset, in.bulk_size,
+                                             &bulk_handle);
+            if (out.ret != 0) {
+                QTN_ERROR(mid, "margo_bulk_poolset_get: %s",
+                          HG_Error_to_string(out.ret));
+                out.ret = QTN_ERR_ALLOCATION;
+                goto finish;
+            }
+            from_poolset = 1;
+        } else {
+            /* allocate buffer and register */
+            bulk_buffer = malloc(in.bulk_size);
+            if (!bulk_buffer) {
+                out.ret = QTN_ERR_ALLOCATION;
+                goto finish;
+            }
+            out.ret = margo_bulk_create(mid, 1, (void**)(&bulk_buffer),
+                                        &in.bulk_size, bulk_flag, &bulk_handle);
+            if (out.ret != HG_SUCCESS) {
+                QTN_ERROR(mid, "margo_bulk_create: %s",
+                          HG_Error_to_string(out.ret));
+                goto finish;
+            }
+        }
+
+        /* generate outgoing data if needed */
+        if (in.bulk_op == HG_BULK_PUSH)
+            qtn_bulk_stage_apply(&stage, bulk_handle, in.bulk_size, 0, 1);
+
+        /* transfer */
+        out.ret
+            = margo_bulk_transfer(mid, in.bulk_op, info->addr, in.bulk_handle,
+                                  0, bulk_handle, 0, in.bulk_size);
+
+        /* process incoming data if needed */
+        if (in.bulk_op == HG_BULK_PULL && out.ret == HG_SUCCESS)
+            qtn_bulk_stage_apply(&stage, bulk_handle, in.bulk_size, 0, 0);
+    }
+    if (out.ret != HG_SUCCESS) {
+        QTN_ERROR(mid, "margo_bulk_transfer: %s", HG_Error_to_string(out.ret));
+    } else if (in.bulk_size) {
+        if (verify) {
+            if (in.bulk_op == HG_BULK_PULL && stage.crc != in.bulk_crc) {
+                QTN_ERROR(mid, "bulk payload failed verification");
+                integrity_error = 1;
+            }
+            out.bulk_crc = stage.crc;
+        }
+        out.ret = qtn_bulk_stage_finish(&stage, provider, &in);
+    }
+
+    if (integrity_error) {
+        __atomic_fetch_add(&provider->integrity_errors, 1, __ATOMIC_RELAXED);
+        if (out.ret == QTN_SUCCESS) out.ret = QTN_ERR_INTEGRITY;
+    }
+
+finish:
+    if (fault != QTN_FAULT_DROP) margo_respond(handle, &out);
+    margo_free_input(handle, &in);
+    qtn_bulk_stage_destroy(&stage);
+    if (bulk_handle != HG_BULK_NULL) {
+        if (from_poolset)
+            margo_bulk_poolset_release(poolset->poolset, bulk_handle);
+        else
+            margo_bulk_free(bulk_handle);
+    }
+    if (poolset) qtn_poolset_release(poolset);
+    if (bulk_buffer != NULL) free(bulk_buffer);
+    if (seg_buffers != NULL) {
+        for (uint32_t i = 0; i < nseg_buffers; i++) free(seg_buffers[i]);
+        free(seg_buffers);
+    }
+    if (out.resp_buffer) free(out.resp_buffer);
+    margo_destroy(handle);
+    if (dispatch->admitted) qtn_admit_release(provider);
+
+    __atomic_fetch_add(&stats->requests, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->busy_ns,
+                       (uint64_t)((ABT_get_wtime() - start_ts) * 1e9),
+                       __ATOMIC_RELAXED);
+    qtn_work_dispatch_free(dispatch);
+}
+
+/* Allocates nsegments separate buffers totaling size bytes and registers
+ * them as a single multi-segment bulk handle.  On success the caller is
+ * responsible for freeing each of the *nbuffers entries in *buffers as well
+ * as the array itself.
+ */
+static hg_return_t qtn_segmented_bulk_create(margo_instance_id mid,
+                                             hg_size_t         size,
+                                             uint32_t          nsegments,
+                                             uint8_t           bulk_flag,
+                                             void***           buffers,
+                                             uint32_t*         nbuffers,
+                                             hg_bulk_t*        handle)
+{
+    void**      ptrs  = NULL;
+    hg_size_t*  sizes = NULL;
+    hg_return_t hret  = HG_NOMEM;
+    uint32_t    i;
+
+    if (nsegments > size) nsegments = size;
+
+    ptrs  = calloc(nsegments, sizeof(*ptrs));
+    sizes = calloc(nsegments, sizeof(*sizes));
+    if (!ptrs || !sizes) goto error;
+
+    for (i = 0; i < nsegments; i++) {
+        sizes[i] = size / nsegments;
+        /* last segment picks up any remainder */
+        if (i == nsegments - 1) sizes[i] += size % nsegments;
+        ptrs[i] = malloc(sizes[i]);
+        if (!ptrs[i]) goto error;
+    }
+
+    hret = margo_bulk_create(mid, nsegments, ptrs, sizes, bulk_flag, handle);
+    if (hret != HG_SUCCESS) goto error;
+
+    free(sizes);
+    *buffers  = ptrs;
+    *nbuffers = nsegments;
+    return HG_SUCCESS;
+
+error:
+    if (ptrs) {
+        for (i = 0; i < nsegments; i++) free(ptrs[i]);
+        free(ptrs);
+    }
+    free(sizes);
+    return hret;
+}
+
+/* state for one stage of a pipelined bulk transfer */
+struct qtn_chunk_slot {
+    void*         buffer;      /* locally allocated buffer (if not poolset) */
+    hg_bulk_t     bulk_handle; /* local bulk handle for this chunk */
+    margo_request req;         /* in-flight transfer, if any */
+    hg_size_t     size;        /* size of the in-flight transfer */
+};
+
+/* Performs the bulk transfer described by the request as a sequence of
+ * chunk_size transfers with up to pipeline_depth of them in flight at once.
+ * Each in-flight chunk is staged through its own small intermediate buffer
+ * (drawn from the poolset if requested) so that server memory consumption is
+ * bounded by chunk_size * pipeline_depth rather than by the request size.
+ *
+ * Each chunk is passed through the request's bulk processing stage in
+ * payload order as it is sent or received.
+ */
+static hg_return_t
+qtn_bulk_transfer_pipelined(quintain_provider_t    provider,
+                            const qtn_work_in_t*   in,
+                            hg_addr_t              addr,
+                            hg_size_t              chunk_size,
+                            uint32_t               pipeline_depth,
+                            struct qtn_bulk_stage* stage)
+{
+    struct qtn_chunk_slot*  slots     = NULL;
+    struct qtn_poolset_ref* poolset   = NULL;
+    margo_instance_id       mid       = provider->mid;
+    int                     bulk_flag = HG_BULK_WRITE_ONLY;
+    int         use_poolset = (in->flags & QTN_WORK_USE_SERVER_POOLSET) != 0;
+    hg_return_t hret        = HG_SUCCESS;
+    hg_return_t wret;
+    hg_size_t   offset = 0;
+    hg_size_t   this_size;
+    hg_size_t   nchunks;
+    uint32_t    nslots;
+    uint32_t    i = 0;
+    uint32_t    n;
+
+    if (pipeline_depth == 0) pipeline_depth = 1;
+    nchunks = (in->bulk_size + chunk_size - 1) / chunk_size;
+    nslots  = (nchunks < pipeline_depth) ? nchunks : pipeline_depth;
+
+    if (use_poolset) {
+        poolset = qtn_poolset_acquire(provider);
+        if (!poolset) {
+            QTN_ERROR(mid, "poolset requested but not enabled in provider");
+            return HG_OTHER_ERROR;
+        }
+    }
+
+    slots = calloc(nslots, sizeof(*slots));
+    if (!slots) {
+        if (poolset) qtn_poolset_release(poolset);
+        return HG_NOMEM;
+    }
+
+    /* set up one intermediate buffer per pipeline slot */
+    if (in->bulk_op == HG_BULK_PUSH) bulk_flag = HG_BULK_READ_ONLY;
+    for (i = 0; i < nslots; i++) {
+        if (use_poolset) {
+            if (margo_bulk_poolset_get(poolset->poolset, chunk_size,
+                                       &slots[i].bulk_handle)
+                != 0) {
+                QTN_ERROR(mid, "margo_bulk_poolset_get: no buffer for %llu "
+                               "byte chunk",
+                          (long long unsigned)chunk_size);
+                hret = HG_NOMEM;
+                goto finish;
+            }
+        } else {
+            slots[i].buffer = malloc(chunk_size);
+            if (!slots[i].buffer) {
+                hret = HG_NOMEM;
+                goto finish;
+            }
+            hret = margo_bulk_create(mid, 1, &slots[i].buffer, &chunk_size,
+                                     bulk_flag, &slots[i].bulk_handle);
+            if (hret != HG_SUCCESS) {
+                QTN_ERROR(mid, "margo_bulk_create: %s",
+                          HG_Error_to_string(hret));
+                goto finish;
+            }
+        }
+    }
+
+    /* issue chunks round robin across slots, waiting for the previous
+     * transfer in a slot to complete before reusing its buffer.  Because
+     * slots are reused in issue order, pulled chunks are also processed in
+     * payload order.
+     */
+    for (i = 0; offset < in->bulk_size; i = (i + 1) % nslots) {
+        if (slots[i].req != MARGO_REQUEST_NULL) {
+            hret         = margo_wait(slots[i].req);
+            slots[i].req = MARGO_REQUEST_NULL;
+            if (hret != HG_SUCCESS) break;
+            if (in->bulk_op == HG_BULK_PULL)
+                qtn_bulk_stage_apply(stage, slots[i].bulk_handle,
+                                     slots[i].size, 0, 0);
+        }
+        this_size = in->bulk_size - offset;
+        if (this_size > chunk_size) this_size = chunk_size;
+        if (in->bulk_op == HG_BULK_PUSH)
+            qtn_bulk_stage_apply(stage, slots[i].bulk_handle, this_size,
+                                 offset, 1);
+        hret = margo_bulk_itransfer(mid, in->bulk_op, addr, in->bulk_handle,
+                                    offset, slots[i].bulk_handle, 0,
+                                    this_size, &slots[i].req);
+        if (hret != HG_SUCCESS) break;
+        slots[i].size = this_size;
+        offset += this_size;
+    }
+
+finish:
+    /* drain any transfers still in flight (oldest first) and release
+     * buffers
+     */
+    for (n = 0; n < nslots; n++, i = (i + 1) % nslots) {
+        if (slots[i].req != MARGO_REQUEST_NULL) {
+            wret = margo_wait(slots[i].req);
+            if (hret == HG_SUCCESS) hret = wret;
+            if (hret == HG_SUCCESS && in->bulk_op == HG_BULK_PULL)
+                qtn_bulk_stage_apply(stage, slots[i].bulk_handle,
+                                     slots[i].size, 0, 0);
+        }
+        if (slots[i].bulk_handle != HG_BULK_NULL) {
+            if (use_poolset)
+                margo_bulk_poolset_release(poolset->poolset,
+                                           slots[i].bulk_handle);
+            else
+                margo_bulk_free(slots[i].bulk_handle);
+        }
+        if (slots[i].buffer) free(slots[i].buffer);
+    }
+    free(slots);
+    if (poolset) qtn_poolset_release(poolset);
+
+    return hret;
+}
+
+static int validate_and_complete_config(struct json_object* _config,
+                                        ABT_pool            _progress_pool)
+{
+    struct json_object* val;
+    long                page_size;
+
+    /* report version number for this component */
+    CONFIG_OVERRIDE_STRING(_config, "version", PACKAGE_VERSION, "version", 1);
+
+    /* populate default poolset settings if not specified already */
+
+    /* poolset yes or no; implies intermediate buffering */
+    CONFIG_HAS_OR_CREATE(_config, boolean, "poolset_enable", 1, val);
+    /* number of preallocated buffer pools */
+    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_npools", 4, val);
+    /* buffers per buffer pool */
+    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_nbuffers_per_pool", 32, val);
+    /* size of buffers in smallest pool */
+    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_first_buffer_size", 65536,
+                         val);
+    /* factor size increase per pool */
+    CONFIG_HAS_OR_CREATE(_config, int64, "poolset_multiplier", 4, val);
+
+    /* default chunk size for pipelined bulk transfers; 0 disables chunking
+     * unless a request asks for it explicitly
+     */
+    CONFIG_HAS_OR_CREATE(_config, int64, "bulk_chunk_size", 0, val);
+    /* default number of chunk transfers in flight at once */
+    CONFIG_HAS_OR_CREATE(_config, int64, "bulk_pipeline_depth", 4, val);
+
+    /* zlib compression level used by QTN_WORK_COMPRESS requests */
+    CONFIG_HAS_OR_CREATE(_config, int64, "compression_level", 1, val);
+
+    /* requests moving at least this many bytes (request, response, and
+     * bulk combined) run on the bulk pool if the provider has one; 0 routes
+     * only requests flagged with QTN_WORK_BULK_CLASS
+     */
+    CONFIG_HAS_OR_CREATE(_config, int64, "bulk_pool_threshold", 65536, val);
+
+    /* admission control: maximum number of work requests executing at once
+     * (0 = unlimited), and how many more may wait for a slot before new
+     * requests are rejected with QTN_ERR_BUSY
+     */
+    CONFIG_HAS_OR_CREATE(_config, int64, "max_inflight", 0, val);
+    CONFIG_HAS_OR_CREATE(_config, int64, "max_queued", 0, val);
+
+    /* powercap sysfs tree to read energy counters from; only read when the
+     * provider is registered
+     */
+    CONFIG_HAS_OR_CREATE(_config, string, "rapl_root", QTN_RAPL_DEFAULT_ROOT,
+                         val);
+
+    /* how small work requests (no bulk data, at most fast_path_max_size
+     * bytes of request and response buffers) are handled: "none" runs each
+     * in a new handler ULT like any other request, "inline" answers them
+     * directly in the Mercury callback, and "worker" queues them to
+     * fast_path_workers ULTs spawned up front.  With "inline", those ULTs
+     * only wait for the responses to be sent.  Only read when the provider
+     * is registered.
+     */
+    CONFIG_HAS_OR_CREATE(_config, string, "fast_path", "none", val);
+    CONFIG_HAS_OR_CREATE(_config, int64, "fast_path_max_size", 4096, val);
+    CONFIG_HAS_OR_CREATE(_config, int64, "fast_path_workers", 1, val);
+
+    /* track CPU, busy, and idle time of the progress xstream and of each
+     * xstream that runs work handlers, optionally with performance
+     * counters; also only read when the provider is registered
+     */
+    CONFIG_HAS_OR_CREATE(_config, boolean, "xstream_stats", 0, val);
+    CONFIG_HAS_OR_CREATE(_config, boolean, "perf_counters", 0, val);
+
+    /* delays, stalls, errors, and dropped responses to inject into work
+     * requests (see quintain-fault.h); none by default
+     */
+    if (qtn_fault_parse(_config, NULL) != 0) return -1;
+
+    /* retrieve system page size (this can only be queried, not set by
+     * caller
+     */
+    page_size = sysconf(_SC_PAGESIZE);
+    CONFIG_OVERRIDE_INTEGER(_config, "page_size", (int)page_size, 1);
+
+    return (0);
+}
+
+char* quintain_provider_get_config(quintain_provider_t provider)
+{
+    struct rusage       usage;
+    int                 ret;
+    char*               content;
+    struct json_object* pool_stats;
+    struct json_object* pool;
+    struct json_object* perf_stats;
+    uint64_t            size_samples;
+    int                 i;
+
+    ABT_mutex_lock(provider->config_mutex);
+
+    /* update maxrss on demand */
+    ret = getrusage(RUSAGE_SELF, &usage);
+    if (ret != 0) {
+        /* if we can't get the current rusage, then delete it from json if
+         * present so that we don't report an incorrect value.
+         */
+        json_object_object_del(provider->json_cfg, "ru_maxrss");
+    } else {
+        CONFIG_OVERRIDE_INTEGER(provider->json_cfg, "ru_maxrss",
+                                usage.ru_maxrss, 0);
+    }
+
+    /* report how many payloads have failed verification so far */
+    CONFIG_OVERRIDE_INTEGER(
+        provider->json_cfg, "integrity_errors",
+        __atomic_load_n(&provider->integrity_errors, __ATOMIC_RELAXED), 0);
+
+    /* report how much data has passed through the compression stage */
+    CONFIG_OVERRIDE_INTEGER(
+        provider->json_cfg, "compression_bytes_in",
+        __atomic_load_n(&provider->compression_bytes_in, __ATOMIC_RELAXED), 0);
+    CONFIG_OVERRIDE_INTEGER(
+        provider->json_cfg, "compression_bytes_out",
+        __atomic_load_n(&provider->compression_bytes_out, __ATOMIC_RELAXED),
+        0);
+
+    /* report admission control activity */
+    ABT_mutex_lock(provider->admit_mutex);
+    CONFIG_OVERRIDE_INTEGER(provider->json_cfg, "queued_requests",
+                            provider->queued_requests, 0);
+    CONFIG_OVERRIDE_INTEGER(provider->json_cfg, "rejected_requests",
+                            provider->rejected_requests, 0);
+    ABT_mutex_unlock(provider->admit_mutex);
+
+    /* report how requests have been distributed across handler pools */
+    pool_stats = json_object_new_object();
+    for (i = 0; i < QTN_POOL_COUNT; i++) {
+        struct qtn_pool_stats* stats = &provider->pool_stats[i];
+
+        if (i == QTN_POOL_BULK && provider->bulk_pool == ABT_POOL_NULL)
+            continue;
+        pool = json_object_new_object();
+        CONFIG_OVERRIDE_INTEGER(
+            pool, "requests",
+            __atomic_load_n(&stats->requests, __ATOMIC_RELAXED), 0);
+        json_object_object_add(
+            pool, "busy_seconds",
+            json_object_new_double(
+                __atomic_load_n(&stats->busy_ns, __ATOMIC_RELAXED) / 1e9));
+        json_object_object_add(
+            pool, "queue_seconds",
+            json_object_new_double(
+                __atomic_load_n(&stats->queue_ns, __ATOMIC_RELAXED) / 1e9));
+        size_samples = __atomic_load_n(&stats->size_samples, __ATOMIC_RELAXED);
+        json_object_object_add(
+            pool, "mean_pool_size",
+            json_object_new_double(
+                size_samples ? (double)__atomic_load_n(&stats->size_sum,
+                                                       __ATOMIC_RELAXED)
+                                   / size_samples
+                             : 0.0));
+        CONFIG_OVERRIDE_INTEGER(
+            pool, "max_pool_size",
+            __atomic_load_n(&stats->size_max, __ATOMIC_RELAXED), 0);
+        json_object_object_add(pool_stats, qtn_pool_names[i], pool);
+    }
+    json_object_object_add(provider->json_cfg, "pool_stats", pool_stats);
+
+    /* report per-xstream time (and counters) split between work handlers
+     * and everything else
+     */
+    perf_stats = qtn_perf_to_json(&provider->perf);
+    if (perf_stats)
+        json_object_object_add(provider->json_cfg, "xstream_stats_report",
+                               perf_stats);
+
+    /* report how many faults have been injected */
+    json_object_object_add(provider->json_cfg, "fault_stats",
+                           qtn_fault_to_json(&provider->fault));
+
+    content = strdup(json_object_to_json_string_ext(
+        provider->json_cfg,
+        JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_NOSLASHESCAPE));
+
+    ABT_mutex_unlock(provider->config_mutex);
+
+    return content;
+}
+
+/* poolset parameters; changing any of these replaces the poolset */
+static const char* const qtn_poolset_keys[]
+    = {"poolset_enable", "poolset_npools", "poolset_nbuffers_per_pool",
+       "poolset_first_buffer_size", "poolset_multiplier", NULL};
+
+int quintain_provider_set_config(quintain_provider_t provider,
+                                 const char*         json_config)
+{
+    struct json_tokener*    tokener;
+    enum json_tokener_error jerr;
+    struct json_object*     update      = NULL;
+    struct json_object*     config      = NULL;
+    struct qtn_poolset_ref* poolset     = NULL;
+    struct qtn_poolset_ref* old_poolset = NULL;
+    int                     poolset_changed = 0;
+    int                     ret             = QTN_SUCCESS;
+    int                     i;
+
+    if (!json_config) return QTN_ERR_INVALID_ARG;
+
+    tokener = json_tokener_new();
+    update  = json_tokener_parse_ex(tokener, json_config, strlen(json_config));
+    if (!update) {
+        jerr = json_tokener_get_error(tokener);
+        QTN_ERROR(provider->mid, "JSON parse error: %s",
+                  json_tokener_error_desc(jerr));
+        json_tokener_free(tokener);
+        return QTN_ERR_INVALID_ARG;
+    }
+    json_tokener_free(tokener);
+    if (!json_object_is_type(update, json_type_object)) {
+        QTN_ERROR(provider->mid, "configuration update must be an object");
+        json_object_put(update);
+        return QTN_ERR_INVALID_ARG;
+    }
+
+    ABT_mutex_lock(provider->reconfig_mutex);
+
+    /* merge the update into a copy of the current configuration */
+    ABT_mutex_lock(provider->config_mutex);
+    ret = json_object_deep_copy(provider->json_cfg, &config, NULL);
+    ABT_mutex_unlock(provider->config_mutex);
+    if (ret != 0) {
+        ret = QTN_ERR_ALLOCATION;
+        goto finish;
+    }
+    json_object_object_foreach(update, key, val)
+    {
+        json_object_object_add(config, key, json_object_get(val));
+    }
+
+    ret = validate_and_complete_config(config, provider->handler_pool);
+    if (ret != 0) {
+        QTN_ERROR(provider->mid,
+                  "could not validate and complete configuration");
+        ret = QTN_ERR_INVALID_ARG;
+        goto finish;
+    }
+
+    /* build a replacement poolset only if its parameters changed */
+    ABT_mutex_lock(provider->config_mutex);
+    for (i = 0; qtn_poolset_keys[i]; i++) {
+        if (!json_object_equal(
+                json_object_object_get(config, qtn_poolset_keys[i]),
+                json_object_object_get(provider->json_cfg,
+                                       qtn_poolset_keys[i])))
+            poolset_changed = 1;
+    }
+    ABT_mutex_unlock(provider->config_mutex);
+    if (poolset_changed) {
+        ret = qtn_poolset_create(provider->mid, config, &poolset);
+        if (ret != QTN_SUCCESS) {
+            QTN_ERROR(provider->mid, "could not create poolset");
+            goto finish;
+        }
+    }
+
+    /* swap in the new configuration.  Requests that are already in
+     * progress keep the settings and poolset that they started with.
+     */
+    ABT_mutex_lock(provider->config_mutex);
+    json_object_put(provider->json_cfg);
+    provider->json_cfg = config;
+    config             = NULL;
+    if (poolset_changed) {
+        old_poolset       = provider->poolset;
+        provider->poolset = poolset;
+    }
+    qtn_apply_workload_config(provider, provider->json_cfg);
+    ABT_mutex_unlock(provider->config_mutex);
+
+    if (old_poolset) qtn_poolset_release(old_poolset);
+
+finish:
+    ABT_mutex_unlock(provider->reconfig_mutex);
+    if (config) json_object_put(config);
+    json_object_put(update);
+    return ret;
+}
+
+/* caches settings that are consulted on every request */
+static void qtn_apply_workload_config(quintain_provider_t provider,
+                                      struct json_object* config)
+{
+    struct qtn_fault_spec fault_spec;
+
+    __atomic_store_n(&provider->bulk_chunk_size,
+                     json_object_get_int64(
+                         json_object_object_get(config, "bulk_chunk_size")),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&provider->bulk_pipeline_depth,
+                     json_object_get_int(
+                         json_object_object_get(config, "bulk_pipeline_depth")),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&provider->compression_level,
+                     json_object_get_int(
+                         json_object_object_get(config, "compression_level")),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&provider->bulk_pool_threshold,
+                     json_object_get_int64(
+                         json_object_object_get(config, "bulk_pool_threshold")),
+                     __ATOMIC_RELAXED);
+
+    /* wake up waiting requests in case the admission limits were raised */
+    ABT_mutex_lock(provider->admit_mutex);
+    provider->max_inflight
+        = json_object_get_int64(json_object_object_get(config, "max_inflight"));
+    provider->max_queued
+        = json_object_get_int64(json_object_object_get(config, "max_queued"));
+    ABT_cond_broadcast(provider->admit_cond);
+    ABT_mutex_unlock(provider->admit_mutex);
+
+    /* already validated, so this cannot fail */
+    if (qtn_fault_parse(config, &fault_spec) == 0)
+        qtn_fault_configure(&provider->fault, &fault_spec);
+}
+
+static int qtn_poolset_create(margo_instance_id        mid,
+                              struct json_object*      config,
+                              struct qtn_poolset_ref** ref)
+{
+    hg_return_t             hret;
+    struct qtn_poolset_ref* tmp;
+
+    /* NOTE: this is called after validate, so we don't need extensive error
+     * checking on the json here
+     */
+
+    *ref = NULL;
+
+    /* nothing to do if the poolset is disabled */
+    if (!json_object_get_boolean(
+            json_object_object_get(config, "poolset_enable")))
+        return QTN_SUCCESS;
+
+    tmp = calloc(1, sizeof(*tmp));
+    if (!tmp) return QTN_ERR_ALLOCATION;
+
+    hret = margo_bulk_poolset_create(
+        mid,
+        json_object_get_int(json_object_object_get(config, "poolset_npools")),
+        json_object_get_int(
+            json_object_object_get(config, "poolset_nbuffers_per_pool")),
+        json_object_get_int(
+            json_object_object_get(config, "poolset_first_buffer_size")),
+        json_object_get_int(
+            json_object_object_get(config, "poolset_multiplier")),
+        HG_BULK_READWRITE, &tmp->poolset);
+    if (hret != 0) {
+        free(tmp);
+        return QTN_ERR_MERCURY;
+    }
+
+    tmp->refcount = 1;
+    *ref          = tmp;
+    return QTN_SUCCESS;
+}
+
+/* returns a reference to the provider's current poolset, or NULL if it
+ * does not have one
+ */
+static struct qtn_poolset_ref* qtn_poolset_acquire(quintain_provider_t provider)
+{
+    struct qtn_poolset_ref* ref;
+
+    ABT_mutex_lock(provider->config_mutex);
+    ref = provider->poolset;
+    if (ref) __atomic_fetch_add(&ref->refcount, 1, __ATOMIC_RELAXED);
+    ABT_mutex_unlock(provider->config_mutex);
+
+    return ref;
+}
+
+static void qtn_poolset_release(struct qtn_poolset_ref* ref)
+{
+    if (__atomic_sub_fetch(&ref->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        margo_bulk_poolset_destroy(ref->poolset);
+        free(ref);
+    }
+}
+
+static void qtn_stat_ult(hg_handle_t handle)
+{
+    margo_instance_id     mid      = MARGO_INSTANCE_NULL;
+    qtn_stat_out_t        out      = {0};
+    const struct hg_info* info     = NULL;
+    quintain_provider_t   provider = NULL;
+    struct rusage         usage;
+    double                joules;
+    int                   ret;
+
+    memset(&out, 0, sizeof(out));
+
+    mid = margo_hg_handle_get_instance(handle);
+    assert(mid);
+    info     = margo_get_info(handle);
+    provider = margo_registered_data(mid, info->id);
+    if (!provider) {
+        out.ret = QTN_ERR_UNKNOWN_PROVIDER;
+        QTN_ERROR(mid, "Unkown provider");
+        goto finish;
+    }
+
+    /* no input */
+
+    ret = getrusage(RUSAGE_SELF, &usage);
+    if (ret != 0) {
+        out.ret = QTN_ERR_STATISTICS;
+        QTN_ERROR(mid, "getrusage failure");
+        goto finish;
+    } else {
+        out.utime_sec  = usage.ru_utime.tv_sec;
+        out.utime_usec = usage.ru_utime.tv_usec;
+        out.stime_sec  = usage.ru_stime.tv_sec;
+        out.stime_usec = usage.ru_stime.tv_usec;
+    }
+
+    ABT_mutex_lock(provider->rapl_mutex);
+    joules = qtn_rapl_read(&provider->rapl);
+    ABT_mutex_unlock(provider->rapl_mutex);
+    out.energy_uj = joules < 0 ? -1 : (int64_t)(joules * 1e6);
+
+finish:
+    margo_respond(handle, &out);
+    margo_destroy(handle);
+}
+DEFINE_MARGO_RPC_HANDLER(qtn_stat_ult)
+
+static void qtn_set_config_ult(hg_handle_t handle)
+{
+    margo_instance_id     mid      = MARGO_INSTANCE_NULL;
+    qtn_set_config_in_t   in;
+    qtn_set_config_out_t  out;
+    const struct hg_info* info     = NULL;
+    quintain_provider_t   provider = NULL;
+    hg_return_t           hret;
+
+    memset(&out, 0, sizeof(out));
+
+    mid = margo_hg_handle_get_instance(handle);
+    assert(mid);
+    info     = margo_get_info(handle);
+    provider = margo_registered_data(mid, info->id);
+    if (!provider) {
+        out.ret = QTN_ERR_UNKNOWN_PROVIDER;
+        QTN_ERROR(mid, "Unkown provider");
+        goto finish;
+    }
+
+    hret = margo_get_input(handle, &in);
+    if (hret != HG_SUCCESS) {
+        out.ret = QTN_ERR_MERCURY;
+        QTN_ERROR(mid, "margo_get_input: %s", HG_Error_to_string(hret));
+        goto finish;
+    }
+
+    out.ret = quintain_provider_set_config(provider, in.json_config);
+    margo_free_input(handle, &in);
+
+finish:
+    margo_respond(handle, &out);
+    margo_destroy(handle);
+}
+DEFINE_MARGO_RPC_HANDLER(qtn_set_config_ult)
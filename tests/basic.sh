@@ -12,6 +12,10 @@ if [ -z $srcdir ]; then
 fi
 
 export LD_LIBRARY_PATH="$LD_LIBRARY_PATH:$PWD/src/.libs"
+
+# RPC encoders and decoders alone, briefly, over a small payload sweep
+src/quintain-proc-benchmark -m 4096 -r 2 -t 0.01 | grep -q ^proc_stats
+
 bedrock -c $srcdir/tests/mochi-quintain-provider.json na+sm:// &
 BEDROCK_PID=$!
 
@@ -19,6 +23,104 @@ sleep 2
 
 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-example.json -o test-output
 
+# pipelined bulk transfers split into poolset-sized chunks
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-chunked.json -o test-output-chunked
+# the provider reports the server_config that was applied to it at run time
+zcat test-output-chunked.gz | awk '/^"quintain-benchmark"/ {done=1} !done && /"poolset_nbuffers_per_pool": ?16/ {found=1} END {exit !found}'
+
+# seeded payloads verified with checksums on every path
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-verify.json -o test-output-verify
+if zcat test-output-verify.gz | grep ^integrity_stats | awk '$3 != 0 {bad=1} END {exit !bad}'; then
+    echo "payload verification failures detected"
+    exit 1
+fi
+
+# pulled data compressed by the provider, and compressed data that it
+# inflates and checks against the raw size
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-compress.json -o test-output-compress
+zcat test-output-compress.gz | awk '$1 == "compression_stats" && $3 > 0 && $3 == $4 {client=1} $1 == "compression_server_stats" && $3 > 0 {server=1} END {exit !(client && server)}'
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-decompress.json -o test-output-decompress
+zcat test-output-decompress.gz | awk '$1 == "compression_stats" && $4 > 0 && $3 > $4 {client=1} $1 == "compression_server_stats" && $3 > 0 {server=1} END {exit !(client && server)}'
+# several operations per RPC, executed concurrently by the provider
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-batch.json -o test-output-batch
+
+# run length chosen by steady state detection, bounded at 5 seconds
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-steady.json -o test-output-steady
+
+# repeated trials of two configurations in shuffled order
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-trials.json -o test-output-trials
+# the machine-readable summary of a run passes a comparison with itself
+$srcdir/src/quintain-benchmark-compare.py test-output-trials.summary.json test-output-trials.summary.json
+# and fails against a baseline that claims ten times the throughput
+python3 - test-output-trials.summary.json > test-output-doctored.summary.json <<'EOF'
+import json, sys
+summary = json.load(open(sys.argv[1]))
+for cfg in summary['configurations']:
+    cfg['summary']['ops_per_sec']['mean'] *= 10
+json.dump(summary, sys.stdout)
+EOF
+status=0
+$srcdir/src/quintain-benchmark-compare.py --ignore-ci test-output-doctored.summary.json test-output-trials.summary.json || status=$?
+if [ $status -ne 1 ]; then
+    echo "regression against doctored baseline not detected"
+    exit 1
+fi
+if [ `zcat test-output-trials.gz | grep -c ^trial_summary` -ne 8 ]; then
+    echo "missing trial summary"
+    exit 1
+fi
+
+# inline versus bulk transfer of the same payloads, to find the crossover
+src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-sweep.json -o test-output-sweep
+zcat test-output-sweep.gz | grep -q ^payload_crossover
+
+# the same workload from several client contexts without MPI
+src/quintain-loadgen -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-example.json -c 4 -o test-output-loadgen
+
+# the same workload against a provider in the load generator's own process
+src/quintain-loadgen -l self -j $srcdir/tests/quintain-benchmark-example.json -c 2 -o test-output-loopback
+
+# more concurrent requests than that provider admits; the ones it refuses
+# are counted by both sides rather than failing the run
+src/quintain-loadgen -l self -j $srcdir/tests/quintain-benchmark-overload.json -c 2 -o test-output-overload
+zcat test-output-overload.gz | awk '$1 == "admission_stats" {rejected += $3} END {exit !(rejected > 0)}'
+zcat test-output-overload.gz | awk '/^"quintain-benchmark"/ {done=1} !done && /"rejected_requests": ?[1-9]/ {found=1} END {exit !found}'
+
+# heavy-tailed delays and periodic stalls injected by that provider
+src/quintain-loadgen -l self -j $srcdir/tests/quintain-benchmark-faults.json -c 2 -o test-output-faults
+
+# injected errors fail whole batches, which are counted rather than fatal
+src/quintain-loadgen -l self -j $srcdir/tests/quintain-benchmark-batch-faults.json -c 2 -o test-output-batch-faults
+zcat test-output-batch-faults.gz | awk '$1 == "batch_stats" {failed += $7} $1 == "resilience_stats" {counted += $10} END {exit !(failed > 0 && counted == failed)}'
+
+# the same kind of faults absorbed by client timeouts, retries, and hedging
+src/quintain-loadgen -l self -j $srcdir/tests/quintain-benchmark-resilience.json -c 2 -o test-output-resilience
+zcat test-output-resilience.gz | grep -q ^resilience_stats
+
+# client energy accounting against a fake powercap tree whose counter
+# advances while the load generator runs
+rm -rf test-powercap
+mkdir -p test-powercap/intel-rapl:0
+echo package-0 > test-powercap/intel-rapl:0/name
+echo 262143328850 > test-powercap/intel-rapl:0/max_energy_range_uj
+echo 1000000 > test-powercap/intel-rapl:0/energy_uj
+(
+    uj=1000000
+    while true; do
+        uj=$((uj + 100000))
+        echo $uj > test-powercap/energy_uj.tmp
+        mv test-powercap/energy_uj.tmp test-powercap/intel-rapl:0/energy_uj
+        sleep 0.1
+    done
+) &
+RAPL_PID=$!
+src/quintain-loadgen -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-energy.json -o test-output-energy
+kill $RAPL_PID
+wait $RAPL_PID || true
+# the client's energy over the measurement window must be positive
+zcat test-output-energy.gz | grep ^energy_stats | awk '$2 <= 0 {bad=1} END {exit bad}'
+rm -rf test-powercap
+
 # if the bedrock-shutdown utility is available then use that to gracefully
 # shut down the daemon (which makes things easier for memory debuggers like
 # address-sanitizer)
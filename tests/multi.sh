@@ -15,6 +15,34 @@ sleep 2
 bedrock -c $srcdir/tests/mochi-quintain-provider-2svr-B.json na+sm:// &
 sleep 2
 
-mpiexec -n 2 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-example.json -o test-output
+# the second server runs two quintain providers, so three ranks cover all
+# of them
+mpiexec -n 3 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-example.json -o test-output
+zcat test-output.gz | awk '$1 == "client_mapping" && $5 == 3 {found = 1} END {exit !found}'
+# the first server hands requests of 8 KiB or more to its bulk pool, which
+# has an xstream of its own
+zcat test-output.gz | awk '/^"quintain-benchmark"/ {done=1} !done && /"bulk": ?[{]/ {bulk=1; next} bulk && /"requests"/ {if ($0 ~ /"requests": ?[1-9]/) found=1; bulk=0} END {exit !found}'
+
+# without bulk data every request is small enough for the fast paths of
+# both servers (inline on the first, worker ULTs on the second)
+mpiexec -n 3 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-small.json -o test-output-small
+zcat test-output-small.gz | awk '/^"quintain-benchmark"/ {done=1} !done && /"fast": ?[{]/ {fast=1; next} fast && /"requests"/ {if ($0 ~ /"requests": ?[1-9]/) found=1; fast=0} END {exit !found}'
+# every client received well-formed responses with intact payloads
+zcat test-output-small.gz | awk '$1 == "integrity_stats" {n++; if ($3 != 0) bad=1} $1 == "sample_stats" && $9 <= 0 {bad=1} END {exit bad || n != 3}'
+
+# with more than one provider, slow requests are hedged to another one.
+# This leaves fault injection enabled on the providers, so it goes last.
+mpiexec -n 3 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-resilience.json -o test-output-hedge
+zcat test-output-hedge.gz | awk '$1 == "resilience_stats" {hedges += $7} END {exit !(hedges > 0)}'
+
+bedrock-shutdown -f quintain.flock.json na+sm://
+sleep 2
+
+# several providers without rpc xstreams share the primary pool; ranks are
+# assigned to both of them (provider ids 1 and 3)
+mpiexec -n 1 bedrock --jx9 -c $srcdir/tests/mochi-quintain-provider.jx9 --jx9-context "num_providers=2" na+sm:// &
+sleep 2
+mpiexec -n 2 src/quintain-benchmark -g quintain.flock.json -j $srcdir/tests/quintain-benchmark-example.json -o test-output-shared
+zcat test-output-shared.gz | awk '$1 == "client_mapping" && $5 == 3 {found = 1} END {exit !found}'
 
 bedrock-shutdown -f quintain.flock.json na+sm://